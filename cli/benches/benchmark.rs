@@ -74,9 +74,16 @@ fn main() {
         .unwrap_or(0);
 
     eprintln!("Benchmarking with {} repetitions", *REPETITION_COUNT);
+    if env::var("TREE_SITTER_DISABLE_ASCII_RUNS").is_ok() {
+        eprintln!("Lexing without the ASCII run fast path");
+    }
 
     let mut parser = Parser::new();
     let mut all_normal_speeds = Vec::new();
+    let mut all_callback_speeds = Vec::new();
+    let mut all_single_line_speeds = Vec::new();
+    let mut all_line_loop_speeds = Vec::new();
+    let mut all_line_batch_speeds = Vec::new();
     let mut all_error_speeds = Vec::new();
 
     for (language_path, (example_paths, query_paths)) in
@@ -122,6 +129,90 @@ fn main() {
             }));
         }
 
+        // Parsing a string lets the lexer read the text directly. Reading
+        // the same text through a callback shows how much that saves.
+        eprintln!("  Parsing Valid Code (input callback):");
+        let mut callback_speeds = Vec::new();
+        for example_path in example_paths {
+            if let Some(filter) = EXAMPLE_FILTER.as_ref() {
+                if !example_path.to_str().unwrap().contains(filter.as_str()) {
+                    continue;
+                }
+            }
+
+            callback_speeds.push(parse(example_path, max_path_length, |code| {
+                parser
+                    .parse_with(&mut |i, _| &code[i.min(code.len())..], None)
+                    .expect("Failed to parse");
+            }));
+        }
+
+        // Minified code is one long line. The lexer has to find the end of
+        // each run of ASCII characters without scanning the rest of the line.
+        eprintln!("  Parsing Valid Code (single line):");
+        let mut single_line_speeds = Vec::new();
+        for example_path in example_paths {
+            if let Some(filter) = EXAMPLE_FILTER.as_ref() {
+                if !example_path.to_str().unwrap().contains(filter.as_str()) {
+                    continue;
+                }
+            }
+
+            let mut source_code = read(example_path);
+            for byte in source_code.iter_mut() {
+                if *byte == b'\n' {
+                    *byte = b' ';
+                }
+            }
+            single_line_speeds.push(parse_code(
+                example_path,
+                &source_code,
+                max_path_length,
+                |code| {
+                    parser.parse(code, None).expect("Failed to parse");
+                },
+            ));
+        }
+
+        // Parsing each line as a separate document shows how much it costs to
+        // start a parse. A batch keeps allocating from the same arena instead
+        // of starting a new arena for each document.
+        parser.set_arena_enabled(true);
+        eprintln!("  Parsing Lines As Documents (loop):");
+        let mut line_loop_speeds = Vec::new();
+        for example_path in example_paths {
+            if let Some(filter) = EXAMPLE_FILTER.as_ref() {
+                if !example_path.to_str().unwrap().contains(filter.as_str()) {
+                    continue;
+                }
+            }
+
+            line_loop_speeds.push(parse(example_path, max_path_length, |code| {
+                let trees = code
+                    .split(|byte| *byte == b'\n')
+                    .map(|line| parser.parse(line, None).expect("Failed to parse"))
+                    .collect::<Vec<_>>();
+                drop(trees);
+            }));
+        }
+
+        eprintln!("  Parsing Lines As Documents (batch):");
+        let mut line_batch_speeds = Vec::new();
+        for example_path in example_paths {
+            if let Some(filter) = EXAMPLE_FILTER.as_ref() {
+                if !example_path.to_str().unwrap().contains(filter.as_str()) {
+                    continue;
+                }
+            }
+
+            line_batch_speeds.push(parse(example_path, max_path_length, |code| {
+                let lines = code.split(|byte| *byte == b'\n').collect::<Vec<_>>();
+                let trees = parser.parse_batch(&lines, 1);
+                assert!(trees.iter().all(Option::is_some), "Failed to parse");
+            }));
+        }
+        parser.set_arena_enabled(false);
+
         eprintln!("  Parsing Invalid Code (mismatched languages):");
         let mut error_speeds = Vec::new();
         for (other_language_path, (example_paths, _)) in
@@ -147,12 +238,60 @@ fn main() {
             eprintln!("  Worst Speed (normal):   {} bytes/ms", worst_normal);
         }
 
+        if let Some((average_callback, worst_callback)) = aggregate(&callback_speeds) {
+            eprintln!(
+                "  Average Speed (input callback): {} bytes/ms",
+                average_callback
+            );
+            eprintln!(
+                "  Worst Speed (input callback):   {} bytes/ms",
+                worst_callback
+            );
+        }
+
+        if let Some((average_single_line, worst_single_line)) = aggregate(&single_line_speeds) {
+            eprintln!(
+                "  Average Speed (single line): {} bytes/ms",
+                average_single_line
+            );
+            eprintln!(
+                "  Worst Speed (single line):   {} bytes/ms",
+                worst_single_line
+            );
+        }
+
+        if let Some((average_line_loop, worst_line_loop)) = aggregate(&line_loop_speeds) {
+            eprintln!(
+                "  Average Speed (lines, loop): {} bytes/ms",
+                average_line_loop
+            );
+            eprintln!(
+                "  Worst Speed (lines, loop):   {} bytes/ms",
+                worst_line_loop
+            );
+        }
+
+        if let Some((average_line_batch, worst_line_batch)) = aggregate(&line_batch_speeds) {
+            eprintln!(
+                "  Average Speed (lines, batch): {} bytes/ms",
+                average_line_batch
+            );
+            eprintln!(
+                "  Worst Speed (lines, batch):   {} bytes/ms",
+                worst_line_batch
+            );
+        }
+
         if let Some((average_error, worst_error)) = aggregate(&error_speeds) {
             eprintln!("  Average Speed (errors): {} bytes/ms", average_error);
             eprintln!("  Worst Speed (errors):   {} bytes/ms", worst_error);
         }
 
         all_normal_speeds.extend(normal_speeds);
+        all_callback_speeds.extend(callback_speeds);
+        all_single_line_speeds.extend(single_line_speeds);
+        all_line_loop_speeds.extend(line_loop_speeds);
+        all_line_batch_speeds.extend(line_batch_speeds);
         all_error_speeds.extend(error_speeds);
     }
 
@@ -162,6 +301,50 @@ fn main() {
         eprintln!("  Worst Speed (normal):   {} bytes/ms", worst_normal);
     }
 
+    if let Some((average_callback, worst_callback)) = aggregate(&all_callback_speeds) {
+        eprintln!(
+            "  Average Speed (input callback): {} bytes/ms",
+            average_callback
+        );
+        eprintln!(
+            "  Worst Speed (input callback):   {} bytes/ms",
+            worst_callback
+        );
+    }
+
+    if let Some((average_single_line, worst_single_line)) = aggregate(&all_single_line_speeds) {
+        eprintln!(
+            "  Average Speed (single line): {} bytes/ms",
+            average_single_line
+        );
+        eprintln!(
+            "  Worst Speed (single line):   {} bytes/ms",
+            worst_single_line
+        );
+    }
+
+    if let Some((average_line_loop, worst_line_loop)) = aggregate(&all_line_loop_speeds) {
+        eprintln!(
+            "  Average Speed (lines, loop): {} bytes/ms",
+            average_line_loop
+        );
+        eprintln!(
+            "  Worst Speed (lines, loop):   {} bytes/ms",
+            worst_line_loop
+        );
+    }
+
+    if let Some((average_line_batch, worst_line_batch)) = aggregate(&all_line_batch_speeds) {
+        eprintln!(
+            "  Average Speed (lines, batch): {} bytes/ms",
+            average_line_batch
+        );
+        eprintln!(
+            "  Worst Speed (lines, batch):   {} bytes/ms",
+            worst_line_batch
+        );
+    }
+
     if let Some((average_error, worst_error)) = aggregate(&all_error_speeds) {
         eprintln!("  Average Speed (errors): {} bytes/ms", average_error);
         eprintln!("  Worst Speed (errors):   {} bytes/ms", worst_error);
@@ -184,19 +367,25 @@ fn aggregate(speeds: &Vec<usize>) -> Option<(usize, usize)> {
     Some((total / speeds.len(), max))
 }
 
-fn parse(path: &Path, max_path_length: usize, mut action: impl FnMut(&[u8])) -> usize {
+fn parse(path: &Path, max_path_length: usize, action: impl FnMut(&[u8])) -> usize {
+    parse_code(path, &read(path), max_path_length, action)
+}
+
+fn parse_code(
+    path: &Path,
+    source_code: &[u8],
+    max_path_length: usize,
+    mut action: impl FnMut(&[u8]),
+) -> usize {
     eprint!(
         "    {:width$}\t",
         path.file_name().unwrap().to_str().unwrap(),
         width = max_path_length
     );
 
-    let source_code = fs::read(path)
-        .map_err(Error::wrap(|| format!("Failed to read {:?}", path)))
-        .unwrap();
     let time = Instant::now();
     for _ in 0..*REPETITION_COUNT {
-        action(&source_code);
+        action(source_code);
     }
     let duration = time.elapsed() / (*REPETITION_COUNT as u32);
     let duration_ms = duration.as_millis();
@@ -205,6 +394,12 @@ fn parse(path: &Path, max_path_length: usize, mut action: impl FnMut(&[u8])) ->
     speed as usize
 }
 
+fn read(path: &Path) -> Vec<u8> {
+    fs::read(path)
+        .map_err(Error::wrap(|| format!("Failed to read {:?}", path)))
+        .unwrap()
+}
+
 fn get_language(path: &Path) -> Language {
     let src_dir = GRAMMARS_DIR.join(path).join("src");
     TEST_LOADER
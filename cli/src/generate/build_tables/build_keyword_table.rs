@@ -0,0 +1,218 @@
+use crate::generate::rules::Symbol;
+use crate::generate::tables::{KeywordTable, LexTable};
+use log::info;
+use std::char;
+
+const MAX_KEYWORD_COUNT: usize = 4096;
+const MAX_KEYWORD_LENGTH: usize = 64;
+const MAX_CHARS_PER_TRANSITION: usize = 8;
+const KEYWORDS_PER_BUCKET: usize = 4;
+const SEEDS_PER_TABLE_SIZE: u32 = 16;
+
+// Build a perfect hash table of all of the strings that are recognized by the
+// keyword lex table, so that the runtime can classify a word token by looking
+// up its text, instead of lexing it a second time.
+//
+// This is only possible when the keywords form a small, finite set of strings,
+// so grammars whose keywords are described by more general patterns fall back
+// to using the keyword lex function.
+pub(crate) fn build_keyword_table(keyword_lex_table: &LexTable) -> Option<KeywordTable> {
+    if keyword_lex_table.states.is_empty() {
+        return None;
+    }
+    let keywords = enumerate_keywords(keyword_lex_table)?;
+    if keywords.is_empty() {
+        return None;
+    }
+
+    let mut slot_count = (keywords.len() + keywords.len() / 4).next_power_of_two();
+    let bucket_count = (keywords.len() + KEYWORDS_PER_BUCKET - 1) / KEYWORDS_PER_BUCKET;
+    loop {
+        for seed in 0..SEEDS_PER_TABLE_SIZE {
+            if let Some(table) = build_table_with_seed(&keywords, seed, bucket_count, slot_count) {
+                info!(
+                    "Keywords - built a perfect hash of {} keywords with {} slots",
+                    keywords.len(),
+                    slot_count
+                );
+                return Some(table);
+            }
+        }
+        slot_count *= 2;
+    }
+}
+
+// Find all of the strings accepted by the keyword lex table, as long as
+// there is a bounded number of them, and they can't be preceded by any
+// skipped characters that could also start a word.
+fn enumerate_keywords(keyword_lex_table: &LexTable) -> Option<Vec<(String, Symbol)>> {
+    for state in &keyword_lex_table.states {
+        for (chars, action) in &state.advance_actions {
+            if !action.in_main_token
+                && chars
+                    .chars()
+                    .any(|c| c.is_alphanumeric() || c == '_' || c == '$')
+            {
+                info!("Keywords - no perfect hash, because keywords can skip word characters");
+                return None;
+            }
+        }
+    }
+
+    let mut result = Vec::new();
+    let mut stack = vec![(0, String::new())];
+    while let Some((state_id, prefix)) = stack.pop() {
+        let state = &keyword_lex_table.states[state_id];
+        if let Some(symbol) = state.accept_action {
+            if !prefix.is_empty() {
+                result.push((prefix.clone(), symbol));
+            }
+        }
+        for (chars, action) in &state.advance_actions {
+            if !action.in_main_token {
+                continue;
+            }
+            if chars.contains(char::MAX)
+                || chars.chars().nth(MAX_CHARS_PER_TRANSITION).is_some()
+                || prefix.len() >= MAX_KEYWORD_LENGTH
+                || result.len() + stack.len() >= MAX_KEYWORD_COUNT
+            {
+                info!("Keywords - no perfect hash, because keywords are not a small finite set");
+                return None;
+            }
+            for c in chars.chars() {
+                let mut string = prefix.clone();
+                string.push(c);
+                stack.push((action.state, string));
+            }
+        }
+    }
+    result.sort_unstable();
+    Some(result)
+}
+
+fn build_table_with_seed(
+    keywords: &Vec<(String, Symbol)>,
+    seed: u32,
+    bucket_count: usize,
+    slot_count: usize,
+) -> Option<KeywordTable> {
+    let mut buckets = vec![Vec::new(); bucket_count];
+    for (i, (string, _)) in keywords.iter().enumerate() {
+        let hash = keyword_hash(seed, string.as_bytes());
+        buckets[(hash >> 32) as usize % bucket_count].push((i, hash));
+    }
+
+    // Place the largest buckets first, finding a displacement for each one
+    // that moves all of its keywords into unused slots.
+    let mut bucket_ids = (0..bucket_count).collect::<Vec<_>>();
+    bucket_ids.sort_unstable_by_key(|i| (usize::MAX - buckets[*i].len(), *i));
+    let mut displacements = vec![0; bucket_count];
+    let mut entries = vec![None; slot_count];
+    let mut slots = Vec::new();
+    for bucket_id in bucket_ids {
+        let bucket = &buckets[bucket_id];
+        if bucket.is_empty() {
+            break;
+        }
+        let displacement = (0..=u16::MAX).find(|displacement| {
+            slots.clear();
+            for (_, hash) in bucket {
+                let slot = keyword_slot(*hash, *displacement, slot_count);
+                if entries[slot].is_some() || slots.contains(&slot) {
+                    return false;
+                }
+                slots.push(slot);
+            }
+            true
+        })?;
+        displacements[bucket_id] = displacement;
+        for (i, hash) in bucket {
+            entries[keyword_slot(*hash, displacement, slot_count)] = Some(keywords[*i].clone());
+        }
+    }
+
+    Some(KeywordTable {
+        seed,
+        displacements,
+        entries,
+        max_length: keywords.iter().map(|(s, _)| s.len()).max().unwrap(),
+    })
+}
+
+// This must match the hash function in the runtime's
+// `ts_language_keyword_symbol` function.
+fn keyword_hash(seed: u32, bytes: &[u8]) -> u64 {
+    let mut hash = 0xcbf29ce484222325u64 ^ seed as u64;
+    for byte in bytes {
+        hash ^= *byte as u64;
+        hash = hash.wrapping_mul(0x100000001b3);
+    }
+    hash ^= hash >> 33;
+    hash = hash.wrapping_mul(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    hash
+}
+
+fn keyword_slot(hash: u64, displacement: u16, slot_count: usize) -> usize {
+    let high = (hash >> 32) as u32;
+    let slot = (hash as u32).wrapping_add((displacement as u32).wrapping_mul(high | 1));
+    slot as usize & (slot_count - 1)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::generate::nfa::CharacterSet;
+    use crate::generate::tables::{AdvanceAction, LexState};
+
+    #[test]
+    fn test_build_keyword_table() {
+        let words = ["if", "in", "int", "else", "return", "while", "For", "fOr"];
+        let mut table = LexTable::default();
+        table.states.push(LexState::default());
+        for (i, word) in words.iter().enumerate() {
+            let mut state_id = 0;
+            for c in word.chars() {
+                let existing = table.states[state_id]
+                    .advance_actions
+                    .iter()
+                    .find(|(chars, _)| chars.contains(c))
+                    .map(|(_, action)| action.state);
+                state_id = existing.unwrap_or_else(|| {
+                    table.states.push(LexState::default());
+                    let new_state_id = table.states.len() - 1;
+                    table.states[state_id].advance_actions.push((
+                        CharacterSet::empty().add_char(c),
+                        AdvanceAction {
+                            state: new_state_id,
+                            in_main_token: true,
+                        },
+                    ));
+                    new_state_id
+                });
+            }
+            table.states[state_id].accept_action = Some(Symbol::terminal(i));
+        }
+
+        let keyword_table = build_keyword_table(&table).unwrap();
+        assert_eq!(keyword_table.max_length, 6);
+        for (i, word) in words.iter().enumerate() {
+            let hash = keyword_hash(keyword_table.seed, word.as_bytes());
+            let bucket = (hash >> 32) as usize % keyword_table.displacements.len();
+            let slot = keyword_slot(
+                hash,
+                keyword_table.displacements[bucket],
+                keyword_table.entries.len(),
+            );
+            assert_eq!(
+                keyword_table.entries[slot],
+                Some((word.to_string(), Symbol::terminal(i)))
+            );
+        }
+        assert_eq!(
+            keyword_table.entries.iter().filter(|e| e.is_some()).count(),
+            words.len()
+        );
+    }
+}
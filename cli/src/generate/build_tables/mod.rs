@@ -1,22 +1,26 @@
+mod build_keyword_table;
 pub(crate) mod build_lex_table;
 pub(crate) mod build_parse_table;
 mod coincident_tokens;
 mod item;
 mod item_set_builder;
 mod minimize_parse_table;
+mod reorder_by_profile;
 mod token_conflicts;
 
+use self::build_keyword_table::build_keyword_table;
 use self::build_lex_table::build_lex_table;
 use self::build_parse_table::{build_parse_table, ParseStateInfo};
 use self::coincident_tokens::CoincidentTokenIndex;
 use self::minimize_parse_table::minimize_parse_table;
+pub(crate) use self::reorder_by_profile::reorder_tables_by_profile;
 use self::token_conflicts::TokenConflictMap;
 use crate::error::Result;
 use crate::generate::grammars::{InlinedProductionMap, LexicalGrammar, SyntaxGrammar};
 use crate::generate::nfa::NfaCursor;
 use crate::generate::node_types::VariableInfo;
 use crate::generate::rules::{AliasMap, Symbol, SymbolType, TokenSet};
-use crate::generate::tables::{LexTable, ParseAction, ParseTable, ParseTableEntry};
+use crate::generate::tables::{KeywordTable, LexTable, ParseAction, ParseTable, ParseTableEntry};
 use log::info;
 use std::collections::{BTreeSet, HashMap};
 
@@ -27,7 +31,13 @@ pub(crate) fn build_tables(
     variable_info: &Vec<VariableInfo>,
     inlines: &InlinedProductionMap,
     report_symbol_name: Option<&str>,
-) -> Result<(ParseTable, LexTable, LexTable, Option<Symbol>)> {
+) -> Result<(
+    ParseTable,
+    LexTable,
+    LexTable,
+    Option<KeywordTable>,
+    Option<Symbol>,
+)> {
     let (mut parse_table, following_tokens, parse_state_info) =
         build_parse_table(syntax_grammar, lexical_grammar, inlines, variable_info)?;
     let token_conflict_map = TokenConflictMap::new(lexical_grammar, following_tokens);
@@ -64,6 +74,7 @@ pub(crate) fn build_tables(
         &coincident_token_index,
         &token_conflict_map,
     );
+    let keyword_table = build_keyword_table(&keyword_lex_table);
     populate_external_lex_states(&mut parse_table, syntax_grammar);
     mark_fragile_tokens(&mut parse_table, lexical_grammar, &token_conflict_map);
 
@@ -80,6 +91,7 @@ pub(crate) fn build_tables(
         parse_table,
         main_lex_table,
         keyword_lex_table,
+        keyword_table,
         syntax_grammar.word_token,
     ))
 }
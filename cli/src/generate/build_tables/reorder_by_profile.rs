@@ -0,0 +1,231 @@
+use crate::error::{Error, Result};
+use crate::generate::render::is_large_state;
+use crate::generate::tables::{LexState, LexTable, ParseState, ParseTable};
+use crate::generate::ParseTableProfile;
+use log::info;
+use std::mem;
+
+const HOT_STATE_HIT_FRACTION: f64 = 0.9;
+const MAX_PROMOTED_STATE_COUNT: usize = 256;
+
+// Reorder the parse states and the main lex states based on how often they were
+// used while parsing a sample corpus, and return the number of leading parse
+// states that should be stored in the normal array representation.
+//
+// The hottest parse states are promoted to the array representation, so that
+// looking up their actions doesn't require a search, even if they have few
+// entries. Within both representations, the states are then sorted by descending
+// hit count, so that the table rows and actions that are used most frequently
+// are stored close together.
+pub(crate) fn reorder_tables_by_profile(
+    parse_table: &mut ParseTable,
+    lex_table: &mut LexTable,
+    profile: &ParseTableProfile,
+) -> Result<usize> {
+    if profile.parse_state_hits.len() != parse_table.states.len()
+        || profile.lex_state_hits.len() > lex_table.states.len()
+    {
+        return Err(Error::new(format!(
+            "The profile has {} parse states and {} lex states, but the grammar has {} parse states and {} lex states. Profiles must be recorded with a parser that was generated from the same grammar without a profile.",
+            profile.parse_state_hits.len(),
+            profile.lex_state_hits.len(),
+            parse_table.states.len(),
+            lex_table.states.len(),
+        )));
+    }
+
+    let large_state_count = reorder_parse_states(parse_table, &profile.parse_state_hits);
+    reorder_lex_states(lex_table, parse_table, &profile.lex_state_hits);
+    Ok(large_state_count)
+}
+
+fn reorder_parse_states(parse_table: &mut ParseTable, hits: &Vec<u64>) -> usize {
+    let mut is_large = (0..parse_table.states.len())
+        .map(|i| is_large_state(parse_table, i))
+        .collect::<Vec<_>>();
+
+    // Promote the hottest small states until the large states account for most
+    // of the lookups.
+    let total_hits = hits.iter().sum::<u64>();
+    let mut large_hits = (0..hits.len())
+        .filter(|i| is_large[*i])
+        .map(|i| hits[i])
+        .sum::<u64>();
+    let mut small_state_ids = (0..hits.len())
+        .filter(|i| !is_large[*i] && hits[*i] > 0)
+        .collect::<Vec<_>>();
+    small_state_ids.sort_by_key(|i| (u64::MAX - hits[*i], *i));
+    let mut promoted_count = 0;
+    for id in small_state_ids {
+        if (large_hits as f64) >= HOT_STATE_HIT_FRACTION * total_hits as f64
+            || promoted_count == MAX_PROMOTED_STATE_COUNT
+        {
+            break;
+        }
+        is_large[id] = true;
+        large_hits += hits[id];
+        promoted_count += 1;
+    }
+
+    // Don't change states 0 (the error state) or 1 (the start state). Place
+    // the large states before the small states, and sort each group by
+    // descending hit count.
+    let mut old_ids_by_new_id = (0..parse_table.states.len()).collect::<Vec<_>>();
+    old_ids_by_new_id[2..].sort_by_key(|i| (!is_large[*i], u64::MAX - hits[*i], *i));
+    let large_state_count = is_large.iter().filter(|is_large| **is_large).count();
+
+    let mut new_ids_by_old_id = vec![0; old_ids_by_new_id.len()];
+    for (id, old_id) in old_ids_by_new_id.iter().enumerate() {
+        new_ids_by_old_id[*old_id] = id;
+    }
+    parse_table.states = old_ids_by_new_id
+        .iter()
+        .map(|old_id| {
+            let mut state = ParseState::default();
+            mem::swap(&mut state, &mut parse_table.states[*old_id]);
+            state.update_referenced_states(|id, _| new_ids_by_old_id[id]);
+            state
+        })
+        .collect();
+
+    info!(
+        "Profile - promoted {} parse states, for a total of {} large states",
+        promoted_count, large_state_count
+    );
+    large_state_count
+}
+
+fn reorder_lex_states(lex_table: &mut LexTable, parse_table: &mut ParseTable, hits: &Vec<u64>) {
+    // Starting with the hottest start states, visit every lex state that can be
+    // reached from each one, so that the states that are used together while
+    // lexing a token are stored together. Don't change state 0.
+    let mut start_state_ids = (1..hits.len()).filter(|i| hits[*i] > 0).collect::<Vec<_>>();
+    start_state_ids.sort_by_key(|i| (u64::MAX - hits[*i], *i));
+
+    let mut old_ids_by_new_id = vec![0];
+    let mut visited = vec![false; lex_table.states.len()];
+    visited[0] = true;
+    let mut stack = Vec::new();
+    for start_state_id in start_state_ids {
+        stack.push(start_state_id);
+        while let Some(id) = stack.pop() {
+            if visited[id] {
+                continue;
+            }
+            visited[id] = true;
+            old_ids_by_new_id.push(id);
+            let state = &lex_table.states[id];
+            for (_, action) in state.advance_actions.iter().rev() {
+                stack.push(action.state);
+            }
+            if let Some(action) = &state.eof_action {
+                stack.push(action.state);
+            }
+        }
+    }
+    old_ids_by_new_id.extend((0..lex_table.states.len()).filter(|id| !visited[*id]));
+
+    let mut new_ids_by_old_id = vec![0; old_ids_by_new_id.len()];
+    for (id, old_id) in old_ids_by_new_id.iter().enumerate() {
+        new_ids_by_old_id[*old_id] = id;
+    }
+    lex_table.states = old_ids_by_new_id
+        .iter()
+        .map(|old_id| {
+            let mut state = LexState::default();
+            mem::swap(&mut state, &mut lex_table.states[*old_id]);
+            for (_, advance_action) in state.advance_actions.iter_mut() {
+                advance_action.state = new_ids_by_old_id[advance_action.state];
+            }
+            if let Some(eof_action) = &mut state.eof_action {
+                eof_action.state = new_ids_by_old_id[eof_action.state];
+            }
+            state
+        })
+        .collect();
+    for state in parse_table.states.iter_mut() {
+        state.lex_state_id = new_ids_by_old_id[state.lex_state_id];
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::generate::nfa::CharacterSet;
+    use crate::generate::rules::Symbol;
+    use crate::generate::tables::{AdvanceAction, GotoAction};
+
+    #[test]
+    fn test_reorder_tables_by_profile() {
+        // Four parse states, each with a single entry, so that all but the
+        // first two are small states. State 2 goes to state 3.
+        let mut parse_table = ParseTable {
+            states: (0..4)
+                .map(|i| {
+                    let mut state = ParseState::default();
+                    state.lex_state_id = i % 3;
+                    state
+                        .nonterminal_entries
+                        .insert(Symbol::non_terminal(0), GotoAction::Goto((i + 1) % 4));
+                    state
+                })
+                .collect(),
+            symbols: vec![Symbol::non_terminal(0), Symbol::non_terminal(1)],
+            production_infos: Vec::new(),
+            max_aliased_production_length: 0,
+            external_lex_states: Vec::new(),
+        };
+
+        // Three lex states, where state 1 advances to state 2.
+        let mut lex_table = LexTable {
+            states: vec![LexState::default(); 3],
+        };
+        lex_table.states[1].advance_actions.push((
+            CharacterSet::empty().add_char('a'),
+            AdvanceAction {
+                state: 2,
+                in_main_token: true,
+            },
+        ));
+
+        // State 3 is much hotter than state 2, so it is promoted to a large state,
+        // and moved before state 2. Lex state 2 is a hotter start state than lex
+        // state 1, so it is moved first.
+        let profile = ParseTableProfile {
+            parse_state_hits: vec![0, 1, 2, 100],
+            lex_state_hits: vec![0, 1, 5],
+        };
+        let large_state_count =
+            reorder_tables_by_profile(&mut parse_table, &mut lex_table, &profile).unwrap();
+        assert_eq!(large_state_count, 3);
+        assert_eq!(
+            parse_table
+                .states
+                .iter()
+                .map(|s| s.nonterminal_entries[&Symbol::non_terminal(0)])
+                .collect::<Vec<_>>(),
+            vec![
+                GotoAction::Goto(1),
+                GotoAction::Goto(3),
+                GotoAction::Goto(0),
+                GotoAction::Goto(2),
+            ]
+        );
+        assert_eq!(
+            parse_table
+                .states
+                .iter()
+                .map(|s| s.lex_state_id)
+                .collect::<Vec<_>>(),
+            vec![0, 2, 0, 1]
+        );
+        assert_eq!(lex_table.states[2].advance_actions[0].1.state, 1);
+
+        // Profiles must match the size of the tables.
+        let profile = ParseTableProfile {
+            parse_state_hits: vec![0, 1, 2],
+            lex_state_hits: vec![],
+        };
+        assert!(reorder_tables_by_profile(&mut parse_table, &mut lex_table, &profile).is_err());
+    }
+}
@@ -11,7 +11,7 @@ mod render;
 mod rules;
 mod tables;
 
-use self::build_tables::build_tables;
+use self::build_tables::{build_tables, reorder_tables_by_profile};
 use self::grammars::{InlinedProductionMap, LexicalGrammar, SyntaxGrammar};
 use self::parse_grammar::parse_grammar;
 use self::prepare_grammar::prepare_grammar;
@@ -20,6 +20,7 @@ use self::rules::AliasMap;
 use crate::error::{Error, Result};
 use lazy_static::lazy_static;
 use regex::{Regex, RegexBuilder};
+use serde_derive::{Deserialize, Serialize};
 use std::fs;
 use std::io::Write;
 use std::path::{Path, PathBuf};
@@ -32,6 +33,24 @@ lazy_static! {
         .unwrap();
 }
 
+/// The representation used for the generated lex functions.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum LexerStyle {
+    /// A `switch` statement with a case for each lex state.
+    Switch,
+    /// Transition tables, interpreted by a generic routine in `parser.h`.
+    Table,
+}
+
+/// Counts of how often each parse state and lex state of a generated parser were
+/// used while parsing a sample corpus. These are written by `tree-sitter parse --profile`,
+/// and can be used to optimize the layout of the parse table.
+#[derive(Debug, Default, PartialEq, Eq, Serialize, Deserialize)]
+pub struct ParseTableProfile {
+    pub parse_state_hits: Vec<u64>,
+    pub lex_state_hits: Vec<u64>,
+}
+
 struct GeneratedParser {
     c_code: String,
     node_types_json: String,
@@ -43,6 +62,8 @@ pub fn generate_parser_in_directory(
     next_abi: bool,
     generate_bindings: bool,
     report_symbol_name: Option<&str>,
+    lexer_style: LexerStyle,
+    profile_path: Option<&str>,
 ) -> Result<()> {
     let src_path = repo_path.join("src");
     let header_path = src_path.join("tree_sitter");
@@ -64,6 +85,12 @@ pub fn generate_parser_in_directory(
         }
     }
 
+    // Read the profile that will guide the layout of the parse table, if any.
+    let profile = match profile_path {
+        Some(path) => Some(load_profile_file(path.as_ref())?),
+        None => None,
+    };
+
     // Parse and preprocess the grammar.
     let input_grammar = parse_grammar(&grammar_json)?;
     let (syntax_grammar, lexical_grammar, inlines, simple_aliases) =
@@ -82,12 +109,15 @@ pub fn generate_parser_in_directory(
         simple_aliases,
         next_abi,
         report_symbol_name,
+        lexer_style,
+        profile.as_ref(),
     )?;
 
     write_file(&src_path.join("parser.c"), c_code)?;
     write_file(&src_path.join("node-types.json"), node_types_json)?;
 
-    if next_abi {
+    // Table-driven lex functions rely on the interpreter in the current header.
+    if next_abi || lexer_style == LexerStyle::Table {
         write_file(&header_path.join("parser.h"), tree_sitter::PARSER_HEADER)?;
     }
 
@@ -99,6 +129,13 @@ pub fn generate_parser_in_directory(
 }
 
 pub fn generate_parser_for_grammar(grammar_json: &str) -> Result<(String, String)> {
+    generate_parser_for_grammar_with_lexer_style(grammar_json, LexerStyle::Switch)
+}
+
+pub fn generate_parser_for_grammar_with_lexer_style(
+    grammar_json: &str,
+    lexer_style: LexerStyle,
+) -> Result<(String, String)> {
     let grammar_json = JSON_COMMENT_REGEX.replace_all(grammar_json, "\n");
     let input_grammar = parse_grammar(&grammar_json)?;
     let (syntax_grammar, lexical_grammar, inlines, simple_aliases) =
@@ -111,6 +148,8 @@ pub fn generate_parser_for_grammar(grammar_json: &str) -> Result<(String, String
         simple_aliases,
         true,
         None,
+        lexer_style,
+        None,
     )?;
     Ok((input_grammar.name, parser.c_code))
 }
@@ -123,6 +162,8 @@ fn generate_parser_for_grammar_with_opts(
     simple_aliases: AliasMap,
     next_abi: bool,
     report_symbol_name: Option<&str>,
+    lexer_style: LexerStyle,
+    profile: Option<&ParseTableProfile>,
 ) -> Result<GeneratedParser> {
     let variable_info =
         node_types::get_variable_info(&syntax_grammar, &lexical_grammar, &simple_aliases)?;
@@ -132,7 +173,13 @@ fn generate_parser_for_grammar_with_opts(
         &simple_aliases,
         &variable_info,
     );
-    let (parse_table, main_lex_table, keyword_lex_table, keyword_capture_token) = build_tables(
+    let (
+        mut parse_table,
+        mut main_lex_table,
+        keyword_lex_table,
+        keyword_table,
+        keyword_capture_token,
+    ) = build_tables(
         &syntax_grammar,
         &lexical_grammar,
         &simple_aliases,
@@ -140,16 +187,27 @@ fn generate_parser_for_grammar_with_opts(
         &inlines,
         report_symbol_name,
     )?;
+    let large_state_count = match profile {
+        Some(profile) => Some(reorder_tables_by_profile(
+            &mut parse_table,
+            &mut main_lex_table,
+            profile,
+        )?),
+        None => None,
+    };
     let c_code = render_c_code(
         name,
         parse_table,
         main_lex_table,
         keyword_lex_table,
+        keyword_table,
         keyword_capture_token,
         syntax_grammar,
         lexical_grammar,
         simple_aliases,
         next_abi,
+        lexer_style,
+        large_state_count,
     );
     Ok(GeneratedParser {
         c_code,
@@ -168,6 +226,15 @@ fn load_grammar_file(grammar_path: &Path) -> Result<String> {
     }
 }
 
+fn load_profile_file(profile_path: &Path) -> Result<ParseTableProfile> {
+    let json = fs::read_to_string(profile_path).map_err(Error::wrap(|| {
+        format!("Failed to read profile file {:?}", profile_path)
+    }))?;
+    Ok(serde_json::from_str(&json).map_err(Error::wrap(|| {
+        format!("Failed to parse profile file {:?}", profile_path)
+    }))?)
+}
+
 fn load_js_grammar_file(grammar_path: &Path) -> Result<String> {
     let mut node_process = Command::new("node")
         .env("TREE_SITTER_GRAMMAR_PATH", grammar_path)
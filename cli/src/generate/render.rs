@@ -2,9 +2,10 @@ use super::char_tree::{CharacterTree, Comparator};
 use super::grammars::{ExternalToken, LexicalGrammar, SyntaxGrammar, VariableType};
 use super::rules::{Alias, AliasMap, Symbol, SymbolType};
 use super::tables::{
-    AdvanceAction, FieldLocation, GotoAction, LexState, LexTable, ParseAction, ParseTable,
-    ParseTableEntry,
+    AdvanceAction, FieldLocation, GotoAction, KeywordTable, LexState, LexTable, ParseAction,
+    ParseStateId, ParseTable, ParseTableEntry,
 };
+use super::LexerStyle;
 use core::ops::Range;
 use std::cmp;
 use std::collections::{HashMap, HashSet};
@@ -13,6 +14,8 @@ use std::mem::swap;
 
 const LARGE_CHARACTER_RANGE_COUNT: usize = 8;
 const SMALL_STATE_THRESHOLD: usize = 64;
+const LEX_TABLE_SKIP: u16 = 0x8000;
+const CHARACTER_COUNT: u32 = char::MAX as u32 + 1;
 
 macro_rules! add {
     ($this: tt, $($arg: tt)*) => {{
@@ -56,6 +59,7 @@ struct Generator {
     parse_table: ParseTable,
     main_lex_table: LexTable,
     keyword_lex_table: LexTable,
+    keyword_table: Option<KeywordTable>,
     large_state_count: usize,
     keyword_capture_token: Option<Symbol>,
     syntax_grammar: SyntaxGrammar,
@@ -67,6 +71,7 @@ struct Generator {
     unique_aliases: Vec<Alias>,
     symbol_map: HashMap<Symbol, Symbol>,
     field_names: Vec<String>,
+    lexer_style: LexerStyle,
 
     #[allow(unused)]
     next_abi: bool,
@@ -109,12 +114,15 @@ impl Generator {
 
         let mut main_lex_table = LexTable::default();
         swap(&mut main_lex_table, &mut self.main_lex_table);
-        self.add_lex_function("ts_lex", main_lex_table, true);
+        self.add_lex_function_with_style("ts_lex", main_lex_table, true);
 
         if self.keyword_capture_token.is_some() {
             let mut keyword_lex_table = LexTable::default();
             swap(&mut keyword_lex_table, &mut self.keyword_lex_table);
-            self.add_lex_function("ts_lex_keywords", keyword_lex_table, false);
+            self.add_lex_function_with_style("ts_lex_keywords", keyword_lex_table, false);
+            if self.next_abi && self.keyword_table.is_some() {
+                self.add_keyword_hash_table();
+            }
         }
 
         self.add_lex_modes_list();
@@ -229,17 +237,13 @@ impl Generator {
         }
 
         // Determine which states should use the "small state" representation, and which should
-        // use the normal array representation.
-        let threshold = cmp::min(SMALL_STATE_THRESHOLD, self.parse_table.symbols.len() / 2);
-        self.large_state_count = self
-            .parse_table
-            .states
-            .iter()
-            .enumerate()
-            .take_while(|(i, s)| {
-                *i <= 1 || s.terminal_entries.len() + s.nonterminal_entries.len() > threshold
-            })
-            .count();
+        // use the normal array representation, unless a profile-guided layout has already
+        // chosen the number of large states.
+        if self.large_state_count == 0 {
+            self.large_state_count = (0..self.parse_table.states.len())
+                .take_while(|i| is_large_state(&self.parse_table, *i))
+                .count();
+        }
     }
 
     fn add_includes(&mut self) {
@@ -637,13 +641,31 @@ impl Generator {
         add_line!(self, "");
     }
 
+    fn add_lex_function_with_style(
+        &mut self,
+        name: &str,
+        lex_table: LexTable,
+        extract_helper_functions: bool,
+    ) {
+        // The table representation encodes lex state ids in 15 bits, so very
+        // large lex tables always use the `switch` representation.
+        match self.lexer_style {
+            LexerStyle::Table
+                if !lex_table.states.is_empty()
+                    && lex_table.states.len() < LEX_TABLE_SKIP as usize =>
+            {
+                self.add_lex_table_function(name, lex_table)
+            }
+            _ => self.add_lex_function(name, lex_table, extract_helper_functions),
+        }
+    }
+
     fn add_lex_function(
         &mut self,
         name: &str,
         lex_table: LexTable,
         extract_helper_functions: bool,
     ) {
-        let mut ruled_out_chars = HashSet::new();
         let mut large_character_sets = Vec::<LargeCharacterSetInfo>::new();
 
         // For each lex state, compute a summary of the code that needs to be
@@ -652,24 +674,13 @@ impl Generator {
             .states
             .iter()
             .map(|state| {
-                ruled_out_chars.clear();
-
                 // For each state transition, compute the set of character ranges
                 // that need to be checked.
                 state
                     .advance_actions
                     .iter()
-                    .map(|(chars, action)| {
-                        let is_included = !chars.contains(std::char::MAX);
-                        let mut ranges;
-                        if is_included {
-                            ranges = chars.simplify_ignoring(&ruled_out_chars);
-                            ruled_out_chars.extend(chars.iter());
-                        } else {
-                            ranges = chars.clone().negate().simplify_ignoring(&ruled_out_chars);
-                            ranges.insert(0, '\0'..'\0')
-                        }
-
+                    .zip(lex_state_character_ranges(state))
+                    .map(|((_, action), (is_included, ranges))| {
                         // Record any large character sets so that they can be extracted
                         // into helper functions, reducing code duplication.
                         let mut call_id = None;
@@ -760,6 +771,227 @@ impl Generator {
         add_line!(self, "");
     }
 
+    fn add_lex_table_function(&mut self, name: &str, lex_table: LexTable) {
+        let state_character_ranges: Vec<Vec<(bool, Vec<Range<char>>)>> = lex_table
+            .states
+            .iter()
+            .map(lex_state_character_ranges)
+            .collect();
+
+        // Split the code points into segments within which every lex state
+        // behaves identically.
+        let mut boundaries = vec![0, 256, CHARACTER_COUNT];
+        for (_, ranges) in state_character_ranges.iter().flatten() {
+            for range in ranges {
+                boundaries.push(range.start as u32);
+                boundaries.push(range.end as u32 + 1);
+            }
+        }
+        boundaries.sort_unstable();
+        boundaries.dedup();
+
+        // Compute each lex state's transition for every segment, using `None`
+        // to represent invalid characters. The matching rules mirror the
+        // conditions generated by `add_character_range_conditions`, so that
+        // both lexer styles behave identically.
+        let mut segments: Vec<Option<u32>> = boundaries[0..boundaries.len() - 1]
+            .iter()
+            .map(|c| Some(*c))
+            .collect();
+        segments.push(None);
+        let columns: Vec<Vec<u16>> = segments
+            .iter()
+            .map(|c| {
+                lex_table
+                    .states
+                    .iter()
+                    .zip(state_character_ranges.iter())
+                    .map(|(state, character_ranges)| {
+                        let index = character_ranges.iter().position(|(is_included, ranges)| {
+                            if ranges.is_empty() {
+                                return *is_included;
+                            }
+                            match c {
+                                Some(c) => {
+                                    let in_ranges = ranges
+                                        .iter()
+                                        .any(|r| r.start as u32 <= *c && *c <= r.end as u32);
+                                    in_ranges == *is_included
+                                }
+                                None => {
+                                    !*is_included
+                                        && !ranges
+                                            .iter()
+                                            .any(|r| r.start == '\0' && r.end as u32 > 1)
+                                }
+                            }
+                        });
+                        index.map_or(0, |index| {
+                            let action = &state.advance_actions[index].1;
+                            let mut transition = action.state as u16 + 1;
+                            if !action.in_main_token {
+                                transition |= LEX_TABLE_SKIP;
+                            }
+                            transition
+                        })
+                    })
+                    .collect()
+            })
+            .collect();
+
+        // Group the segments into character classes.
+        let mut class_ids_by_column = HashMap::new();
+        let mut segment_classes = Vec::with_capacity(segments.len());
+        let mut class_columns = Vec::new();
+        for column in &columns {
+            let class_id = *class_ids_by_column.entry(column).or_insert_with(|| {
+                class_columns.push(column);
+                class_columns.len() - 1
+            });
+            segment_classes.push(class_id);
+        }
+        let invalid_class = segment_classes.pop().unwrap();
+
+        // Deduplicate the lex states' rows of transitions.
+        let mut row_ids_by_row = HashMap::new();
+        let mut rows = Vec::new();
+        let state_rows: Vec<usize> = (0..lex_table.states.len())
+            .map(|i| {
+                let row: Vec<u16> = class_columns.iter().map(|column| column[i]).collect();
+                *row_ids_by_row.entry(row.clone()).or_insert_with(|| {
+                    rows.push(row);
+                    rows.len() - 1
+                })
+            })
+            .collect();
+
+        add_line!(
+            self,
+            "static const uint16_t {}_character_classes[256] = {{",
+            name
+        );
+        indent!(self);
+        let mut byte_classes = Vec::with_capacity(256);
+        for (i, class_id) in segment_classes.iter().enumerate() {
+            for _ in boundaries[i]..cmp::min(boundaries[i + 1], 256) {
+                byte_classes.push(*class_id);
+            }
+        }
+        for line in byte_classes.chunks(16) {
+            add_whitespace!(self);
+            for class_id in line {
+                add!(self, "{}, ", class_id);
+            }
+            self.buffer.pop();
+            add!(self, "\n");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        let mut character_ranges: Vec<(u32, u32, usize)> = Vec::new();
+        for (i, class_id) in segment_classes.iter().enumerate() {
+            if boundaries[i] < 256 {
+                continue;
+            }
+            match character_ranges.last_mut() {
+                Some(last) if last.2 == *class_id => last.1 = boundaries[i + 1] - 1,
+                _ => character_ranges.push((boundaries[i], boundaries[i + 1] - 1, *class_id)),
+            }
+        }
+        add_line!(
+            self,
+            "static const TSLexTableRange {}_character_ranges[] = {{",
+            name
+        );
+        indent!(self);
+        for (start, end, class_id) in &character_ranges {
+            add_line!(self, "{{{:#x}, {:#x}, {}}},", start, end, class_id);
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(self, "static const TSLexTableState {}_states[] = {{", name);
+        indent!(self);
+        for (i, state) in lex_table.states.iter().enumerate() {
+            add_whitespace!(self);
+            add!(self, "[{}] = {{.row = {}", i, state_rows[i]);
+            if let Some(accept_action) = state.accept_action {
+                add!(
+                    self,
+                    ", .accept_symbol = {}, .accepts = true",
+                    self.symbol_ids[&accept_action]
+                );
+            }
+            if let Some(eof_action) = &state.eof_action {
+                add!(self, ", .eof_transition = {}", eof_action.state + 1);
+            }
+            add!(self, "}},\n");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static const uint16_t {}_transitions[{}][{}] = {{",
+            name,
+            rows.len(),
+            class_columns.len()
+        );
+        indent!(self);
+        for (i, row) in rows.iter().enumerate() {
+            add_line!(self, "[{}] = {{", i);
+            indent!(self);
+            for line in row.chunks(16) {
+                add_whitespace!(self);
+                for transition in line {
+                    add!(self, "{}, ", transition);
+                }
+                self.buffer.pop();
+                add!(self, "\n");
+            }
+            dedent!(self);
+            add_line!(self, "}},");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(self, "static const TSLexTable {}_table = {{", name);
+        indent!(self);
+        add_line!(self, ".character_classes = {}_character_classes,", name);
+        add_line!(self, ".ranges = {}_character_ranges,", name);
+        add_line!(self, ".range_count = {},", character_ranges.len());
+        add_line!(self, ".invalid_character_class = {},", invalid_class);
+        add_line!(self, ".character_class_count = {},", class_columns.len());
+        add_line!(self, ".states = {}_states,", name);
+        add_line!(
+            self,
+            ".transitions = (const uint16_t *){}_transitions,",
+            name
+        );
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static bool {}(TSLexer *lexer, TSStateId state) {{",
+            name
+        );
+        indent!(self);
+        add_line!(
+            self,
+            "return ts_lex_table_run(&{}_table, lexer, state);",
+            name
+        );
+        dedent!(self);
+        add_line!(self, "}}");
+        add_line!(self, "");
+    }
+
     fn symbol_for_advance_action(
         &self,
         action: &AdvanceAction,
@@ -961,6 +1193,50 @@ impl Generator {
         }
     }
 
+    fn add_keyword_hash_table(&mut self) {
+        let keyword_table = self.keyword_table.as_ref().unwrap();
+
+        add_line!(
+            self,
+            "static const TSKeywordEntry ts_keyword_entries[{}] = {{",
+            keyword_table.entries.len()
+        );
+        indent!(self);
+        for (i, entry) in keyword_table.entries.iter().enumerate() {
+            if let Some((string, symbol)) = entry {
+                add_line!(
+                    self,
+                    "[{}] = {{\"{}\", {}, {}}},",
+                    i,
+                    self.sanitize_string(string),
+                    string.len(),
+                    self.symbol_ids[symbol]
+                );
+            }
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+
+        add_line!(
+            self,
+            "static const uint16_t ts_keyword_displacements[{}] = {{",
+            keyword_table.displacements.len()
+        );
+        indent!(self);
+        for line in keyword_table.displacements.chunks(16) {
+            add_whitespace!(self);
+            for displacement in line {
+                add!(self, "{}, ", displacement);
+            }
+            self.buffer.pop();
+            add!(self, "\n");
+        }
+        dedent!(self);
+        add_line!(self, "}};");
+        add_line!(self, "");
+    }
+
     fn add_lex_modes_list(&mut self) {
         add_line!(self, "static TSLexMode ts_lex_modes[STATE_COUNT] = {{");
         indent!(self);
@@ -1129,28 +1405,24 @@ impl Generator {
 
             let mut index = 0;
             let mut small_state_indices = Vec::new();
+            let mut values_by_symbol = Vec::new();
             let mut symbols_by_value: HashMap<(usize, SymbolType), Vec<Symbol>> = HashMap::new();
             for state in self.parse_table.states.iter().skip(self.large_state_count) {
                 small_state_indices.push(index);
+                values_by_symbol.clear();
                 symbols_by_value.clear();
 
                 terminal_entries.clear();
                 terminal_entries.extend(state.terminal_entries.iter());
                 terminal_entries.sort_unstable_by_key(|e| self.symbol_order.get(e.0));
 
-                // In a given parse state, many lookahead symbols have the same actions.
-                // So in the "small state" representation, group symbols by their action
-                // in order to avoid repeating the action.
                 for (symbol, entry) in &terminal_entries {
                     let entry_id = self.get_parse_action_list_id(
                         entry,
                         &mut parse_table_entries,
                         &mut next_parse_action_list_index,
                     );
-                    symbols_by_value
-                        .entry((entry_id, SymbolType::Terminal))
-                        .or_default()
-                        .push(**symbol);
+                    values_by_symbol.push((**symbol, (entry_id, SymbolType::Terminal)));
                 }
                 for (symbol, action) in &state.nonterminal_entries {
                     let state_id = match action {
@@ -1159,10 +1431,38 @@ impl Generator {
                             self.large_state_count + small_state_indices.len() - 1
                         }
                     };
-                    symbols_by_value
-                        .entry((state_id, SymbolType::NonTerminal))
-                        .or_default()
-                        .push(*symbol);
+                    values_by_symbol.push((*symbol, (state_id, SymbolType::NonTerminal)));
+                }
+
+                // In the newer "sorted" representation, every symbol is listed in
+                // ascending order, followed by the value for each symbol, so that the
+                // runtime can binary search for a given symbol.
+                if self.next_abi {
+                    values_by_symbol.sort_unstable_by_key(|(symbol, _)| self.symbol_order[symbol]);
+
+                    add_line!(self, "[{}] = {},", index, values_by_symbol.len());
+                    indent!(self);
+                    for (symbol, _) in &values_by_symbol {
+                        add_line!(self, "{},", self.symbol_ids[symbol]);
+                    }
+                    for (_, (value, kind)) in &values_by_symbol {
+                        if *kind == SymbolType::NonTerminal {
+                            add_line!(self, "STATE({}),", value);
+                        } else {
+                            add_line!(self, "ACTIONS({}),", value);
+                        }
+                    }
+                    dedent!(self);
+
+                    index += 1 + 2 * values_by_symbol.len();
+                    continue;
+                }
+
+                // In a given parse state, many lookahead symbols have the same actions.
+                // So in the "small state" representation, group symbols by their action
+                // in order to avoid repeating the action.
+                for (symbol, value) in &values_by_symbol {
+                    symbols_by_value.entry(*value).or_default().push(*symbol);
                 }
 
                 let mut values_with_symbols = symbols_by_value.drain().collect::<Vec<_>>();
@@ -1380,6 +1680,25 @@ impl Generator {
             );
         }
 
+        if self.next_abi {
+            if let Some(keyword_table) = &self.keyword_table {
+                add_line!(self, ".keyword_hash = {{");
+                indent!(self);
+                add_line!(self, ".entries = ts_keyword_entries,");
+                add_line!(self, ".displacements = ts_keyword_displacements,");
+                add_line!(
+                    self,
+                    ".bucket_count = {},",
+                    keyword_table.displacements.len()
+                );
+                add_line!(self, ".slot_count = {},", keyword_table.entries.len());
+                add_line!(self, ".seed = {},", keyword_table.seed);
+                add_line!(self, ".max_length = {},", keyword_table.max_length);
+                dedent!(self);
+                add_line!(self, "}},");
+            }
+        }
+
         if !self.syntax_grammar.external_tokens.is_empty() {
             add_line!(self, ".external_scanner = {{");
             indent!(self);
@@ -1585,6 +1904,38 @@ impl Generator {
     }
 }
 
+// For each of a lex state's transitions, compute the set of character ranges
+// that need to be checked, and whether the lookahead character should be
+// included in or excluded from those ranges.
+fn lex_state_character_ranges(state: &LexState) -> Vec<(bool, Vec<Range<char>>)> {
+    let mut ruled_out_chars = HashSet::new();
+    state
+        .advance_actions
+        .iter()
+        .map(|(chars, _)| {
+            let is_included = !chars.contains(std::char::MAX);
+            let mut ranges;
+            if is_included {
+                ranges = chars.simplify_ignoring(&ruled_out_chars);
+                ruled_out_chars.extend(chars.iter());
+            } else {
+                ranges = chars.clone().negate().simplify_ignoring(&ruled_out_chars);
+                ranges.insert(0, '\0'..'\0')
+            }
+            (is_included, ranges)
+        })
+        .collect()
+}
+
+/// Determine whether a parse state has enough entries that it should be stored
+/// in the normal array representation, instead of the "small state" representation.
+/// The error state and the start state are always stored as large states.
+pub(crate) fn is_large_state(parse_table: &ParseTable, state_id: ParseStateId) -> bool {
+    let threshold = cmp::min(SMALL_STATE_THRESHOLD, parse_table.symbols.len() / 2);
+    let state = &parse_table.states[state_id];
+    state_id <= 1 || state.terminal_entries.len() + state.nonterminal_entries.len() > threshold
+}
+
 /// Returns a String of C code for the given components of a parser.
 ///
 /// # Arguments
@@ -1593,6 +1944,8 @@ impl Generator {
 /// * `parse_table` - The generated parse table for the language
 /// * `main_lex_table` - The generated lexing table for the language
 /// * `keyword_lex_table` - The generated keyword lexing table for the language
+/// * `keyword_table` - A perfect hash table of the language's keywords, if they
+///    form a small, finite set of strings.
 /// * `keyword_capture_token` - A symbol indicating which token is used
 ///    for keyword capture, if any.
 /// * `syntax_grammar` - The syntax grammar extracted from the language's grammar
@@ -1602,25 +1955,33 @@ impl Generator {
 ///    are the aliases that are applied to those symbols.
 /// * `next_abi` - A boolean indicating whether to opt into the new, unstable parse
 ///    table format. This is mainly used for testing, when developing Tree-sitter itself.
+/// * `lexer_style` - Whether to generate the lex functions as `switch` statements
+///    or as transition tables that are interpreted at runtime.
+/// * `large_state_count` - The number of leading parse states to store in the
+///    normal array representation, if it was chosen by a profile-guided layout.
 pub(crate) fn render_c_code(
     name: &str,
     parse_table: ParseTable,
     main_lex_table: LexTable,
     keyword_lex_table: LexTable,
+    keyword_table: Option<KeywordTable>,
     keyword_capture_token: Option<Symbol>,
     syntax_grammar: SyntaxGrammar,
     lexical_grammar: LexicalGrammar,
     default_aliases: AliasMap,
     next_abi: bool,
+    lexer_style: LexerStyle,
+    large_state_count: Option<usize>,
 ) -> String {
     Generator {
         buffer: String::new(),
         indent_level: 0,
         language_name: name.to_string(),
-        large_state_count: 0,
+        large_state_count: large_state_count.unwrap_or(0),
         parse_table,
         main_lex_table,
         keyword_lex_table,
+        keyword_table,
         keyword_capture_token,
         syntax_grammar,
         lexical_grammar,
@@ -1631,6 +1992,7 @@ pub(crate) fn render_c_code(
         symbol_map: HashMap::new(),
         unique_aliases: Vec::new(),
         field_names: Vec::new(),
+        lexer_style,
         next_abi,
     }
     .generate()
@@ -83,6 +83,14 @@ pub(crate) struct LexTable {
     pub states: Vec<LexState>,
 }
 
+#[derive(Debug, Default, PartialEq, Eq)]
+pub(crate) struct KeywordTable {
+    pub seed: u32,
+    pub displacements: Vec<u16>,
+    pub entries: Vec<Option<(String, Symbol)>>,
+    pub max_length: usize,
+}
+
 impl ParseTableEntry {
     pub fn new() -> Self {
         Self {
@@ -43,6 +43,20 @@ fn run() -> error::Result<()> {
                 .arg(Arg::with_name("log").long("log"))
                 .arg(Arg::with_name("prev-abi").long("prev-abi"))
                 .arg(Arg::with_name("no-bindings").long("no-bindings"))
+                .arg(
+                    Arg::with_name("lexer")
+                        .long("lexer")
+                        .value_name("style")
+                        .takes_value(true)
+                        .possible_values(&["switch", "table"]),
+                )
+                .arg(
+                    Arg::with_name("profile")
+                        .help("Lay out the parse table using a profile written by `parse --profile`")
+                        .long("profile")
+                        .value_name("file")
+                        .takes_value(true),
+                )
                 .arg(
                     Arg::with_name("report-states-for-rule")
                         .long("report-states-for-rule")
@@ -69,6 +83,13 @@ fn run() -> error::Result<()> {
                 .arg(Arg::with_name("stat").long("stat").short("s"))
                 .arg(Arg::with_name("time").long("time").short("t"))
                 .arg(Arg::with_name("timeout").long("timeout").takes_value(true))
+                .arg(
+                    Arg::with_name("profile")
+                        .help("Write the number of times each parse state and lex state was used to a file")
+                        .long("profile")
+                        .value_name("file")
+                        .takes_value(true),
+                )
                 .arg(
                     Arg::with_name("edits")
                         .long("edit")
@@ -189,12 +210,18 @@ fn run() -> error::Result<()> {
         }
         let new_abi = !matches.is_present("prev-abi");
         let generate_bindings = !matches.is_present("no-bindings");
+        let lexer_style = match matches.value_of("lexer") {
+            Some("table") => generate::LexerStyle::Table,
+            _ => generate::LexerStyle::Switch,
+        };
         generate::generate_parser_in_directory(
             &current_dir,
             grammar_path,
             new_abi,
             generate_bindings,
             report_symbol_name,
+            lexer_style,
+            matches.value_of("profile"),
         )?;
     } else if let Some(matches) = matches.subcommand_matches("test") {
         let debug = matches.is_present("debug");
@@ -254,6 +281,8 @@ fn run() -> error::Result<()> {
 
         let should_track_stats = matches.is_present("stat");
         let mut stats = parse::Stats::default();
+        let profile_path = matches.value_of("profile");
+        let mut profile = generate::ParseTableProfile::default();
 
         for path in paths {
             let path = Path::new(&path);
@@ -272,6 +301,7 @@ fn run() -> error::Result<()> {
                 debug_graph,
                 debug_xml,
                 Some(&cancellation_flag),
+                profile_path.map(|_| &mut profile),
             )?;
 
             if should_track_stats {
@@ -288,6 +318,10 @@ fn run() -> error::Result<()> {
             println!("{}", stats)
         }
 
+        if let Some(profile_path) = profile_path {
+            fs::write(profile_path, serde_json::to_string(&profile)?)?;
+        }
+
         if has_error {
             return Error::err(String::new());
         }
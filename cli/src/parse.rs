@@ -1,11 +1,12 @@
 use super::error::{Error, Result};
+use super::generate::ParseTableProfile;
 use super::util;
 use std::io::{self, Write};
 use std::path::Path;
 use std::sync::atomic::AtomicUsize;
 use std::time::Instant;
 use std::{fmt, fs, usize};
-use tree_sitter::{InputEdit, Language, LogType, Parser, Point, Tree};
+use tree_sitter::{InputEdit, Language, LogType, ParseProfile, Parser, Point, Tree};
 
 #[derive(Debug)]
 pub struct Edit {
@@ -42,6 +43,7 @@ pub fn parse_file_at_path(
     debug_graph: bool,
     debug_xml: bool,
     cancellation_flag: Option<&AtomicUsize>,
+    profile: Option<&mut ParseTableProfile>,
 ) -> Result<bool> {
     let mut _log_session = None;
     let mut parser = Parser::new();
@@ -57,6 +59,9 @@ pub fn parse_file_at_path(
     // Set a timeout based on the `--time` flag.
     parser.set_timeout_micros(timeout);
 
+    // Record a profile of the parse table if `--profile` was passed.
+    parser.set_profiling_enabled(profile.is_some());
+
     // Render an HTML graph if `--debug-graph` was passed
     if debug_graph {
         _log_session = Some(util::log_graphs(&mut parser, "log.html")?);
@@ -96,6 +101,10 @@ pub fn parse_file_at_path(
         let duration_ms = duration.as_secs() * 1000 + duration.subsec_nanos() as u64 / 1000000;
         let mut cursor = tree.walk();
 
+        if let Some(profile) = profile {
+            add_to_profile(profile, parser.profile())?;
+        }
+
         if !quiet {
             let mut needs_newline = false;
             let mut indent_level = 0;
@@ -273,6 +282,33 @@ pub fn parse_file_at_path(
     Ok(false)
 }
 
+fn add_to_profile(total: &mut ParseTableProfile, profile: ParseProfile) -> Result<()> {
+    let ParseProfile {
+        parse_state_hits,
+        lex_state_hits,
+    } = profile;
+    if total.parse_state_hits.is_empty() {
+        total.parse_state_hits = parse_state_hits;
+        total.lex_state_hits = lex_state_hits;
+        return Ok(());
+    }
+    if total.parse_state_hits.len() != parse_state_hits.len()
+        || total.lex_state_hits.len() != lex_state_hits.len()
+    {
+        return Error::err(
+            "All of the files must be parsed with the same language in order to record a profile"
+                .to_string(),
+        );
+    }
+    for (count, hits) in total.parse_state_hits.iter_mut().zip(parse_state_hits) {
+        *count += hits;
+    }
+    for (count, hits) in total.lex_state_hits.iter_mut().zip(lex_state_hits) {
+        *count += hits;
+    }
+    Ok(())
+}
+
 pub fn perform_edit(tree: &mut Tree, input: &mut Vec<u8>, edit: &Edit) -> InputEdit {
     let start_byte = edit.position;
     let old_end_byte = edit.position + edit.deleted_length;
@@ -3,8 +3,9 @@ use super::helpers::fixtures::{fixtures_dir, get_language, get_test_language};
 use super::helpers::random::Rand;
 use crate::generate::generate_parser_for_grammar;
 use crate::parse::perform_edit;
-use std::fs;
-use tree_sitter::{Node, Parser, Point, Tree};
+use std::sync::Arc;
+use std::{fs, thread};
+use tree_sitter::{InputEdit, Node, Parser, Point, Tree};
 
 const JSON_EXAMPLE: &'static str = r#"
 
@@ -248,6 +249,98 @@ fn test_node_parent_of_child_by_field_name() {
     );
 }
 
+#[test]
+fn test_node_parent_on_multiple_threads() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    let source = "function a(b) { return [b, {c: d}, e(f)]; }\n".repeat(50);
+    let tree = Arc::new(parser.parse(&source, None).unwrap());
+
+    // Several threads can find nodes' parents in the same tree at once,
+    // sharing the tree's parent cache.
+    let threads = (0..4)
+        .map(|i| {
+            let tree = tree.clone();
+            thread::spawn(move || {
+                let mut cursor = tree.walk();
+                let mut parents = Vec::new();
+                let mut visited_count = i;
+                loop {
+                    let node = cursor.node();
+                    if visited_count % 4 == 0 {
+                        assert_eq!(node.parent().as_ref(), parents.last());
+                    }
+                    visited_count += 1;
+
+                    if cursor.goto_first_child() {
+                        parents.push(node);
+                        continue;
+                    }
+                    while !cursor.goto_next_sibling() {
+                        if !cursor.goto_parent() {
+                            return;
+                        }
+                        parents.pop();
+                    }
+                }
+            })
+        })
+        .collect::<Vec<_>>();
+    for thread in threads {
+        thread.join().unwrap();
+    }
+}
+
+#[test]
+fn test_node_parent_and_siblings_with_index() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    let source = "function a(b) { return [b, {c: d}, e(f)]; }\nclass G { h() { i++; } }\n";
+    let mut tree = parser.parse(source, None).unwrap();
+
+    fn collect<'a>(node: Node<'a>, nodes: &mut Vec<Node<'a>>) {
+        nodes.push(node);
+        for i in 0..node.child_count() {
+            collect(node.child(i).unwrap(), nodes);
+        }
+    }
+
+    fn navigate(tree: &Tree) -> Vec<Vec<Option<usize>>> {
+        let mut nodes = Vec::new();
+        collect(tree.root_node(), &mut nodes);
+        nodes
+            .iter()
+            .map(|node| {
+                vec![
+                    node.parent(),
+                    node.next_sibling(),
+                    node.prev_sibling(),
+                    node.next_named_sibling(),
+                    node.prev_named_sibling(),
+                ]
+                .into_iter()
+                .map(|n| n.map(|n| n.id()))
+                .collect()
+            })
+            .collect()
+    }
+
+    let expected = navigate(&tree);
+    tree.build_index();
+    assert_eq!(navigate(&tree), expected);
+
+    // Editing the tree discards the index.
+    tree.edit(&InputEdit {
+        start_byte: 0,
+        old_end_byte: 0,
+        new_end_byte: 0,
+        start_position: Point::new(0, 0),
+        old_end_position: Point::new(0, 0),
+        new_end_position: Point::new(0, 0),
+    });
+    assert_eq!(navigate(&tree), expected);
+}
+
 #[test]
 fn test_node_child_by_field_name_with_extra_hidden_children() {
     let mut parser = Parser::new();
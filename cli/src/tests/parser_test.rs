@@ -1,10 +1,19 @@
 use super::helpers::edits::ReadRecorder;
-use super::helpers::fixtures::{get_language, get_test_grammar, get_test_language};
-use crate::generate::generate_parser_for_grammar;
+use super::helpers::fixtures::{fixtures_dir, get_language, get_test_grammar, get_test_language};
+use crate::generate::{
+    generate_parser_for_grammar, generate_parser_for_grammar_with_lexer_style, LexerStyle,
+};
 use crate::parse::{perform_edit, Edit};
+use std::alloc;
+use std::collections::{HashMap, HashSet};
+use std::os::raw::c_void;
 use std::sync::atomic::{AtomicUsize, Ordering};
-use std::{thread, time};
-use tree_sitter::{allocations, IncludedRangesError, InputEdit, LogType, Parser, Point, Range};
+use std::sync::Mutex;
+use std::{fs, thread, time};
+use tree_sitter::{
+    allocations, Allocator, IncludedRangesError, InputEdit, Language, LogType, Node, ParseProfile,
+    Parser, Point, Range, Tree,
+};
 
 #[test]
 fn test_parsing_simple_string() {
@@ -138,6 +147,73 @@ fn test_parsing_with_custom_utf8_input() {
     assert_eq!(root.child(0).unwrap().kind(), "function_item");
 }
 
+#[test]
+fn test_parsing_a_string_and_parsing_with_a_callback_match() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    let source = "const s = '\u{e9}\u{20ac}\u{1f600}';\n\n  /* \u{fffd} */ f(s, `${x}`)\r\n";
+    let bytes = source.as_bytes();
+
+    // Parsing a string uses a faster lexing path than the input callback,
+    // but it produces the same tree, even when the callback returns
+    // chunks that split multi-byte characters.
+    let tree = parser.parse(source, None).unwrap();
+    let callback_tree = parser
+        .parse_with(&mut |i, _| &bytes[i..(i + 5).min(bytes.len())], None)
+        .unwrap();
+    assert_eq!(tree.root_node().to_sexp(), callback_tree.root_node().to_sexp());
+    assert_eq!(
+        tree.root_node().end_position(),
+        callback_tree.root_node().end_position()
+    );
+    assert_eq!(tree.root_node().has_error(), false);
+}
+
+#[test]
+fn test_parsing_with_a_table_driven_lexer() {
+    let grammar_path = fixtures_dir()
+        .join("grammars")
+        .join("json")
+        .join("src")
+        .join("grammar.json");
+    let mut grammar: serde_json::Value =
+        serde_json::from_str(&fs::read_to_string(&grammar_path).unwrap()).unwrap();
+
+    let mut get_language_with_lexer_style = |name: &str, lexer_style| {
+        grammar["name"] = name.into();
+        let (parser_name, parser_code) =
+            generate_parser_for_grammar_with_lexer_style(&grammar.to_string(), lexer_style)
+                .unwrap();
+        get_test_language(&parser_name, &parser_code, None)
+    };
+    let switch_language = get_language_with_lexer_style("json_switch_lexer", LexerStyle::Switch);
+    let table_language = get_language_with_lexer_style("json_table_lexer", LexerStyle::Table);
+
+    let mut switch_parser = Parser::new();
+    switch_parser.set_language(switch_language).unwrap();
+    let mut table_parser = Parser::new();
+    table_parser.set_language(table_language).unwrap();
+
+    // Both lexer styles accept exactly the same tokens, including invalid ones.
+    for source in &[
+        "{\"a\": [1, -2.5e3, true, null, \"\\u00e9\\n\"]}",
+        "[\"\u{e9}\u{20ac}\u{1f600}\", 0x1, @, \"unterminated]\n",
+        "\u{feff} { \"\u{2028}\": {}} \u{0}",
+    ] {
+        let switch_tree = switch_parser.parse(source, None).unwrap();
+        let table_tree = table_parser.parse(source, None).unwrap();
+        assert_eq!(
+            switch_tree.root_node().to_sexp(),
+            table_tree.root_node().to_sexp()
+        );
+        assert_eq!(
+            switch_tree.root_node().end_byte(),
+            table_tree.root_node().end_byte()
+        );
+    }
+}
+
 #[test]
 fn test_parsing_with_custom_utf16_input() {
     let mut parser = Parser::new();
@@ -483,6 +559,47 @@ h + i
     );
 }
 
+#[test]
+fn test_parsing_after_editing_tokens_with_long_padding_and_size() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+
+    let indent = " ".repeat(600);
+    let long_string = format!("\"{}\"", "a".repeat(2000));
+    let mut code = format!("[\n\n{}1,\n{}{}\n]", indent, indent, long_string).into_bytes();
+    let mut tree = parser.parse(&code, None).unwrap();
+
+    let array = tree.root_node().child(0).unwrap();
+    let number = array.named_child(0).unwrap();
+    let string = array.named_child(1).unwrap();
+    assert_eq!(number.start_position(), Point::new(2, 600));
+    assert_eq!(number.start_byte(), 603);
+    assert_eq!(string.start_position(), Point::new(3, 600));
+    assert_eq!(string.end_position(), Point::new(3, 2602));
+    assert_eq!(string.end_byte() - string.start_byte(), 2002);
+
+    perform_edit(
+        &mut tree,
+        &mut code,
+        &Edit {
+            position: 1,
+            deleted_length: 0,
+            inserted_text: b"\n\n\n".to_vec(),
+        },
+    );
+    let tree = parser.parse(&code, Some(&tree)).unwrap();
+    let fresh_tree = parser.parse(&code, None).unwrap();
+    assert_eq!(tree.root_node().to_sexp(), fresh_tree.root_node().to_sexp());
+
+    let array = tree.root_node().child(0).unwrap();
+    let number = array.named_child(0).unwrap();
+    let string = array.named_child(1).unwrap();
+    assert_eq!(number.start_position(), Point::new(5, 600));
+    assert_eq!(number.start_byte(), 606);
+    assert_eq!(string.start_position(), Point::new(6, 600));
+    assert_eq!(string.end_position(), Point::new(6, 2602));
+}
+
 // Thread safety
 
 #[test]
@@ -536,6 +653,715 @@ fn test_parsing_on_multiple_threads() {
     assert_eq!(child_count_differences, &[1, 2, 3, 4]);
 }
 
+#[test]
+fn test_sharing_a_parsed_tree_between_threads() {
+    allocations::record(|| {
+        let mut code = Vec::new();
+        for i in 0..200 {
+            code.extend(format!("a{:03}([{:03}]);\n", i, i).bytes());
+        }
+
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        let tree = parser.parse(&code, None).unwrap();
+        let expected_sexp = tree.root_node().to_sexp();
+
+        // Each thread repeatedly copies the tree, edits the copy and reparses
+        // it, so the reference counts of the tree's nodes are updated from all
+        // of the threads at once.
+        let threads = (0..8)
+            .map(|thread_index| {
+                let tree = tree.clone();
+                let code = code.clone();
+                thread::spawn(move || {
+                    let mut parser = Parser::new();
+                    parser.set_language(get_language("javascript")).unwrap();
+                    for i in 0..10 {
+                        let mut tree = tree.clone();
+                        let mut code = code.clone();
+                        let line_length = code.len() / 200;
+                        let edit = Edit {
+                            position: line_length * ((thread_index * 25 + i * 7) % 200),
+                            deleted_length: 0,
+                            inserted_text: b"b();\n".to_vec(),
+                        };
+                        perform_edit(&mut tree, &mut code, &edit);
+                        let new_tree = parser.parse(&code, Some(&tree)).unwrap();
+                        drop(tree);
+                        assert_eq!(new_tree.root_node().named_child_count(), 201);
+                        assert!(!new_tree.root_node().has_error());
+                    }
+                })
+            })
+            .collect::<Vec<_>>();
+        for thread in threads {
+            thread.join().unwrap();
+        }
+
+        assert_eq!(tree.root_node().to_sexp(), expected_sexp);
+    });
+}
+
+#[test]
+fn test_parsing_large_file_in_parallel() {
+    let mut source = String::new();
+    for i in 0..20000 {
+        source += &format!("fn function_{}() {{\n    let x = {};\n}}\n\n", i, i);
+
+        // Some lines that look like the start of a top-level item are really
+        // inside of a comment, so chunks that start there can't be joined.
+        if i % 500 == 0 {
+            source += "/*\nfn commented_out() {}\n*/\n";
+        }
+    }
+
+    let mut parser = Parser::new();
+    parser.set_language(get_language("rust")).unwrap();
+    let tree = parser.parse(&source, None).unwrap();
+    for thread_count in 1..5 {
+        let parallel_tree = parser.parse_parallel(&source, thread_count).unwrap();
+        assert_eq!(
+            parallel_tree.root_node().to_sexp(),
+            tree.root_node().to_sexp()
+        );
+        assert_eq!(
+            parallel_tree.root_node().end_position(),
+            tree.root_node().end_position()
+        );
+        assert_eq!(
+            get_node_ranges(parallel_tree.root_node()),
+            get_node_ranges(tree.root_node())
+        );
+    }
+
+    // Syntax errors cause the affected chunks to be reparsed serially.
+    source.insert_str(source.len() / 3, "fn broken( {\n");
+    let tree = parser.parse(&source, None).unwrap();
+    let parallel_tree = parser.parse_parallel(&source, 4).unwrap();
+    assert_eq!(
+        parallel_tree.root_node().to_sexp(),
+        tree.root_node().to_sexp()
+    );
+}
+
+#[test]
+fn test_parsing_in_parallel_with_line_continuations() {
+    // Each chunk is parsed on its own, so JavaScript's external scanner inserts
+    // an automatic semicolon at the end of a chunk, even when the next chunk
+    // starts with a line that continues the expression. Those chunks must not
+    // be joined.
+    let mut source = String::new();
+    for i in 0..40000 {
+        if i % 2 == 0 {
+            source += &format!("a = {}\n+ 2\n", i);
+        } else {
+            source += &format!("b = {};\n", i);
+        }
+    }
+
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    let tree = parser.parse(&source, None).unwrap();
+    for thread_count in 2..8 {
+        let parallel_tree = parser.parse_parallel(&source, thread_count).unwrap();
+        assert_eq!(
+            parallel_tree.root_node().to_sexp(),
+            tree.root_node().to_sexp()
+        );
+        assert_eq!(
+            get_node_ranges(parallel_tree.root_node()),
+            get_node_ranges(tree.root_node())
+        );
+    }
+}
+
+#[test]
+fn test_parsing_a_batch_of_documents() {
+    let sources = (0..200)
+        .map(|i| {
+            if i % 10 == 0 {
+                format!("[{}, ", i)
+            } else {
+                format!("{{\"a\": [{}, true, null]}}", i)
+            }
+        })
+        .collect::<Vec<_>>();
+
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+    let expected_sexps = sources
+        .iter()
+        .map(|source| parser.parse(source, None).unwrap().root_node().to_sexp())
+        .collect::<Vec<_>>();
+
+    for thread_count in 1..4 {
+        let sexps = parser
+            .parse_batch(&sources, thread_count)
+            .into_iter()
+            .map(|tree| tree.unwrap().root_node().to_sexp())
+            .collect::<Vec<_>>();
+        assert_eq!(sexps, expected_sexps);
+    }
+
+    // When the batch is cancelled, none of the remaining documents are parsed.
+    let cancellation_flag = AtomicUsize::new(1);
+    unsafe { parser.set_cancellation_flag(Some(&cancellation_flag)) };
+    let trees = parser.parse_batch(&sources, 2);
+    assert_eq!(trees.len(), sources.len());
+    assert!(trees.iter().all(|tree| tree.is_none()));
+}
+
+#[test]
+fn test_parsing_a_batch_of_documents_with_arena_allocation() {
+    allocations::record(|| {
+        let sources = (0..100)
+            .map(|i| format!("{{\"a\": [{}, true, null]}}", i))
+            .collect::<Vec<_>>();
+
+        let mut parser = Parser::new();
+        parser.set_language(get_language("json")).unwrap();
+        let expected_sexps = sources
+            .iter()
+            .map(|source| parser.parse(source, None).unwrap().root_node().to_sexp())
+            .collect::<Vec<_>>();
+
+        // The trees that each thread parses share one arena, which outlives
+        // any of them.
+        parser.set_arena_enabled(true);
+        for thread_count in 1..3 {
+            let mut trees = parser
+                .parse_batch(&sources, thread_count)
+                .into_iter()
+                .map(|tree| tree.unwrap())
+                .collect::<Vec<_>>();
+            for i in (0..trees.len()).rev().step_by(2) {
+                trees.remove(i);
+            }
+            let sexps = trees
+                .iter()
+                .map(|tree| tree.root_node().to_sexp())
+                .collect::<Vec<_>>();
+            let expected_remaining_sexps = expected_sexps
+                .iter()
+                .step_by(2)
+                .cloned()
+                .collect::<Vec<_>>();
+            assert_eq!(sexps, expected_remaining_sexps);
+
+            // A tree from the batch can be used for incremental parsing.
+            let mut code = sources[0].as_bytes().to_vec();
+            let mut edited_tree = trees.remove(0);
+            perform_edit(
+                &mut edited_tree,
+                &mut code,
+                &Edit {
+                    position: 1,
+                    deleted_length: 0,
+                    inserted_text: b" ".to_vec(),
+                },
+            );
+            let new_tree = parser.parse(&code, Some(&edited_tree)).unwrap();
+            assert_eq!(new_tree.root_node().to_sexp(), expected_sexps[0]);
+        }
+    });
+}
+
+#[test]
+fn test_parsing_reports_stats() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+
+    let mut tree = parser.parse("[1, 2, 3]", None).unwrap();
+    let stats = parser.stats();
+    assert!(stats.shift_count > 0);
+    assert!(stats.reduce_count > 0);
+    assert!(stats.lex_count > 0);
+    assert_eq!(stats.token_cache_hit_count, 0);
+    assert!(stats.token_cache_miss_count > 0);
+    assert_eq!(stats.max_version_count, 1);
+    assert_eq!(stats.recovery_count, 0);
+    assert_eq!(stats.reused_node_count, 0);
+
+    // Every reduction allocates an internal node.
+    assert!(stats.subtree_allocation_count >= stats.reduce_count);
+
+    // During an incremental parse, the unchanged nodes are reused.
+    tree.edit(&InputEdit {
+        start_byte: 1,
+        old_end_byte: 1,
+        new_end_byte: 1,
+        start_position: Point::new(0, 1),
+        old_end_position: Point::new(0, 1),
+        new_end_position: Point::new(0, 1),
+    });
+    parser.parse("[1, 2, 3]", Some(&tree)).unwrap();
+    let stats = parser.stats();
+    assert!(stats.reused_node_count > 0);
+    assert!(stats.reused_byte_count > 0);
+
+    // During error recovery, several stack versions lex at the same position,
+    // so they can share the cached tokens.
+    parser.parse("{\"a\": [1 2 @ 3], }", None).unwrap();
+    let stats = parser.stats();
+    assert!(stats.token_cache_hit_count > 0);
+    assert!(stats.max_version_count > 1);
+    assert!(stats.recovery_count > 0);
+
+    // The statistics are cleared at the start of each parse.
+    parser.parse("[1, 2, 3]", None).unwrap();
+    let stats = parser.stats();
+    assert_eq!(stats.token_cache_hit_count, 0);
+    assert_eq!(stats.recovery_count, 0);
+}
+
+#[test]
+fn test_parsing_with_a_version_limit() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+    assert_eq!(parser.version_limit(), 6);
+
+    // Recovering from this error requires several stack versions.
+    let source = "{\"a\": [1 2 @ 3], }";
+    parser.parse(source, None).unwrap();
+    assert!(parser.stats().max_version_count > 1);
+
+    // With a limit of one version, the parser still produces a tree, but it
+    // has to discard versions along the way.
+    parser.set_version_limit(1);
+    assert_eq!(parser.version_limit(), 1);
+    let tree = parser.parse(source, None).unwrap();
+    assert!(tree.root_node().has_error());
+    assert!(parser.stats().version_limit_hit_count > 0);
+
+    // The limit is never less than one, and is clamped to a maximum.
+    parser.set_version_limit(0);
+    assert_eq!(parser.version_limit(), 1);
+    parser.set_version_limit(usize::MAX);
+    assert_eq!(parser.version_limit(), u16::MAX as usize);
+    let tree = parser.parse(source, None).unwrap();
+    assert!(tree.root_node().has_error());
+    assert_eq!(parser.stats().version_limit_hit_count, 0);
+}
+
+#[test]
+fn test_parsing_records_a_profile() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("json")).unwrap();
+
+    // By default, no profile is recorded.
+    parser.parse("[1, 2, 3]", None).unwrap();
+    assert_eq!(parser.profile(), ParseProfile::default());
+
+    // While profiling, the start state is used for the first token.
+    parser.set_profiling_enabled(true);
+    parser.parse("[1, 2, 3]", None).unwrap();
+    let profile = parser.profile();
+    assert!(profile.parse_state_hits[1] > 0);
+    let parse_state_hit_count = profile.parse_state_hits.iter().sum::<u64>();
+    let lex_state_hit_count = profile.lex_state_hits.iter().sum::<u64>();
+    assert!(lex_state_hit_count > 0);
+
+    // The counts accumulate across parses.
+    parser.parse("[1, 2, 3]", None).unwrap();
+    let profile = parser.profile();
+    assert_eq!(
+        profile.parse_state_hits.iter().sum::<u64>(),
+        2 * parse_state_hit_count
+    );
+    assert_eq!(
+        profile.lex_state_hits.iter().sum::<u64>(),
+        2 * lex_state_hit_count
+    );
+
+    // Enabling profiling again clears the counts.
+    parser.set_profiling_enabled(true);
+    assert_eq!(parser.profile().parse_state_hits.iter().sum::<u64>(), 0);
+    parser.set_profiling_enabled(false);
+    assert_eq!(parser.profile(), ParseProfile::default());
+}
+
+#[test]
+fn test_parsing_with_arena_allocation() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        assert!(!parser.arena_enabled());
+        parser.set_arena_enabled(true);
+        assert!(parser.arena_enabled());
+
+        let mut code = b"const a = {b: [1, 2, 3], c: `d${e}`};\nf(a);".to_vec();
+        let tree = parser.parse(&code, None).unwrap();
+        let expected_sexp = tree.root_node().to_sexp();
+
+        // A tree whose nodes aren't shared is freed all at once.
+        drop(tree);
+        let tree = parser.parse(&code, None).unwrap();
+        assert_eq!(tree.root_node().to_sexp(), expected_sexp);
+
+        // Nodes that are shared with copies and with newer trees outlive the
+        // tree that allocated them.
+        let tree_copy = tree.clone();
+        let mut edited_tree = tree.clone();
+        drop(tree);
+        perform_edit(
+            &mut edited_tree,
+            &mut code,
+            &Edit {
+                position: 0,
+                deleted_length: 0,
+                inserted_text: b"g();\n".to_vec(),
+            },
+        );
+        let new_tree = parser.parse(&code, Some(&edited_tree)).unwrap();
+        drop(edited_tree);
+        drop(tree_copy);
+
+        parser.set_arena_enabled(false);
+        let reference_tree = parser.parse(&code, None).unwrap();
+        assert_eq!(
+            new_tree.root_node().to_sexp(),
+            reference_tree.root_node().to_sexp()
+        );
+    });
+}
+
+#[test]
+fn test_parsing_reuses_the_buffers_of_popped_subtree_arrays() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+
+        let mut code = Vec::new();
+        for i in 0..200 {
+            code.extend(format!("let x{:03} = [{:03}, f({:03})];\n", i, i, i).bytes());
+        }
+
+        for &arena_enabled in &[false, true] {
+            parser.set_arena_enabled(arena_enabled);
+            let mut code = code.clone();
+
+            // The first parse fills the parser's pool of array buffers.
+            parser.parse(&code, None).unwrap();
+
+            let mut parse_and_count_allocations = |code: &[u8], old_tree: Option<&Tree>| {
+                let allocation_count = allocations::allocation_count();
+                let tree = parser.parse(code, old_tree).unwrap();
+                let allocation_count = allocations::allocation_count() - allocation_count;
+                let stats = parser.stats();
+                if arena_enabled {
+                    // Each reduction pops an array of subtrees, which is copied
+                    // into the arena and then kept for a later pop.
+                    assert!(allocation_count * 4 < stats.reduce_count as u64);
+                } else {
+                    // The popped arrays become the storage of the new nodes,
+                    // and the arrays that don't are kept for a later pop.
+                    let new_subtree_count =
+                        stats.subtree_allocation_count - stats.subtree_pool_hit_count;
+                    assert!(allocation_count <= 2 * new_subtree_count as u64 + 16);
+                }
+                tree
+            };
+
+            let mut tree = parse_and_count_allocations(&code, None);
+            let edit = Edit {
+                position: code.len() / 2,
+                deleted_length: 0,
+                inserted_text: b"g(y, [z]);\n".repeat(100),
+            };
+            perform_edit(&mut tree, &mut code, &edit);
+            let new_tree = parse_and_count_allocations(&code, Some(&tree));
+            drop(tree);
+
+            let reference_tree = parser.parse(&code, None).unwrap();
+            assert_eq!(
+                new_tree.root_node().to_sexp(),
+                reference_tree.root_node().to_sexp()
+            );
+        }
+    });
+}
+
+#[test]
+fn test_parsing_with_a_custom_allocator() {
+    // The sizes of the blocks that are currently allocated, by address.
+    #[derive(Default)]
+    struct Blocks(Mutex<HashMap<usize, usize>>);
+
+    impl Blocks {
+        fn contains(&self, address: usize) -> bool {
+            self.0
+                .lock()
+                .unwrap()
+                .iter()
+                .any(|(start, size)| address >= *start && address < start + size)
+        }
+    }
+
+    unsafe extern "C" fn record_malloc(payload: *mut c_void, size: usize) -> *mut c_void {
+        let blocks = &*(payload as *const Blocks);
+        let buffer = alloc::alloc(alloc::Layout::from_size_align(size, 8).unwrap());
+        blocks.0.lock().unwrap().insert(buffer as usize, size);
+        buffer as *mut c_void
+    }
+
+    unsafe extern "C" fn record_free(payload: *mut c_void, buffer: *mut c_void, size: usize) {
+        let blocks = &*(payload as *const Blocks);
+        let allocated_size = blocks.0.lock().unwrap().remove(&(buffer as usize));
+        assert_eq!(allocated_size, Some(size));
+        alloc::dealloc(
+            buffer as *mut u8,
+            alloc::Layout::from_size_align(size, 8).unwrap(),
+        )
+    }
+
+    // Every node except the root is stored in its parent's memory, so its id
+    // is an address within the memory of the tree's nodes.
+    fn descendant_ids(tree: &Tree) -> Vec<usize> {
+        let mut ids = Vec::new();
+        let mut cursor = tree.walk();
+        let mut nodes = vec![tree.root_node()];
+        while let Some(node) = nodes.pop() {
+            for child in node.children(&mut cursor) {
+                ids.push(child.id());
+                nodes.push(child);
+            }
+        }
+        ids
+    }
+
+    let blocks = Blocks::default();
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    assert!(parser.allocator().is_none());
+    unsafe {
+        parser.set_allocator(Some(Allocator {
+            payload: &blocks as *const Blocks as *mut c_void,
+            malloc: record_malloc,
+            free: record_free,
+        }))
+    };
+    assert!(parser.allocator().is_some());
+    assert!(parser.arena_enabled());
+
+    // The nodes are allocated from the allocator's blocks.
+    let code = "const a = {b: [1, 2, 3], c: `d${e}`};\nf(a);";
+    let tree = parser.parse(code, None).unwrap();
+    let ids = descendant_ids(&tree);
+    assert!(ids.len() > 20);
+    assert!(ids.iter().all(|id| blocks.contains(*id)));
+
+    // So are the nodes of a frozen tree.
+    let mut frozen_tree = tree.clone();
+    frozen_tree.freeze();
+    let frozen_ids = descendant_ids(&frozen_tree);
+    assert_eq!(frozen_ids.len(), ids.len());
+    assert!(frozen_ids.iter().all(|id| blocks.contains(*id)));
+    assert!(frozen_ids.iter().all(|id| !ids.contains(id)));
+
+    let tree_copy = tree.clone();
+    drop(tree);
+    drop(frozen_tree);
+
+    // The tree's memory is returned to the allocator that it was created
+    // with, even after the parser stops using that allocator.
+    unsafe { parser.set_allocator(None) };
+    assert!(parser.allocator().is_none());
+    let reference_tree = parser.parse(code, None).unwrap();
+    assert!(descendant_ids(&reference_tree)
+        .iter()
+        .all(|id| !blocks.contains(*id)));
+    assert_eq!(
+        tree_copy.root_node().to_sexp(),
+        reference_tree.root_node().to_sexp()
+    );
+    drop(tree_copy);
+    drop(parser);
+    assert!(blocks.0.lock().unwrap().is_empty());
+}
+
+#[test]
+#[cfg(unix)]
+fn test_parsing_publishes_every_node_of_the_tree() {
+    // The finished tree's debug graph is written once the parse has marked
+    // its nodes as public, and shows whether each node's reference count is
+    // still private to the parse.
+    fn parse_with_graph(
+        parser: &mut Parser,
+        source: &[u8],
+        old_tree: Option<&Tree>,
+    ) -> (Tree, String) {
+        let (tree, graphs) = parse_with_dot_graphs(parser, source, old_tree);
+        let start = graphs.rfind("digraph tree {").unwrap();
+        (tree, graphs[start..].to_string())
+    }
+
+    let mut source = Vec::new();
+    for i in 0..100 {
+        source.extend(format!("let x{:02} = [{:02}, f({:02})];\n", i, i, i).bytes());
+    }
+
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    for &arena_enabled in &[false, true] {
+        parser.set_arena_enabled(arena_enabled);
+        let mut source = source.clone();
+        let (mut tree, graph) = parse_with_graph(&mut parser, &source, None);
+        assert!(graph.contains("private: 0"));
+        assert!(!graph.contains("private: 1"));
+
+        // The new tree mixes nodes from the old tree with nodes that were
+        // created during the reparse.
+        let edit = Edit {
+            position: source.len() / 2,
+            deleted_length: 0,
+            inserted_text: b"g();\n".repeat(20),
+        };
+        perform_edit(&mut tree, &mut source, &edit);
+        let (_, graph) = parse_with_graph(&mut parser, &source, Some(&tree));
+        assert!(graph.contains("private: 0"));
+        assert!(!graph.contains("private: 1"));
+    }
+}
+
+#[test]
+fn test_parsing_after_an_edit_rebalances_without_changing_the_old_tree() {
+    // A node's id is the address at which its parent stores it, so the nodes
+    // whose parents are shared by two trees have the same id in both trees.
+    fn grandchild_ids(tree: &Tree) -> Vec<usize> {
+        let mut cursor = tree.walk();
+        let statements = tree.root_node().children(&mut cursor).collect::<Vec<_>>();
+        statements
+            .into_iter()
+            .flat_map(|statement| {
+                let mut cursor = statement.walk();
+                statement
+                    .children(&mut cursor)
+                    .map(|child| child.id())
+                    .collect::<Vec<_>>()
+            })
+            .collect()
+    }
+
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+
+        let mut code = Vec::new();
+        for i in 0..400 {
+            code.extend(format!("a{:03}();\n", i).bytes());
+        }
+
+        for &arena_enabled in &[false, true] {
+            parser.set_arena_enabled(arena_enabled);
+            let mut code = code.clone();
+            let mut old_tree = parser.parse(&code, None).unwrap();
+            let old_sexp = old_tree.root_node().to_sexp();
+
+            // Inserting many statements in the middle of the program makes the
+            // parser build a new, unbalanced repetition around the statements
+            // that it reuses from the old tree.
+            let edit = Edit {
+                position: code.len() / 2,
+                deleted_length: 0,
+                inserted_text: b"b();\n".repeat(200),
+            };
+            perform_edit(&mut old_tree, &mut code, &edit);
+            let old_ids = grandchild_ids(&old_tree);
+            let new_tree = parser.parse(&code, Some(&old_tree)).unwrap();
+            assert_eq!(new_tree.root_node().named_child_count(), 600);
+            let shared_id_count = grandchild_ids(&new_tree)
+                .iter()
+                .filter(|id| old_ids.contains(id))
+                .count();
+            assert!(shared_id_count > 0);
+            assert!(shared_id_count < old_ids.len());
+
+            // Rebalancing the new tree leaves the old tree's nodes alone.
+            assert_eq!(old_tree.root_node().to_sexp(), old_sexp);
+            assert_eq!(grandchild_ids(&old_tree), old_ids);
+
+            let reference_tree = parser.parse(&code, None).unwrap();
+            drop(old_tree);
+            assert_eq!(
+                new_tree.root_node().to_sexp(),
+                reference_tree.root_node().to_sexp()
+            );
+        }
+    });
+}
+
+#[test]
+#[cfg(unix)]
+fn test_parsing_an_ambiguous_sum_with_many_stack_links() {
+    let mut parser = Parser::new();
+    parser.set_language(get_ambiguous_sum_language()).unwrap();
+
+    // The stack versions for the different ways of grouping the sum are
+    // merged, so a stack node gets a link for each way of grouping the terms
+    // before it. Nodes don't keep more than eight links.
+    let source = vec!["a"; 20].join(" + ");
+    let (tree, graphs) = parse_with_dot_graphs(&mut parser, source.as_bytes(), None);
+    assert!(!tree.root_node().has_error());
+    assert_eq!(
+        tree.root_node().to_sexp().matches("(identifier)").count(),
+        20
+    );
+    let max_link_count = stack_graphs(&graphs)
+        .flat_map(|graph| {
+            stack_graph_link_counts(graph)
+                .into_iter()
+                .map(|(_, count)| count)
+        })
+        .max();
+    assert_eq!(max_link_count, Some(8));
+}
+
+#[test]
+#[cfg(unix)]
+fn test_parsing_reuses_stack_nodes_after_the_stack_is_cleared() {
+    let mut parser = Parser::new();
+    parser.set_language(get_ambiguous_sum_language()).unwrap();
+
+    // The stack is cleared after each parse, and its nodes are kept for the
+    // next one, so a parse that needs no more nodes than the previous one
+    // doesn't use any new ones.
+    let source = vec!["a"; 20].join(" + ");
+    let (_, graphs) = parse_with_dot_graphs(&mut parser, source.as_bytes(), None);
+    let first_nodes = stack_graph_nodes(&graphs);
+    let (_, graphs) = parse_with_dot_graphs(&mut parser, source.as_bytes(), None);
+    let second_nodes = stack_graph_nodes(&graphs);
+    assert!(second_nodes.len() > 20);
+    assert!(second_nodes.is_subset(&first_nodes));
+}
+
+#[test]
+fn test_deleting_a_parser_in_the_middle_of_an_ambiguous_parse() {
+    let language = get_ambiguous_sum_language();
+    allocations::record(|| {
+        let cancellation_flag = AtomicUsize::new(0);
+        let mut parser = Parser::new();
+        parser.set_language(language).unwrap();
+        unsafe { parser.set_cancellation_flag(Some(&cancellation_flag)) };
+
+        // The parse is cancelled while the stack has many merged versions, and
+        // the parser is deleted without being reset, so its stack is deleted
+        // while its nodes are still in use.
+        let source = vec!["a"; 200].join(" + ");
+        let bytes = source.as_bytes();
+        let tree = parser.parse_with(
+            &mut |offset, _| {
+                if offset >= 40 {
+                    cancellation_flag.store(1, Ordering::SeqCst);
+                }
+                &bytes[offset.min(bytes.len())..]
+            },
+            None,
+        );
+        assert!(tree.is_none());
+        drop(parser);
+    });
+}
+
 #[test]
 fn test_parsing_cancelled_by_another_thread() {
     let cancellation_flag = std::sync::Arc::new(AtomicUsize::new(0));
@@ -1192,6 +2018,15 @@ fn test_parsing_with_included_ranges_and_missing_tokens() {
     assert_eq!(root.child(3).unwrap().start_byte(), 4);
 }
 
+fn get_node_ranges(node: Node) -> Vec<(&'static str, std::ops::Range<usize>)> {
+    let mut result = vec![(node.kind(), node.byte_range())];
+    let mut cursor = node.walk();
+    for child in node.children(&mut cursor) {
+        result.extend(get_node_ranges(child));
+    }
+    result
+}
+
 fn simple_range(start: usize, end: usize) -> Range {
     Range {
         start_byte: start,
@@ -1200,3 +2035,79 @@ fn simple_range(start: usize, end: usize) -> Range {
         end_point: Point::new(0, end),
     }
 }
+
+fn get_ambiguous_sum_language() -> Language {
+    let (parser_name, parser_code) = generate_parser_for_grammar(
+        r#"{
+            "name": "ambiguous_sum",
+            "extras": [{"type": "PATTERN", "value": "\\s"}],
+            "conflicts": [["expression"]],
+            "rules": {
+                "program": {"type": "SYMBOL", "name": "expression"},
+                "expression": {
+                    "type": "CHOICE",
+                    "members": [
+                        {
+                            "type": "SEQ",
+                            "members": [
+                                {"type": "SYMBOL", "name": "expression"},
+                                {"type": "STRING", "value": "+"},
+                                {"type": "SYMBOL", "name": "expression"}
+                            ]
+                        },
+                        {"type": "SYMBOL", "name": "identifier"}
+                    ]
+                },
+                "identifier": {"type": "PATTERN", "value": "[a-z]+"}
+            }
+        }"#,
+    )
+    .unwrap();
+    get_test_language(&parser_name, &parser_code, None)
+}
+
+#[cfg(unix)]
+fn parse_with_dot_graphs(
+    parser: &mut Parser,
+    source: &[u8],
+    old_tree: Option<&Tree>,
+) -> (Tree, String) {
+    use std::io::{Read, Seek};
+
+    let mut graph_file = tempfile::tempfile().unwrap();
+    parser.print_dot_graphs(&graph_file);
+    let tree = parser.parse(source, old_tree).unwrap();
+    parser.stop_printing_dot_graphs();
+
+    let mut graphs = String::new();
+    graph_file.seek(std::io::SeekFrom::Start(0)).unwrap();
+    graph_file.read_to_string(&mut graphs).unwrap();
+    (tree, graphs)
+}
+
+fn stack_graphs(graphs: &str) -> impl Iterator<Item = &str> {
+    graphs
+        .split("digraph stack {")
+        .skip(1)
+        .map(|graph| graph.split("\n}\n").next().unwrap())
+}
+
+// The names of the nodes in the parser's stack graphs.
+fn stack_graph_nodes(graphs: &str) -> HashSet<&str> {
+    stack_graphs(graphs)
+        .flat_map(|graph| graph.lines())
+        .filter(|line| line.starts_with("node_0x") && !line.contains(" -> "))
+        .map(|line| line.split(' ').next().unwrap())
+        .collect()
+}
+
+// The number of links from each node in one of the parser's stack graphs.
+fn stack_graph_link_counts(graph: &str) -> HashMap<&str, usize> {
+    let mut result = HashMap::new();
+    for line in graph.lines() {
+        if line.starts_with("node_0x") && line.contains(" -> ") {
+            *result.entry(line.split(' ').next().unwrap()).or_insert(0) += 1;
+        }
+    }
+    result
+}
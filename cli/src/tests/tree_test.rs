@@ -1,8 +1,10 @@
 use super::helpers::edits::invert_edit;
-use super::helpers::fixtures::get_language;
+use super::helpers::fixtures::{get_language, get_test_language};
+use crate::generate::generate_parser_for_grammar;
 use crate::parse::{perform_edit, Edit};
-use std::str;
-use tree_sitter::{InputEdit, Parser, Point, Range, Tree};
+use std::sync::Arc;
+use std::{str, thread};
+use tree_sitter::{allocations, InputEdit, Node, Parser, Point, Range, Tree, TreeReclaimer};
 
 #[test]
 fn test_tree_edit() {
@@ -262,6 +264,73 @@ fn test_tree_cursor_fields() {
     assert_eq!(cursor.field_name(), Some("parameters"));
 }
 
+#[test]
+fn test_tree_cursor_previous_sibling() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("rust")).unwrap();
+
+    let tree = parser.parse("struct Stuff { a: A, b: B }", None).unwrap();
+
+    let mut cursor = tree.walk();
+    assert!(!cursor.goto_previous_sibling());
+    cursor.goto_first_child();
+    cursor.goto_first_child();
+    assert_eq!(cursor.node().kind(), "struct");
+    assert!(!cursor.goto_previous_sibling());
+
+    cursor.goto_next_sibling();
+    cursor.goto_next_sibling();
+    assert_eq!(cursor.node().kind(), "field_declaration_list");
+    assert!(cursor.goto_previous_sibling());
+    assert_eq!(cursor.node().kind(), "type_identifier");
+    assert!(cursor.goto_previous_sibling());
+    assert_eq!(cursor.node().kind(), "struct");
+    assert!(!cursor.goto_previous_sibling());
+}
+
+#[test]
+fn test_tree_cursor_descendant_index() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+
+    let tree = parser
+        .parse("function a(b) { return [b, {c: d}, `e${f}`]; }\nclass G { h() {} }", None)
+        .unwrap();
+
+    // Record every node's id in preorder.
+    let mut ids = Vec::new();
+    let mut cursor = tree.walk();
+    'outer: loop {
+        assert_eq!(cursor.descendant_index(), ids.len());
+        ids.push(cursor.node().id());
+        if cursor.goto_first_child() {
+            continue;
+        }
+        while !cursor.goto_next_sibling() {
+            if !cursor.goto_parent() {
+                break 'outer;
+            }
+        }
+    }
+    assert_eq!(tree.root_node().descendant_count(), ids.len());
+
+    // Jump to each node, both forward and backward.
+    let mut cursor = tree.walk();
+    for i in (0..ids.len()).chain((0..ids.len()).rev()) {
+        cursor.goto_descendant(i);
+        assert_eq!(cursor.node().id(), ids[i]);
+        assert_eq!(cursor.descendant_index(), i);
+    }
+
+    // Descendant indices are relative to the cursor's starting node.
+    let class_node = tree.root_node().child(1).unwrap();
+    assert_eq!(class_node.kind(), "class_declaration");
+    let mut cursor = class_node.walk();
+    cursor.goto_descendant(class_node.descendant_count() - 1);
+    assert_eq!(cursor.node().kind(), "}");
+    assert_eq!(cursor.descendant_index(), class_node.descendant_count() - 1);
+}
+
 #[test]
 fn test_tree_node_equality() {
     let mut parser = Parser::new();
@@ -381,6 +450,323 @@ fn test_get_changed_ranges() {
     }
 }
 
+#[test]
+fn test_tree_delete_deferred() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        let source = "function a(b) { return [b, {c: d}, e(f)]; }\n".repeat(20);
+        let tree = parser.parse(&source, None).unwrap();
+
+        let reclaimer = Arc::new(TreeReclaimer::new());
+        assert!(!reclaimer.drain(10));
+
+        // A tree that shares its nodes with another tree is freed a few nodes
+        // at a time.
+        reclaimer.delete_later(tree.clone());
+        reclaimer.delete_later(tree);
+        let mut drain_count = 1;
+        while reclaimer.drain(10) {
+            drain_count += 1;
+        }
+        assert!(drain_count > 10);
+
+        // Trees can be deleted from other threads while the reclaimer is
+        // being drained.
+        let tree = parser.parse(&source, None).unwrap();
+        let threads = (0..4)
+            .map(|_| {
+                let tree = tree.clone();
+                let reclaimer = reclaimer.clone();
+                thread::spawn(move || reclaimer.delete_later(tree))
+            })
+            .collect::<Vec<_>>();
+        while reclaimer.drain(5) {}
+        for thread in threads {
+            thread.join().unwrap();
+        }
+
+        // Any remaining trees are freed when the reclaimer is dropped.
+        reclaimer.delete_later(tree);
+    });
+}
+
+#[test]
+fn test_tree_edit_batch() {
+    let mut parser = Parser::new();
+    parser.set_language(get_language("javascript")).unwrap();
+    let mut source = "let abc = abc + 1;\n// abc\nfoo(abc, `${abc}`);\n"
+        .repeat(20)
+        .into_bytes();
+    let tree = parser.parse(&source, None).unwrap();
+
+    // Rename every occurrence of `abc`, editing one copy of the tree one edit
+    // at a time, and collecting the edits.
+    let mut sequential_tree = tree.clone();
+    let mut edits = Vec::new();
+    let mut position = 0;
+    while let Some(offset) = source[position..].windows(3).position(|w| w == b"abc") {
+        edits.push(perform_edit(
+            &mut sequential_tree,
+            &mut source,
+            &Edit {
+                position: position + offset,
+                deleted_length: 3,
+                inserted_text: b"value".to_vec(),
+            },
+        ));
+        position += offset + 5;
+    }
+    assert_eq!(edits.len(), 100);
+
+    let mut batch_tree = tree.clone();
+    batch_tree.edit_batch(&edits);
+    assert_eq!(
+        batch_tree.root_node().to_sexp(),
+        sequential_tree.root_node().to_sexp()
+    );
+    assert_eq!(
+        batch_tree.root_node().end_position(),
+        sequential_tree.root_node().end_position()
+    );
+
+    let new_tree = parser.parse(&source, Some(&batch_tree)).unwrap();
+    assert_eq!(
+        new_tree.root_node().to_sexp(),
+        parser.parse(&source, None).unwrap().root_node().to_sexp()
+    );
+    assert_eq!(
+        batch_tree.changed_ranges(&new_tree).collect::<Vec<_>>(),
+        sequential_tree
+            .changed_ranges(&parser.parse(&source, Some(&sequential_tree)).unwrap())
+            .collect::<Vec<_>>()
+    );
+
+    // Edits that aren't sorted are still applied in order.
+    let mut source = b"a + b + c;".to_vec();
+    let tree = parser.parse(&source, None).unwrap();
+    let mut sequential_tree = tree.clone();
+    let edits = [8, 4, 0]
+        .iter()
+        .map(|position| {
+            perform_edit(
+                &mut sequential_tree,
+                &mut source,
+                &Edit {
+                    position: *position,
+                    deleted_length: 1,
+                    inserted_text: b"xyz".to_vec(),
+                },
+            )
+        })
+        .collect::<Vec<_>>();
+    let mut batch_tree = tree.clone();
+    batch_tree.edit_batch(&edits);
+    let new_tree = parser.parse(&source, Some(&batch_tree)).unwrap();
+    assert_eq!(
+        new_tree.root_node().to_sexp(),
+        parser
+            .parse(&source, Some(&sequential_tree))
+            .unwrap()
+            .root_node()
+            .to_sexp()
+    );
+    assert_eq!(new_tree.root_node().end_byte(), 16);
+}
+
+#[test]
+fn test_tree_freeze() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        let mut source = "function a(b) { return `${b}` + 'c'; } // d\n"
+            .repeat(10)
+            .into_bytes();
+        let mut tree = parser.parse(&source, None).unwrap();
+        let sexp = tree.root_node().to_sexp();
+        let copy = tree.clone();
+
+        tree.freeze();
+        assert_eq!(tree.root_node().to_sexp(), sexp);
+        let node = tree.root_node().child(3).unwrap();
+        assert_eq!(node.parent(), Some(tree.root_node()));
+        assert_eq!(node.prev_sibling(), tree.root_node().child(2));
+
+        // A frozen tree can still be edited and used for incremental parsing.
+        let edit = Edit {
+            position: index_of(&source, "return"),
+            deleted_length: 0,
+            inserted_text: b"b++; ".to_vec(),
+        };
+        perform_edit(&mut tree, &mut source, &edit);
+        let new_tree = parser.parse(&source, Some(&tree)).unwrap();
+        assert_eq!(
+            new_tree.root_node().to_sexp(),
+            parser.parse(&source, None).unwrap().root_node().to_sexp()
+        );
+        assert_eq!(copy.root_node().to_sexp(), sexp);
+    });
+}
+
+#[test]
+fn test_tree_freeze_and_edit_keeps_unrelated_nodes_shared() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("javascript")).unwrap();
+        let mut source = "function a(b) { return `${b}` + 'c'; } // d\n"
+            .repeat(10)
+            .into_bytes();
+        let mut tree = parser.parse(&source, None).unwrap();
+        tree.freeze();
+
+        // A node's id is the address of its entry in its parent's list of
+        // children, so the ids of a function's descendants only change if the
+        // function itself is copied.
+        let first_ids = descendant_ids(tree.root_node().child(0).unwrap());
+        let last_ids = descendant_ids(tree.root_node().child(18).unwrap());
+
+        let edit = Edit {
+            position: index_of(&source, "return"),
+            deleted_length: 0,
+            inserted_text: b"b++; ".to_vec(),
+        };
+        perform_edit(&mut tree, &mut source, &edit);
+        assert_ne!(
+            descendant_ids(tree.root_node().child(0).unwrap()),
+            first_ids
+        );
+        assert_eq!(
+            descendant_ids(tree.root_node().child(18).unwrap()),
+            last_ids
+        );
+
+        // The parser reuses the frozen nodes that weren't edited as they are.
+        let new_tree = parser.parse(&source, Some(&tree)).unwrap();
+        assert_eq!(
+            new_tree.root_node().to_sexp(),
+            parser.parse(&source, None).unwrap().root_node().to_sexp()
+        );
+        assert_eq!(
+            descendant_ids(new_tree.root_node().child(18).unwrap()),
+            last_ids
+        );
+
+        // The frozen nodes outlive the tree that they were frozen in.
+        drop(tree);
+        assert_eq!(
+            descendant_ids(new_tree.root_node().child(18).unwrap()),
+            last_ids
+        );
+    });
+}
+
+#[test]
+fn test_tree_serialize() {
+    allocations::record(|| {
+        let mut parser = Parser::new();
+        parser.set_language(get_language("python")).unwrap();
+        let mut source = b"def a(b):\n    if b:\n        return 'c'\n    return d\n".repeat(5);
+        let tree = parser.parse(&source, None).unwrap();
+        let data = tree.serialize();
+
+        let mut new_tree = Tree::open_mapped(get_language("python"), &data).unwrap();
+        assert_eq!(new_tree.root_node().to_sexp(), tree.root_node().to_sexp());
+        assert_eq!(new_tree.serialize(), data);
+
+        // The data is rejected if it was written using a different language,
+        // or if it has been truncated.
+        assert!(Tree::open_mapped(get_language("javascript"), &data).is_none());
+        assert!(Tree::open_mapped(get_language("python"), &data[0..data.len() - 8]).is_none());
+
+        // The tree that is read can be used for incremental parsing, which
+        // relies on the external scanner's state.
+        let edit = Edit {
+            position: index_of(&source, "return d"),
+            deleted_length: 0,
+            inserted_text: b"e()\n    ".to_vec(),
+        };
+        perform_edit(&mut new_tree, &mut source, &edit);
+        let edited_tree = parser.parse(&source, Some(&new_tree)).unwrap();
+        assert_eq!(
+            edited_tree.root_node().to_sexp(),
+            parser.parse(&source, None).unwrap().root_node().to_sexp()
+        );
+    });
+}
+
+#[test]
+fn test_tree_serialize_with_a_regenerated_grammar() {
+    // These grammars have the same symbols, but different parse tables.
+    let grammar = |name: &str, word_count: usize| {
+        let members = vec![r#"{"type": "SYMBOL", "name": "word"}"#; word_count].join(",");
+        format!(
+            r#"{{
+                "name": "{}",
+                "rules": {{
+                    "program": {{"type": "SEQ", "members": [{}]}},
+                    "word": {{"type": "PATTERN", "value": "\\w+"}}
+                }}
+            }}"#,
+            name, members
+        )
+    };
+    let (name1, code1) = generate_parser_for_grammar(&grammar("test_serialize_two", 2)).unwrap();
+    let (name2, code2) = generate_parser_for_grammar(&grammar("test_serialize_three", 3)).unwrap();
+    let language1 = get_test_language(&name1, &code1, None);
+    let language2 = get_test_language(&name2, &code2, None);
+    assert_eq!(language1.node_kind_count(), language2.node_kind_count());
+
+    let mut parser = Parser::new();
+    parser.set_language(language1).unwrap();
+    let tree = parser.parse("a b", None).unwrap();
+    let data = tree.serialize();
+    assert!(Tree::open_mapped(language1, &data).is_some());
+    assert!(Tree::open_mapped(language2, &data).is_none());
+}
+
+#[test]
+fn test_tree_serialize_with_a_regenerated_grammar_of_the_same_size() {
+    // These grammars have exactly the same sizes, so a library built from
+    // one of them could be unloaded and replaced by one built from the other
+    // at the same address. Only their parse tables tell them apart.
+    let grammar = |name: &str, first: &str, second: &str| {
+        format!(
+            r#"{{
+                "name": "{}",
+                "rules": {{
+                    "program": {{
+                        "type": "SEQ",
+                        "members": [
+                            {{"type": "SYMBOL", "name": "{}"}},
+                            {{"type": "SYMBOL", "name": "{}"}}
+                        ]
+                    }},
+                    "a": {{"type": "STRING", "value": "a"}},
+                    "b": {{"type": "STRING", "value": "b"}}
+                }}
+            }}"#,
+            name, first, second
+        )
+    };
+    let (name1, code1) =
+        generate_parser_for_grammar(&grammar("test_serialize_ab", "a", "b")).unwrap();
+    let (name2, code2) =
+        generate_parser_for_grammar(&grammar("test_serialize_ba", "b", "a")).unwrap();
+    let language1 = get_test_language(&name1, &code1, None);
+    let language2 = get_test_language(&name2, &code2, None);
+
+    let mut parser = Parser::new();
+    parser.set_language(language1).unwrap();
+    let data1 = parser.parse("a b", None).unwrap().serialize();
+    parser.set_language(language2).unwrap();
+    let data2 = parser.parse("b a", None).unwrap().serialize();
+
+    assert!(Tree::open_mapped(language1, &data1).is_some());
+    assert!(Tree::open_mapped(language2, &data2).is_some());
+    assert!(Tree::open_mapped(language2, &data1).is_none());
+    assert!(Tree::open_mapped(language1, &data2).is_none());
+}
+
 fn index_of(text: &Vec<u8>, substring: &str) -> usize {
     str::from_utf8(text.as_slice())
         .unwrap()
@@ -399,6 +785,16 @@ fn range_of(text: &Vec<u8>, substring: &str) -> Range {
     }
 }
 
+fn descendant_ids(node: Node) -> Vec<usize> {
+    let mut result = Vec::new();
+    let mut cursor = node.walk();
+    for child in node.children(&mut cursor) {
+        result.push(child.id());
+        result.extend(descendant_ids(child));
+    }
+    result
+}
+
 fn get_changed_ranges(
     parser: &mut Parser,
     tree: &mut Tree,
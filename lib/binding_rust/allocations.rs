@@ -60,6 +60,11 @@ pub fn record(f: impl FnOnce()) {
     stop_recording();
 }
 
+/// The number of allocations that have been made since recording started.
+pub fn allocation_count() -> u64 {
+    RECORDER.lock().allocation_count
+}
+
 fn record_alloc(ptr: *mut c_void) {
     let mut recorder = RECORDER.lock();
     if recorder.enabled {
@@ -21,6 +21,11 @@ pub struct TSTree {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSTreeReclaimer {
+    _unused: [u8; 0],
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSQuery {
     _unused: [u8; 0],
 }
@@ -81,6 +86,24 @@ pub struct TSLogger {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSAllocator {
+    pub payload: *mut ::std::os::raw::c_void,
+    pub malloc: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            size: usize,
+        ) -> *mut ::std::os::raw::c_void,
+    >,
+    pub free: ::std::option::Option<
+        unsafe extern "C" fn(
+            payload: *mut ::std::os::raw::c_void,
+            buffer: *mut ::std::os::raw::c_void,
+            size: usize,
+        ),
+    >,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSInputEdit {
     pub start_byte: u32,
     pub old_end_byte: u32,
@@ -91,6 +114,33 @@ pub struct TSInputEdit {
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
+pub struct TSParseStats {
+    pub shift_count: u32,
+    pub reduce_count: u32,
+    pub lex_count: u32,
+    pub external_scanner_call_count: u32,
+    pub token_cache_hit_count: u32,
+    pub token_cache_miss_count: u32,
+    pub reused_node_count: u32,
+    pub reused_byte_count: u32,
+    pub max_version_count: u32,
+    pub condense_count: u32,
+    pub merge_count: u32,
+    pub recovery_count: u32,
+    pub subtree_allocation_count: u32,
+    pub subtree_pool_hit_count: u32,
+    pub version_limit_hit_count: u32,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct TSParseProfile {
+    pub parse_state_hits: *const u64,
+    pub parse_state_count: u32,
+    pub lex_state_hits: *const u64,
+    pub lex_state_count: u32,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
 pub struct TSNode {
     pub context: [u32; 4usize],
     pub id: *const ::std::os::raw::c_void,
@@ -261,6 +311,78 @@ extern "C" {
         encoding: TSInputEncoding,
     ) -> *mut TSTree;
 }
+extern "C" {
+    #[doc = " Use the parser to parse some UTF8 source code stored in one contiguous"]
+    #[doc = " buffer, splitting the work across up to `thread_count` threads."]
+    #[doc = ""]
+    #[doc = " The buffer is divided into chunks at line boundaries that are likely to"]
+    #[doc = " separate top-level nodes, and each chunk is parsed on its own thread with"]
+    #[doc = " its own parser. The resulting trees are then joined under a single root"]
+    #[doc = " node. If a seam between two chunks can't be joined cleanly, the text around"]
+    #[doc = " it is reparsed serially, so the resulting tree has the same node types and"]
+    #[doc = " ranges as the one that `ts_parser_parse_string` would produce. It is not"]
+    #[doc = " identical, though: the tokens at the start of each chunk record the parse"]
+    #[doc = " states of a parse that started there, rather than the ones that a serial"]
+    #[doc = " parse would have reached. So when the tree is used as the old tree of an"]
+    #[doc = " incremental parse, some of the nodes near the seams may not be reused."]
+    #[doc = ""]
+    #[doc = " The parsers on the other threads use this parser's logger and dot graph"]
+    #[doc = " file, so the logger may be called from any of the threads, though only from"]
+    #[doc = " one of them at a time."]
+    #[doc = ""]
+    #[doc = " Small documents, and parsers with custom included ranges, are always parsed"]
+    #[doc = " serially. Unlike `ts_parser_parse`, a parse that is halted by a timeout or a"]
+    #[doc = " cancellation can't be resumed: the parser is reset and NULL is returned."]
+    pub fn ts_parser_parse_string_parallel(
+        self_: *mut TSParser,
+        string: *const ::std::os::raw::c_char,
+        length: u32,
+        thread_count: u32,
+    ) -> *mut TSTree;
+}
+extern "C" {
+    #[doc = " Use the parser to parse a batch of independent documents, storing the"]
+    #[doc = " resulting syntax trees in the `trees` array, which must have room for"]
+    #[doc = " `count` trees."]
+    #[doc = ""]
+    #[doc = " The parser keeps its allocation pools and caches between documents. If"]
+    #[doc = " arena allocation is enabled (see `ts_parser_set_arena_enabled`), it also"]
+    #[doc = " keeps allocating from the same arena, instead of starting a new arena for"]
+    #[doc = " each document, which makes batches of small documents faster to parse"]
+    #[doc = " than calling `ts_parser_parse` for each of them. The trees then share their"]
+    #[doc = " arena, whose memory is only freed once all of them have been deleted, and"]
+    #[doc = " deleting each tree takes as long as it does without arena allocation. If"]
+    #[doc = " arena allocation is disabled, this is no faster than calling"]
+    #[doc = " `ts_parser_parse` for each document in turn."]
+    #[doc = ""]
+    #[doc = " A document whose parse is halted by a timeout gets a NULL tree, and parsing"]
+    #[doc = " continues with the next document. If the parse is cancelled, the remaining"]
+    #[doc = " documents all get NULL trees."]
+    #[doc = ""]
+    #[doc = " Returns true if every document was parsed successfully."]
+    pub fn ts_parser_parse_batch(
+        self_: *mut TSParser,
+        inputs: *const TSInput,
+        count: u32,
+        trees: *mut *mut TSTree,
+    ) -> bool;
+}
+extern "C" {
+    #[doc = " Use the parser to parse a batch of independent documents, spreading them"]
+    #[doc = " across up to `thread_count` threads. This works the same as"]
+    #[doc = " `ts_parser_parse_batch`, except that each thread uses its own parser,"]
+    #[doc = " configured with this parser's language, included ranges, timeout,"]
+    #[doc = " cancellation flag, logger and dot graph file. The input callbacks for"]
+    #[doc = " different documents may be called concurrently. The logger may be called"]
+    #[doc = " from any of the threads, though only from one of them at a time."]
+    pub fn ts_parser_parse_batch_parallel(
+        self_: *mut TSParser,
+        inputs: *const TSInput,
+        count: u32,
+        trees: *mut *mut TSTree,
+        thread_count: u32,
+    ) -> bool;
+}
 extern "C" {
     #[doc = " Instruct the parser to start the next parse from the beginning."]
     #[doc = ""]
@@ -283,6 +405,123 @@ extern "C" {
     #[doc = " Get the duration in microseconds that parsing is allowed to take."]
     pub fn ts_parser_timeout_micros(self_: *const TSParser) -> u64;
 }
+extern "C" {
+    #[doc = " Set the maximum number of stack versions that the parser keeps while it"]
+    #[doc = " explores ambiguities and recovers from errors. The default is 6. The limit"]
+    #[doc = " is clamped to be between 1 and 65535."]
+    #[doc = ""]
+    #[doc = " Whenever there are more versions than this, the least promising ones are"]
+    #[doc = " discarded. A higher limit can find better parses of ambiguous or erroneous"]
+    #[doc = " code, at the cost of parsing more slowly. See the `version_limit_hit_count`"]
+    #[doc = " statistic in `ts_parser_stats`."]
+    pub fn ts_parser_set_version_limit(self_: *mut TSParser, limit: u32);
+}
+extern "C" {
+    #[doc = " Get the maximum number of stack versions that the parser keeps."]
+    pub fn ts_parser_version_limit(self_: *const TSParser) -> u32;
+}
+extern "C" {
+    #[doc = " Get statistics about the parser\'s most recent parse."]
+    #[doc = ""]
+    #[doc = " The statistics are cleared when a new parse begins, but they keep"]
+    #[doc = " accumulating when a parse that was halted by a timeout or a cancellation"]
+    #[doc = " is resumed. They are always collected, so they can be used to explain"]
+    #[doc = " slow parses in production. The `TSParseStats` struct has these fields:"]
+    #[doc = " 1. `shift_count`, `reduce_count`: The number of shift and reduce actions"]
+    #[doc = "    performed, across all stack versions."]
+    #[doc = " 2. `lex_count`: The number of times a token was lexed, and"]
+    #[doc = "    `external_scanner_call_count`: the number of times the language\'s"]
+    #[doc = "    external scanner was invoked while lexing."]
+    #[doc = " 3. `token_cache_hit_count`, `token_cache_miss_count`: How often a token"]
+    #[doc = "    could be shared with another stack version instead of being lexed again."]
+    #[doc = " 4. `reused_node_count`, `reused_byte_count`: The number of nodes reused from"]
+    #[doc = "    the old tree during an incremental parse, and the total size of those"]
+    #[doc = "    nodes in bytes."]
+    #[doc = " 5. `max_version_count`: The largest number of stack versions that were"]
+    #[doc = "    active at once, and `condense_count`, `merge_count`: the number of times"]
+    #[doc = "    the stack versions were condensed, and the number of times two versions"]
+    #[doc = "    were merged into one."]
+    #[doc = " 6. `recovery_count`: The number of error recovery attempts."]
+    #[doc = " 7. `subtree_allocation_count`: The number of subtrees allocated by the"]
+    #[doc = "    parser, both leaves and internal nodes, and `subtree_pool_hit_count`: the"]
+    #[doc = "    number of those that reused memory from previously freed leaves."]
+    #[doc = " 8. `version_limit_hit_count`: The number of times that stack versions were"]
+    #[doc = "    discarded, or not created, because there were already as many versions"]
+    #[doc = "    as the parser\'s version limit allows."]
+    pub fn ts_parser_stats(self_: *const TSParser, stats: *mut TSParseStats);
+}
+extern "C" {
+    #[doc = " Enable or disable the recording of a parse table profile."]
+    #[doc = ""]
+    #[doc = " While profiling is enabled, the parser counts how many times it looks up"]
+    #[doc = " the actions of each parse state, and how many times it starts lexing a token"]
+    #[doc = " in each lex state. Unlike the statistics returned by `ts_parser_stats`, these"]
+    #[doc = " counts accumulate across parses, so that they can be recorded over a sample"]
+    #[doc = " corpus. The generator can then use them to lay out the language\'s parse"]
+    #[doc = " table so that the most frequently used states are the cheapest to access."]
+    #[doc = ""]
+    #[doc = " Enabling profiling, or assigning a different language, clears the counts."]
+    pub fn ts_parser_set_profiling_enabled(self_: *mut TSParser, enabled: bool);
+}
+extern "C" {
+    #[doc = " Get the parse table profile that has been recorded since profiling was"]
+    #[doc = " enabled. The `parse_state_hits` array is indexed by parse state, and the"]
+    #[doc = " `lex_state_hits` array is indexed by the lex state in which lexing started."]
+    #[doc = " Both arrays are owned by the parser. If profiling is disabled, they are"]
+    #[doc = " empty."]
+    pub fn ts_parser_profile(self_: *const TSParser, profile: *mut TSParseProfile);
+}
+extern "C" {
+    #[doc = " Enable or disable arena allocation of syntax nodes."]
+    #[doc = ""]
+    #[doc = " While arena allocation is enabled, the nodes that are created during each"]
+    #[doc = " parse are allocated from a few large blocks of memory that belong to the"]
+    #[doc = " resulting tree, instead of being allocated individually. If none of the"]
+    #[doc = " tree\'s nodes have been shared with another tree, through incremental"]
+    #[doc = " parsing, editing or `ts_tree_copy`, then deleting the tree frees these"]
+    #[doc = " blocks all at once, without visiting its nodes. Otherwise, the blocks are"]
+    #[doc = " freed once all of the nodes in them have been released."]
+    #[doc = ""]
+    #[doc = " Nodes that are discarded during a parse are not reclaimed until the"]
+    #[doc = " tree\'s blocks are freed, so parses with a lot of ambiguity or error"]
+    #[doc = " recovery can use more memory. This takes effect at the start of the next"]
+    #[doc = " parse."]
+    pub fn ts_parser_set_arena_enabled(self_: *mut TSParser, enabled: bool);
+}
+extern "C" {
+    #[doc = " Check whether arena allocation of syntax nodes is enabled."]
+    pub fn ts_parser_arena_enabled(self_: *const TSParser) -> bool;
+}
+extern "C" {
+    #[doc = " Set the allocator that the parser should use for the memory of the nodes"]
+    #[doc = " of the trees that it produces. Pass `NULL` to go back to the library\'s own"]
+    #[doc = " allocation functions."]
+    #[doc = ""]
+    #[doc = " The allocator only supplies the large blocks of memory from which the parser"]
+    #[doc = " allocates nodes, so setting an allocator also enables arena allocation (see"]
+    #[doc = " `ts_parser_set_arena_enabled`). The same goes for the block that holds the"]
+    #[doc = " nodes of a frozen tree (see `ts_tree_freeze`). Everything else, including"]
+    #[doc = " the `TSTree` itself, its included ranges, its caches and index, and the"]
+    #[doc = " copies of nodes that `ts_tree_edit` makes, is allocated with the library\'s"]
+    #[doc = " own allocation functions, as is the parser\'s own memory."]
+    #[doc = ""]
+    #[doc = " Each tree keeps a copy of the allocator that it was created with, and"]
+    #[doc = " returns its memory to that allocator when it is freed, so the allocator\'s"]
+    #[doc = " payload must remain valid for as long as any of those trees, or any trees"]
+    #[doc = " derived from them, are alive. Both `malloc` and `free` must be set; an"]
+    #[doc = " allocator that is missing either of them is ignored, as if `NULL` had been"]
+    #[doc = " passed. The `malloc` function must not return `NULL`, and `free` is given"]
+    #[doc = " the size that was originally requested. If the parser is used to parse in"]
+    #[doc = " parallel, these functions may be called from several threads at once."]
+    #[doc = ""]
+    #[doc = " This takes effect at the start of the next parse."]
+    pub fn ts_parser_set_allocator(self_: *mut TSParser, allocator: *const TSAllocator);
+}
+extern "C" {
+    #[doc = " Get the parser\'s allocator, or `NULL` if it uses the library\'s own"]
+    #[doc = " allocation functions."]
+    pub fn ts_parser_allocator(self_: *const TSParser) -> *const TSAllocator;
+}
 extern "C" {
     #[doc = " Set the parser\'s current cancellation flag pointer."]
     #[doc = ""]
@@ -317,14 +556,41 @@ extern "C" {
 extern "C" {
     #[doc = " Create a shallow copy of the syntax tree. This is very fast."]
     #[doc = ""]
-    #[doc = " You need to copy a syntax tree in order to use it on more than one thread at"]
-    #[doc = " a time, as syntax trees are not thread safe."]
+    #[doc = " Several threads can read the same syntax tree at once, by navigating its"]
+    #[doc = " nodes, walking it with tree cursors, or running queries on it. You need to"]
+    #[doc = " copy the tree before editing it while other threads are still using it."]
     pub fn ts_tree_copy(self_: *const TSTree) -> *mut TSTree;
 }
 extern "C" {
     #[doc = " Delete the syntax tree, freeing all of the memory that it used."]
     pub fn ts_tree_delete(self_: *mut TSTree);
 }
+extern "C" {
+    #[doc = " Create a new queue of syntax trees whose memory should be freed later."]
+    pub fn ts_tree_reclaimer_new() -> *mut TSTreeReclaimer;
+}
+extern "C" {
+    #[doc = " Delete a tree reclaimer, first freeing all of the trees that are still"]
+    #[doc = " queued in it."]
+    pub fn ts_tree_reclaimer_delete(self_: *mut TSTreeReclaimer);
+}
+extern "C" {
+    #[doc = " Delete the syntax tree without freeing its memory right away. The tree is"]
+    #[doc = " added to the given reclaimer\'s queue, and its memory is freed by later"]
+    #[doc = " calls to `ts_tree_reclaimer_drain`. This takes constant time, and it can be"]
+    #[doc = " called from any thread, including while another thread is draining the"]
+    #[doc = " reclaimer."]
+    pub fn ts_tree_delete_deferred(self_: *mut TSTree, reclaimer: *mut TSTreeReclaimer);
+}
+extern "C" {
+    #[doc = " Free the memory of trees that have been queued in the reclaimer, freeing"]
+    #[doc = " at most `max_node_count` nodes. This can be called periodically from a"]
+    #[doc = " background thread, or whenever the application is idle."]
+    #[doc = ""]
+    #[doc = " Returns `true` if there may be more memory left to free. If another thread"]
+    #[doc = " is already draining the reclaimer, this returns `true` immediately."]
+    pub fn ts_tree_reclaimer_drain(self_: *mut TSTreeReclaimer, max_node_count: u32) -> bool;
+}
 extern "C" {
     #[doc = " Get the root node of the syntax tree."]
     pub fn ts_tree_root_node(self_: *const TSTree) -> TSNode;
@@ -333,6 +599,81 @@ extern "C" {
     #[doc = " Get the language that was used to parse the syntax tree."]
     pub fn ts_tree_language(arg1: *const TSTree) -> *const TSLanguage;
 }
+extern "C" {
+    #[doc = " Build an index of the syntax tree\'s nodes, so that finding a node\'s parent"]
+    #[doc = " or siblings takes constant time, instead of searching the tree."]
+    #[doc = ""]
+    #[doc = " This visits every node in the tree once, and uses about 48 bytes of memory"]
+    #[doc = " per node. It is worthwhile for trees that are walked many times using"]
+    #[doc = " `ts_node_parent` and the sibling functions. The index is discarded if the"]
+    #[doc = " tree is edited. Like editing, this must not be done while other threads are"]
+    #[doc = " using the tree."]
+    pub fn ts_tree_build_index(self_: *mut TSTree);
+}
+extern "C" {
+    #[doc = " Compact the syntax tree's memory, for trees that will be kept for a long"]
+    #[doc = " time without being re-parsed."]
+    #[doc = ""]
+    #[doc = " This copies the tree's nodes into a single block of memory, in the order"]
+    #[doc = " that a depth-first traversal visits them, and frees the original nodes"]
+    #[doc = " unless they are shared with another tree. Nodes that were discarded during"]
+    #[doc = " the parse, and unused space left over from parsing, are not kept. If the"]
+    #[doc = " tree was parsed with an allocator (see `ts_parser_set_allocator`), the"]
+    #[doc = " block comes from the same allocator."]
+    #[doc = ""]
+    #[doc = " The copied nodes use a smaller layout that leaves out the fields that the"]
+    #[doc = " parser only needs while parsing, such as reference counts, error costs and"]
+    #[doc = " most of the lexer's bookkeeping on internal nodes, and leaves with identical"]
+    #[doc = " contents are only stored once. This typically saves a third or more of the"]
+    #[doc = " tree's memory, and more when it was parsed with an arena."]
+    #[doc = ""]
+    #[doc = " Nodes, tree cursors and queries read the compact nodes directly and work"]
+    #[doc = " the same way on the frozen tree, but its nodes have new ids, so any"]
+    #[doc = " `TSNode` or `TSTreeCursor` that was created from the tree beforehand must"]
+    #[doc = " not be used afterwards. The tree can still be edited and used for"]
+    #[doc = " incremental parsing. An edit only copies the nodes that contain the edited"]
+    #[doc = " range back into the parser's layout, and the rest stay compact and are"]
+    #[doc = " shared with any parse that reuses them. Like editing, freezing must not be"]
+    #[doc = " done while other threads are using the tree."]
+    pub fn ts_tree_freeze(self_: *mut TSTree);
+}
+extern "C" {
+    #[doc = " Serialize the syntax tree into a binary format, so that it can be saved"]
+    #[doc = " and read again later using `ts_tree_open_mapped`. The serialized tree"]
+    #[doc = " includes the state of the language's external scanner, so it can be used"]
+    #[doc = " for incremental parsing."]
+    #[doc = ""]
+    #[doc = " The format stores the tree's nodes in the compact layout of a frozen tree"]
+    #[doc = " (see `ts_tree_freeze`), so it can only be read by the same version of the"]
+    #[doc = " library, on the same kind of platform, using the same version of the"]
+    #[doc = " language."]
+    #[doc = ""]
+    #[doc = " The returned buffer is allocated with `malloc` and the caller is"]
+    #[doc = " responsible for freeing it using `free`. Its length is written to the"]
+    #[doc = " `length` parameter."]
+    pub fn ts_tree_serialize(self_: *const TSTree, length: *mut usize) -> *mut ::std::os::raw::c_char;
+}
+extern "C" {
+    #[doc = " Read a syntax tree that was serialized using `ts_tree_serialize`."]
+    #[doc = ""]
+    #[doc = " The data is typically a read-only memory mapping of a file. It is not"]
+    #[doc = " parsed node by node: the tree's nodes are copied out of it all at once,"]
+    #[doc = " and then linked together in one pass, so the data can be unmapped as soon"]
+    #[doc = " as this function returns. The result behaves like a tree that has been"]
+    #[doc = " frozen using `ts_tree_freeze`."]
+    #[doc = ""]
+    #[doc = " Returns `NULL` if the data was not written by this version of the library,"]
+    #[doc = " or was written using a different language or version of the language, or"]
+    #[doc = " has been truncated or corrupted. These checks are meant to catch stale"]
+    #[doc = " files, so the data should still come from a trusted source. The language is"]
+    #[doc = " identified by a hash of its parse table, which is computed each time a tree"]
+    #[doc = " is serialized or read, and takes time proportional to the table's size."]
+    pub fn ts_tree_open_mapped(
+        language: *const TSLanguage,
+        data: *const ::std::os::raw::c_void,
+        length: usize,
+    ) -> *mut TSTree;
+}
 extern "C" {
     #[doc = " Edit the syntax tree to keep it in sync with source code that has been"]
     #[doc = " edited."]
@@ -341,6 +682,16 @@ extern "C" {
     #[doc = " (row, column) coordinates."]
     pub fn ts_tree_edit(self_: *mut TSTree, edit: *const TSInputEdit);
 }
+extern "C" {
+    #[doc = " Edit the syntax tree to reflect several edits to the source code at once."]
+    #[doc = ""]
+    #[doc = " This has the same effect as calling `ts_tree_edit` with each of the edits"]
+    #[doc = " in order, so each edit must be described in terms of the document as it is"]
+    #[doc = " after the preceding edits. When the edits are sorted by position and don't"]
+    #[doc = " overlap, as with multiple cursors or the output of a formatter, the tree is"]
+    #[doc = " only traversed once, and each node is copied at most once."]
+    pub fn ts_tree_edit_batch(self_: *mut TSTree, edits: *const TSInputEdit, count: u32);
+}
 extern "C" {
     #[doc = " Compare an old edited syntax tree to a new syntax tree representing the same"]
     #[doc = " document, returning an array of ranges whose syntactic structure has changed."]
@@ -450,6 +801,10 @@ extern "C" {
     #[doc = " See also `ts_node_is_named`."]
     pub fn ts_node_named_child_count(arg1: TSNode) -> u32;
 }
+extern "C" {
+    #[doc = " Get the node\'s number of descendants, including one for the node itself."]
+    pub fn ts_node_descendant_count(arg1: TSNode) -> u32;
+}
 extern "C" {
     #[doc = " Get the node\'s child with the given field name."]
     pub fn ts_node_child_by_field_name(
@@ -572,6 +927,13 @@ extern "C" {
     #[doc = " if there was no next sibling node."]
     pub fn ts_tree_cursor_goto_next_sibling(arg1: *mut TSTreeCursor) -> bool;
 }
+extern "C" {
+    #[doc = " Move the cursor to the previous sibling of its current node."]
+    #[doc = ""]
+    #[doc = " This returns `true` if the cursor successfully moved, and returns `false`"]
+    #[doc = " if there was no previous sibling node."]
+    pub fn ts_tree_cursor_goto_previous_sibling(arg1: *mut TSTreeCursor) -> bool;
+}
 extern "C" {
     #[doc = " Move the cursor to the first child of its current node."]
     #[doc = ""]
@@ -587,6 +949,18 @@ extern "C" {
     #[doc = " if no such child was found."]
     pub fn ts_tree_cursor_goto_first_child_for_byte(arg1: *mut TSTreeCursor, arg2: u32) -> i64;
 }
+extern "C" {
+    #[doc = " Move the cursor to the node that is the nth descendant of the node that"]
+    #[doc = " the cursor was constructed with, where zero represents that original node"]
+    #[doc = " itself. The cursor skips over whole subtrees that precede the goal node,"]
+    #[doc = " using their descendant counts."]
+    pub fn ts_tree_cursor_goto_descendant(arg1: *mut TSTreeCursor, arg2: u32);
+}
+extern "C" {
+    #[doc = " Get the index of the cursor\'s current node out of all of the descendants"]
+    #[doc = " of the node that the cursor was constructed with, in preorder."]
+    pub fn ts_tree_cursor_current_descendant_index(arg1: *const TSTreeCursor) -> u32;
+}
 extern "C" {
     pub fn ts_tree_cursor_copy(arg1: *const TSTreeCursor) -> TSTreeCursor;
 }
@@ -814,5 +1188,5 @@ extern "C" {
     pub fn ts_language_version(arg1: *const TSLanguage) -> u32;
 }
 
-pub const TREE_SITTER_LANGUAGE_VERSION: usize = 13;
+pub const TREE_SITTER_LANGUAGE_VERSION: usize = 14;
 pub const TREE_SITTER_MIN_COMPATIBLE_LANGUAGE_VERSION: usize = 13;
@@ -26,6 +26,11 @@ fn main() {
         config.define("TREE_SITTER_ALLOCATION_TRACKING", "");
     }
 
+    println!("cargo:rerun-if-env-changed=TREE_SITTER_DISABLE_ASCII_RUNS");
+    if env::var("TREE_SITTER_DISABLE_ASCII_RUNS").is_ok() {
+        config.define("TREE_SITTER_DISABLE_ASCII_RUNS", "");
+    }
+
     let src_path = Path::new("src");
     for entry in fs::read_dir(&src_path).unwrap() {
         let entry = entry.unwrap();
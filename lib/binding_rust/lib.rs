@@ -39,6 +39,9 @@ pub struct Language(*const ffi::TSLanguage);
 /// A tree that represents the syntactic structure of a source code file.
 pub struct Tree(NonNull<ffi::TSTree>);
 
+/// A queue of deleted trees whose memory is freed later, in bounded slices.
+pub struct TreeReclaimer(NonNull<ffi::TSTreeReclaimer>);
+
 /// A position in a multi-line text document, in terms of rows and columns.
 ///
 /// Rows and columns are zero-based.
@@ -69,6 +72,44 @@ pub struct InputEdit {
     pub new_end_position: Point,
 }
 
+/// Statistics about a `Parser`'s most recent parse.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct ParseStats {
+    pub shift_count: usize,
+    pub reduce_count: usize,
+    pub lex_count: usize,
+    pub external_scanner_call_count: usize,
+    pub token_cache_hit_count: usize,
+    pub token_cache_miss_count: usize,
+    pub reused_node_count: usize,
+    pub reused_byte_count: usize,
+    pub max_version_count: usize,
+    pub condense_count: usize,
+    pub merge_count: usize,
+    pub recovery_count: usize,
+    pub subtree_allocation_count: usize,
+    pub subtree_pool_hit_count: usize,
+    pub version_limit_hit_count: usize,
+}
+
+/// Counts of how often each parse state and lex state were used while a
+/// `Parser` was profiling.
+#[derive(Clone, Debug, Default, PartialEq, Eq)]
+pub struct ParseProfile {
+    pub parse_state_hits: Vec<u64>,
+    pub lex_state_hits: Vec<u64>,
+}
+
+/// A set of functions that a `Parser` can use to allocate the memory of the
+/// nodes of the trees that it produces. `free` is given the size that was
+/// passed to `malloc`.
+#[derive(Clone, Copy, Debug)]
+pub struct Allocator {
+    pub payload: *mut c_void,
+    pub malloc: unsafe extern "C" fn(payload: *mut c_void, size: usize) -> *mut c_void,
+    pub free: unsafe extern "C" fn(payload: *mut c_void, buffer: *mut c_void, size: usize),
+}
+
 /// A single node within a syntax `Tree`.
 #[derive(Clone, Copy)]
 #[repr(transparent)]
@@ -399,11 +440,16 @@ impl Parser {
     ///  * The cancellation flag set with [Parser::set_cancellation_flag] was flipped
     pub fn parse(&mut self, text: impl AsRef<[u8]>, old_tree: Option<&Tree>) -> Option<Tree> {
         let bytes = text.as_ref();
-        let len = bytes.len();
-        self.parse_with(
-            &mut |i, _| if i < len { &bytes[i..] } else { &[] },
-            old_tree,
-        )
+        let c_old_tree = old_tree.map_or(ptr::null_mut(), |t| t.0.as_ptr());
+        unsafe {
+            let c_new_tree = ffi::ts_parser_parse_string(
+                self.0.as_ptr(),
+                c_old_tree,
+                bytes.as_ptr() as *const c_char,
+                bytes.len() as u32,
+            );
+            NonNull::new(c_new_tree).map(Tree)
+        }
     }
 
     /// Parse a slice of UTF16 text.
@@ -533,6 +579,97 @@ impl Parser {
         }
     }
 
+    /// Parse a slice of UTF8 text, splitting the work across multiple threads.
+    ///
+    /// # Arguments:
+    /// * `text` The UTF8-encoded text to parse.
+    /// * `thread_count` The maximum number of threads to use.
+    ///
+    /// The text is split into chunks at line boundaries that are likely to
+    /// separate top-level nodes. The chunks are parsed concurrently and their
+    /// trees are joined, and any seam that can't be joined cleanly is reparsed
+    /// serially, so the result has the same node kinds and ranges as the one
+    /// returned by `parse`. The tokens at the start of each chunk record the
+    /// parse states of a parse that started there, so when the result is used
+    /// as the old tree of an incremental parse, some of the nodes near the
+    /// seams may not be reused. Unlike `parse`, a parse that is halted by a
+    /// timeout or a cancellation can't be resumed.
+    ///
+    /// The chunks that are parsed on other threads are logged to this
+    /// parser's logger too, so it may be called from any of those threads,
+    /// though only from one of them at a time.
+    pub fn parse_parallel(&mut self, text: impl AsRef<[u8]>, thread_count: u32) -> Option<Tree> {
+        let bytes = text.as_ref();
+        unsafe {
+            let c_new_tree = ffi::ts_parser_parse_string_parallel(
+                self.0.as_ptr(),
+                bytes.as_ptr() as *const c_char,
+                bytes.len() as u32,
+                thread_count,
+            );
+            NonNull::new(c_new_tree).map(Tree)
+        }
+    }
+
+    /// Parse a batch of independent UTF8 documents.
+    ///
+    /// # Arguments:
+    /// * `texts` The UTF8-encoded documents to parse.
+    /// * `thread_count` The maximum number of threads to use. Each thread
+    ///   parses documents with its own parser, configured like this one. They
+    ///   all share this parser's logger, which is called from one thread at
+    ///   a time.
+    ///
+    /// If arena allocation is enabled, each thread keeps allocating the
+    /// nodes of its documents from one arena, which makes batches of small
+    /// documents faster to parse than calling `parse` for each of them. That
+    /// arena's memory is freed once all of the thread's trees have been
+    /// dropped.
+    ///
+    /// Returns one tree for each document, or `None` for documents whose
+    /// parse was halted by a timeout or a cancellation.
+    pub fn parse_batch<T: AsRef<[u8]>>(
+        &mut self,
+        texts: &[T],
+        thread_count: u32,
+    ) -> Vec<Option<Tree>> {
+        unsafe extern "C" fn read(
+            payload: *mut c_void,
+            byte_offset: u32,
+            _: ffi::TSPoint,
+            bytes_read: *mut u32,
+        ) -> *const c_char {
+            let text = *(payload as *const &[u8]);
+            let slice = text.get(byte_offset as usize..).unwrap_or(&[]);
+            *bytes_read = slice.len() as u32;
+            slice.as_ptr() as *const c_char
+        }
+
+        let texts = texts.iter().map(|text| text.as_ref()).collect::<Vec<_>>();
+        let c_inputs = texts
+            .iter()
+            .map(|text| ffi::TSInput {
+                payload: text as *const &[u8] as *mut c_void,
+                read: Some(read),
+                encoding: ffi::TSInputEncoding_TSInputEncodingUTF8,
+            })
+            .collect::<Vec<_>>();
+        let mut c_trees = vec![ptr::null_mut(); texts.len()];
+        unsafe {
+            ffi::ts_parser_parse_batch_parallel(
+                self.0.as_ptr(),
+                c_inputs.as_ptr(),
+                c_inputs.len() as u32,
+                c_trees.as_mut_ptr(),
+                thread_count,
+            );
+        }
+        c_trees
+            .into_iter()
+            .map(|c_tree| NonNull::new(c_tree).map(Tree))
+            .collect()
+    }
+
     /// Instruct the parser to start the next parse from the beginning.
     ///
     /// If the parser previously failed because of a timeout or a cancellation, then
@@ -550,6 +687,114 @@ impl Parser {
         unsafe { ffi::ts_parser_timeout_micros(self.0.as_ptr()) }
     }
 
+    /// Get the maximum number of stack versions that the parser keeps.
+    ///
+    /// This is set via [set_version_limit](Parser::set_version_limit).
+    pub fn version_limit(&self) -> usize {
+        unsafe { ffi::ts_parser_version_limit(self.0.as_ptr()) as usize }
+    }
+
+    /// Get statistics about the parser's most recent parse.
+    ///
+    /// The statistics are cleared when a new parse begins, but they keep
+    /// accumulating when a parse that was halted by a timeout or a
+    /// cancellation is resumed.
+    pub fn stats(&self) -> ParseStats {
+        let mut stats = MaybeUninit::<ffi::TSParseStats>::uninit();
+        unsafe {
+            ffi::ts_parser_stats(self.0.as_ptr(), stats.as_mut_ptr());
+            stats.assume_init().into()
+        }
+    }
+
+    /// Enable or disable the recording of a parse table profile.
+    ///
+    /// While profiling is enabled, the parser counts how often each parse state
+    /// and lex state is used. The counts accumulate across parses until profiling
+    /// is enabled again, or the parser's language is changed.
+    pub fn set_profiling_enabled(&mut self, enabled: bool) {
+        unsafe { ffi::ts_parser_set_profiling_enabled(self.0.as_ptr(), enabled) }
+    }
+
+    /// Get the parse table profile that has been recorded since profiling was
+    /// enabled.
+    pub fn profile(&self) -> ParseProfile {
+        let mut profile = MaybeUninit::<ffi::TSParseProfile>::uninit();
+        unsafe {
+            ffi::ts_parser_profile(self.0.as_ptr(), profile.as_mut_ptr());
+            let profile = profile.assume_init();
+            if profile.parse_state_hits.is_null() {
+                return ParseProfile::default();
+            }
+            ParseProfile {
+                parse_state_hits: slice::from_raw_parts(
+                    profile.parse_state_hits,
+                    profile.parse_state_count as usize,
+                )
+                .to_vec(),
+                lex_state_hits: slice::from_raw_parts(
+                    profile.lex_state_hits,
+                    profile.lex_state_count as usize,
+                )
+                .to_vec(),
+            }
+        }
+    }
+
+    /// Enable or disable arena allocation of syntax nodes.
+    ///
+    /// While arena allocation is enabled, the nodes of each tree are allocated
+    /// from a few large blocks of memory, which can be freed all at once when the
+    /// tree is dropped, as long as none of its nodes are shared with other trees.
+    /// This takes effect at the start of the next parse.
+    pub fn set_arena_enabled(&mut self, enabled: bool) {
+        unsafe { ffi::ts_parser_set_arena_enabled(self.0.as_ptr(), enabled) }
+    }
+
+    /// Check whether arena allocation of syntax nodes is enabled.
+    pub fn arena_enabled(&self) -> bool {
+        unsafe { ffi::ts_parser_arena_enabled(self.0.as_ptr()) }
+    }
+
+    /// Set the allocator that should be used for the memory of the nodes of the
+    /// trees that this parser produces, or pass `None` to use the library's own
+    /// allocation functions. Setting an allocator also enables arena allocation.
+    ///
+    /// The allocator only supplies the large blocks of memory from which nodes
+    /// are allocated while parsing, and the blocks of frozen trees. The rest
+    /// of a tree's memory, such as its caches and index, and the copies of
+    /// nodes that are made when it is edited, come from the library's own
+    /// allocation functions.
+    ///
+    /// # Safety
+    ///
+    /// The allocator's functions must be safe to call with its payload, from any
+    /// thread, for as long as any tree that is produced while the allocator is set
+    /// is alive. Its `malloc` function must not return null.
+    pub unsafe fn set_allocator(&mut self, allocator: Option<Allocator>) {
+        match allocator {
+            Some(allocator) => {
+                let c_allocator = ffi::TSAllocator {
+                    payload: allocator.payload,
+                    malloc: Some(allocator.malloc),
+                    free: Some(allocator.free),
+                };
+                ffi::ts_parser_set_allocator(self.0.as_ptr(), &c_allocator)
+            }
+            None => ffi::ts_parser_set_allocator(self.0.as_ptr(), ptr::null()),
+        }
+    }
+
+    /// Get the parser's allocator, if one has been set.
+    pub fn allocator(&self) -> Option<Allocator> {
+        let allocator = unsafe { ffi::ts_parser_allocator(self.0.as_ptr()).as_ref()? };
+        Some(Allocator {
+            payload: allocator.payload,
+            malloc: allocator.malloc?,
+            free: allocator.free?,
+        })
+    }
+
     /// Set the maximum duration in microseconds that parsing should be allowed to
     /// take before halting.
     ///
@@ -559,6 +804,18 @@ impl Parser {
         unsafe { ffi::ts_parser_set_timeout_micros(self.0.as_ptr(), timeout_micros) }
     }
 
+    /// Set the maximum number of stack versions that the parser keeps while it
+    /// explores ambiguities and recovers from errors. The default is 6, and the
+    /// limit is clamped to be between 1 and 65535.
+    ///
+    /// A higher limit can find better parses of ambiguous or erroneous code, at
+    /// the cost of parsing more slowly. The `version_limit_hit_count` in
+    /// [stats](Parser::stats) shows how often the limit was reached.
+    pub fn set_version_limit(&mut self, limit: usize) {
+        let limit = limit.min(u16::MAX as usize) as u32;
+        unsafe { ffi::ts_parser_set_version_limit(self.0.as_ptr(), limit) }
+    }
+
     /// Set the ranges of text that the parser should include when parsing.
     ///
     /// By default, the parser will always include entire documents. This function
@@ -653,6 +910,69 @@ impl Tree {
         unsafe { ffi::ts_tree_edit(self.0.as_ptr(), &edit) };
     }
 
+    /// Edit the syntax tree to reflect several edits to the source code at
+    /// once.
+    ///
+    /// This has the same effect as calling [Tree::edit] with each of the edits
+    /// in order, so each edit must be described in terms of the document as it
+    /// is after the preceding edits. When the edits are sorted and don't
+    /// overlap, the tree is only traversed once.
+    pub fn edit_batch(&mut self, edits: &[InputEdit]) {
+        let edits = edits
+            .iter()
+            .map(|edit| edit.into())
+            .collect::<Vec<ffi::TSInputEdit>>();
+        unsafe { ffi::ts_tree_edit_batch(self.0.as_ptr(), edits.as_ptr(), edits.len() as u32) };
+    }
+
+    /// Build an index of the tree's nodes, so that [Node::parent] and the
+    /// sibling methods take constant time instead of searching the tree.
+    /// The index is discarded if the tree is edited.
+    pub fn build_index(&mut self) {
+        unsafe { ffi::ts_tree_build_index(self.0.as_ptr()) }
+    }
+
+    /// Compact the tree's memory by copying its nodes into a single block,
+    /// for trees that will be kept for a long time without being re-parsed.
+    /// The tree can still be edited and used for incremental parsing
+    /// afterwards.
+    ///
+    /// The copied nodes leave out the fields that are only needed while
+    /// parsing, which typically saves a third or more of the tree's memory.
+    /// An edit only copies the nodes that contain the edited range back into
+    /// the parser's layout; the rest stay compact.
+    pub fn freeze(&mut self) {
+        unsafe { ffi::ts_tree_freeze(self.0.as_ptr()) }
+    }
+
+    /// Serialize the tree into a binary format that can be saved and read
+    /// again using [Tree::open_mapped]. The data can only be read by the same
+    /// version of this library, on the same kind of platform, using the same
+    /// version of the language.
+    pub fn serialize(&self) -> Vec<u8> {
+        let mut length = 0;
+        unsafe {
+            let ptr = ffi::ts_tree_serialize(self.0.as_ptr(), &mut length);
+            let result = slice::from_raw_parts(ptr as *const u8, length).to_vec();
+            util::free_ptr(ptr as *mut c_void);
+            result
+        }
+    }
+
+    /// Read a tree that was serialized using [Tree::serialize]. The data is
+    /// typically a memory mapping of a file, and is not needed once this
+    /// returns.
+    ///
+    /// Returns `None` if the data was not written by this version of the
+    /// library using the same version of the language, or if it has been
+    /// truncated or corrupted.
+    pub fn open_mapped(language: Language, data: &[u8]) -> Option<Tree> {
+        let c_tree = unsafe {
+            ffi::ts_tree_open_mapped(language.0, data.as_ptr() as *const c_void, data.len())
+        };
+        NonNull::new(c_tree).map(Tree)
+    }
+
     /// Create a new [TreeCursor] starting from the root of the tree.
     pub fn walk(&self) -> TreeCursor {
         self.root_node().walk()
@@ -696,6 +1016,38 @@ impl Clone for Tree {
     }
 }
 
+impl TreeReclaimer {
+    /// Create a new, empty tree reclaimer.
+    pub fn new() -> Self {
+        unsafe { TreeReclaimer(NonNull::new_unchecked(ffi::ts_tree_reclaimer_new())) }
+    }
+
+    /// Delete a tree without freeing its memory yet. This takes constant time,
+    /// and can be done from any thread.
+    pub fn delete_later(&self, tree: Tree) {
+        let tree = std::mem::ManuallyDrop::new(tree);
+        unsafe { ffi::ts_tree_delete_deferred(tree.0.as_ptr(), self.0.as_ptr()) }
+    }
+
+    /// Free the memory of the deleted trees, freeing at most `max_node_count`
+    /// nodes. Returns `true` if there may be more memory left to free.
+    pub fn drain(&self, max_node_count: u32) -> bool {
+        unsafe { ffi::ts_tree_reclaimer_drain(self.0.as_ptr(), max_node_count) }
+    }
+}
+
+impl Default for TreeReclaimer {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Drop for TreeReclaimer {
+    fn drop(&mut self) {
+        unsafe { ffi::ts_tree_reclaimer_delete(self.0.as_ptr()) }
+    }
+}
+
 impl<'tree> Node<'tree> {
     fn new(node: ffi::TSNode) -> Option<Self> {
         if node.id.is_null() {
@@ -845,6 +1197,11 @@ impl<'tree> Node<'tree> {
         unsafe { ffi::ts_node_named_child_count(self.0) as usize }
     }
 
+    /// Get this node's number of descendants, including one for the node itself.
+    pub fn descendant_count(&self) -> usize {
+        unsafe { ffi::ts_node_descendant_count(self.0) as usize }
+    }
+
     /// Get the first child with the given field name.
     ///
     /// If multiple children may have the same field name, access them using
@@ -1129,6 +1486,26 @@ impl<'a> TreeCursor<'a> {
         return unsafe { ffi::ts_tree_cursor_goto_next_sibling(&mut self.0) };
     }
 
+    /// Move this cursor to the previous sibling of its current node.
+    ///
+    /// This returns `true` if the cursor successfully moved, and returns `false`
+    /// if there was no previous sibling node.
+    pub fn goto_previous_sibling(&mut self) -> bool {
+        return unsafe { ffi::ts_tree_cursor_goto_previous_sibling(&mut self.0) };
+    }
+
+    /// Move this cursor to the nth descendant of the node that it was created
+    /// with, in preorder, where zero represents that original node itself.
+    pub fn goto_descendant(&mut self, descendant_index: usize) {
+        unsafe { ffi::ts_tree_cursor_goto_descendant(&mut self.0, descendant_index as u32) }
+    }
+
+    /// Get the index of the cursor's current node out of all of the descendants
+    /// of the node that the cursor was created with, in preorder.
+    pub fn descendant_index(&self) -> usize {
+        unsafe { ffi::ts_tree_cursor_current_descendant_index(&self.0) as usize }
+    }
+
     /// Move this cursor to the first child of its current node that extends beyond
     /// the given byte offset.
     ///
@@ -1828,6 +2205,28 @@ impl Into<ffi::TSRange> for Range {
     }
 }
 
+impl From<ffi::TSParseStats> for ParseStats {
+    fn from(stats: ffi::TSParseStats) -> Self {
+        Self {
+            shift_count: stats.shift_count as usize,
+            reduce_count: stats.reduce_count as usize,
+            lex_count: stats.lex_count as usize,
+            external_scanner_call_count: stats.external_scanner_call_count as usize,
+            token_cache_hit_count: stats.token_cache_hit_count as usize,
+            token_cache_miss_count: stats.token_cache_miss_count as usize,
+            reused_node_count: stats.reused_node_count as usize,
+            reused_byte_count: stats.reused_byte_count as usize,
+            max_version_count: stats.max_version_count as usize,
+            condense_count: stats.condense_count as usize,
+            merge_count: stats.merge_count as usize,
+            recovery_count: stats.recovery_count as usize,
+            subtree_allocation_count: stats.subtree_allocation_count as usize,
+            subtree_pool_hit_count: stats.subtree_pool_hit_count as usize,
+            version_limit_hit_count: stats.version_limit_hit_count as usize,
+        }
+    }
+}
+
 impl From<ffi::TSRange> for Range {
     fn from(range: ffi::TSRange) -> Self {
         Self {
@@ -1912,6 +2311,9 @@ unsafe impl Send for Language {}
 unsafe impl Send for Parser {}
 unsafe impl Send for Query {}
 unsafe impl Send for Tree {}
+unsafe impl Send for TreeReclaimer {}
 unsafe impl Send for QueryCursor {}
 unsafe impl Sync for Language {}
 unsafe impl Sync for Query {}
+unsafe impl Sync for Tree {}
+unsafe impl Sync for TreeReclaimer {}
@@ -21,7 +21,7 @@ extern "C" {
  * The Tree-sitter library is generally backwards-compatible with languages
  * generated using older CLI versions, but is not forwards-compatible.
  */
-#define TREE_SITTER_LANGUAGE_VERSION 13
+#define TREE_SITTER_LANGUAGE_VERSION 14
 
 /**
  * The earliest ABI version that is supported by the current version of the
@@ -38,6 +38,7 @@ typedef uint16_t TSFieldId;
 typedef struct TSLanguage TSLanguage;
 typedef struct TSParser TSParser;
 typedef struct TSTree TSTree;
+typedef struct TSTreeReclaimer TSTreeReclaimer;
 typedef struct TSQuery TSQuery;
 typedef struct TSQueryCursor TSQueryCursor;
 
@@ -80,6 +81,12 @@ typedef struct {
   void (*log)(void *payload, TSLogType, const char *);
 } TSLogger;
 
+typedef struct {
+  void *payload;
+  void *(*malloc)(void *payload, size_t size);
+  void (*free)(void *payload, void *buffer, size_t size);
+} TSAllocator;
+
 typedef struct {
   uint32_t start_byte;
   uint32_t old_end_byte;
@@ -89,6 +96,31 @@ typedef struct {
   TSPoint new_end_point;
 } TSInputEdit;
 
+typedef struct {
+  uint32_t shift_count;
+  uint32_t reduce_count;
+  uint32_t lex_count;
+  uint32_t external_scanner_call_count;
+  uint32_t token_cache_hit_count;
+  uint32_t token_cache_miss_count;
+  uint32_t reused_node_count;
+  uint32_t reused_byte_count;
+  uint32_t max_version_count;
+  uint32_t condense_count;
+  uint32_t merge_count;
+  uint32_t recovery_count;
+  uint32_t subtree_allocation_count;
+  uint32_t subtree_pool_hit_count;
+  uint32_t version_limit_hit_count;
+} TSParseStats;
+
+typedef struct {
+  const uint64_t *parse_state_hits;
+  uint32_t parse_state_count;
+  const uint64_t *lex_state_hits;
+  uint32_t lex_state_count;
+} TSParseProfile;
+
 typedef struct {
   uint32_t context[4];
   const void *id;
@@ -276,6 +308,81 @@ TSTree *ts_parser_parse_string_encoding(
   TSInputEncoding encoding
 );
 
+/**
+ * Use the parser to parse some UTF8 source code stored in one contiguous
+ * buffer, splitting the work across up to `thread_count` threads.
+ *
+ * The buffer is divided into chunks at line boundaries that are likely to
+ * separate top-level nodes, and each chunk is parsed on its own thread with
+ * its own parser. The resulting trees are then joined under a single root
+ * node. If a seam between two chunks can't be joined cleanly, the text around
+ * it is reparsed serially, so the resulting tree has the same node types and
+ * ranges as the one that `ts_parser_parse_string` would produce. It is not
+ * identical, though: the tokens at the start of each chunk record the parse
+ * states of a parse that started there, rather than the ones that a serial
+ * parse would have reached. So when the tree is used as the old tree of an
+ * incremental parse, some of the nodes near the seams may not be reused.
+ *
+ * The parsers on the other threads use this parser's logger and dot graph
+ * file, so the logger may be called from any of the threads, though only from
+ * one of them at a time.
+ *
+ * Small documents, and parsers with custom included ranges, are always parsed
+ * serially. Unlike `ts_parser_parse`, a parse that is halted by a timeout or a
+ * cancellation can't be resumed: the parser is reset and NULL is returned.
+ */
+TSTree *ts_parser_parse_string_parallel(
+  TSParser *self,
+  const char *string,
+  uint32_t length,
+  uint32_t thread_count
+);
+
+/**
+ * Use the parser to parse a batch of independent documents, storing the
+ * resulting syntax trees in the `trees` array, which must have room for
+ * `count` trees.
+ *
+ * The parser keeps its allocation pools and caches between documents. If
+ * arena allocation is enabled (see `ts_parser_set_arena_enabled`), it also
+ * keeps allocating from the same arena, instead of starting a new arena for
+ * each document, which makes batches of small documents faster to parse
+ * than calling `ts_parser_parse` for each of them. The trees then share their
+ * arena, whose memory is only freed once all of them have been deleted, and
+ * deleting each tree takes as long as it does without arena allocation. If
+ * arena allocation is disabled, this is no faster than calling
+ * `ts_parser_parse` for each document in turn.
+ *
+ * A document whose parse is halted by a timeout gets a NULL tree, and parsing
+ * continues with the next document. If the parse is cancelled, the remaining
+ * documents all get NULL trees.
+ *
+ * Returns true if every document was parsed successfully.
+ */
+bool ts_parser_parse_batch(
+  TSParser *self,
+  const TSInput *inputs,
+  uint32_t count,
+  TSTree **trees
+);
+
+/**
+ * Use the parser to parse a batch of independent documents, spreading them
+ * across up to `thread_count` threads. This works the same as
+ * `ts_parser_parse_batch`, except that each thread uses its own parser,
+ * configured with this parser's language, included ranges, timeout,
+ * cancellation flag, logger and dot graph file. The input callbacks for
+ * different documents may be called concurrently. The logger may be called
+ * from any of the threads, though only from one of them at a time.
+ */
+bool ts_parser_parse_batch_parallel(
+  TSParser *self,
+  const TSInput *inputs,
+  uint32_t count,
+  TSTree **trees,
+  uint32_t thread_count
+);
+
 /**
  * Instruct the parser to start the next parse from the beginning.
  *
@@ -301,6 +408,132 @@ void ts_parser_set_timeout_micros(TSParser *self, uint64_t timeout);
  */
 uint64_t ts_parser_timeout_micros(const TSParser *self);
 
+/**
+ * Set the maximum number of stack versions that the parser keeps while it
+ * explores ambiguities and recovers from errors. The default is 6. The limit
+ * is clamped to be between 1 and 65535.
+ *
+ * Whenever there are more versions than this, the least promising ones are
+ * discarded. A higher limit can find better parses of ambiguous or erroneous
+ * code, at the cost of parsing more slowly. See the `version_limit_hit_count`
+ * statistic in `ts_parser_stats`.
+ */
+void ts_parser_set_version_limit(TSParser *self, uint32_t limit);
+
+/**
+ * Get the maximum number of stack versions that the parser keeps.
+ */
+uint32_t ts_parser_version_limit(const TSParser *self);
+
+/**
+ * Get statistics about the parser's most recent parse.
+ *
+ * The statistics are cleared when a new parse begins, but they keep
+ * accumulating when a parse that was halted by a timeout or a cancellation
+ * is resumed. They are always collected, so they can be used to explain
+ * slow parses in production. The `TSParseStats` struct has these fields:
+ * 1. `shift_count`, `reduce_count`: The number of shift and reduce actions
+ *    performed, across all stack versions.
+ * 2. `lex_count`: The number of times a token was lexed, and
+ *    `external_scanner_call_count`: the number of times the language's
+ *    external scanner was invoked while lexing.
+ * 3. `token_cache_hit_count`, `token_cache_miss_count`: How often a token
+ *    could be shared with another stack version instead of being lexed again.
+ * 4. `reused_node_count`, `reused_byte_count`: The number of nodes reused from
+ *    the old tree during an incremental parse, and the total size of those
+ *    nodes in bytes.
+ * 5. `max_version_count`: The largest number of stack versions that were
+ *    active at once, and `condense_count`, `merge_count`: the number of times
+ *    the stack versions were condensed, and the number of times two versions
+ *    were merged into one.
+ * 6. `recovery_count`: The number of error recovery attempts.
+ * 7. `subtree_allocation_count`: The number of subtrees allocated by the
+ *    parser, both leaves and internal nodes, and `subtree_pool_hit_count`: the
+ *    number of those that reused memory from previously freed leaves.
+ * 8. `version_limit_hit_count`: The number of times that stack versions were
+ *    discarded, or not created, because there were already as many versions
+ *    as the parser's version limit allows.
+ */
+void ts_parser_stats(const TSParser *self, TSParseStats *stats);
+
+/**
+ * Enable or disable the recording of a parse table profile.
+ *
+ * While profiling is enabled, the parser counts how many times it looks up
+ * the actions of each parse state, and how many times it starts lexing a token
+ * in each lex state. Unlike the statistics returned by `ts_parser_stats`, these
+ * counts accumulate across parses, so that they can be recorded over a sample
+ * corpus. The generator can then use them to lay out the language's parse
+ * table so that the most frequently used states are the cheapest to access.
+ *
+ * Enabling profiling, or assigning a different language, clears the counts.
+ */
+void ts_parser_set_profiling_enabled(TSParser *self, bool enabled);
+
+/**
+ * Get the parse table profile that has been recorded since profiling was
+ * enabled. The `parse_state_hits` array is indexed by parse state, and the
+ * `lex_state_hits` array is indexed by the lex state in which lexing started.
+ * Both arrays are owned by the parser. If profiling is disabled, they are
+ * empty.
+ */
+void ts_parser_profile(const TSParser *self, TSParseProfile *profile);
+
+/**
+ * Enable or disable arena allocation of syntax nodes.
+ *
+ * While arena allocation is enabled, the nodes that are created during each
+ * parse are allocated from a few large blocks of memory that belong to the
+ * resulting tree, instead of being allocated individually. If none of the
+ * tree's nodes have been shared with another tree, through incremental
+ * parsing, editing or `ts_tree_copy`, then deleting the tree frees these
+ * blocks all at once, without visiting its nodes. Otherwise, the blocks are
+ * freed once all of the nodes in them have been released.
+ *
+ * Nodes that are discarded during a parse are not reclaimed until the
+ * tree's blocks are freed, so parses with a lot of ambiguity or error
+ * recovery can use more memory. This takes effect at the start of the next
+ * parse.
+ */
+void ts_parser_set_arena_enabled(TSParser *self, bool enabled);
+
+/**
+ * Check whether arena allocation of syntax nodes is enabled.
+ */
+bool ts_parser_arena_enabled(const TSParser *self);
+
+/**
+ * Set the allocator that the parser should use for the memory of the nodes
+ * of the trees that it produces. Pass `NULL` to go back to the library's own
+ * allocation functions.
+ *
+ * The allocator only supplies the large blocks of memory from which the parser
+ * allocates nodes, so setting an allocator also enables arena allocation (see
+ * `ts_parser_set_arena_enabled`). The same goes for the block that holds the
+ * nodes of a frozen tree (see `ts_tree_freeze`). Everything else, including
+ * the `TSTree` itself, its included ranges, its caches and index, and the
+ * copies of nodes that `ts_tree_edit` makes, is allocated with the library's
+ * own allocation functions, as is the parser's own memory.
+ *
+ * Each tree keeps a copy of the allocator that it was created with, and
+ * returns its memory to that allocator when it is freed, so the allocator's
+ * payload must remain valid for as long as any of those trees, or any trees
+ * derived from them, are alive. Both `malloc` and `free` must be set; an
+ * allocator that is missing either of them is ignored, as if `NULL` had been
+ * passed. The `malloc` function must not return `NULL`, and `free` is given
+ * the size that was originally requested. If the parser is used to parse in
+ * parallel, these functions may be called from several threads at once.
+ *
+ * This takes effect at the start of the next parse.
+ */
+void ts_parser_set_allocator(TSParser *self, const TSAllocator *allocator);
+
+/**
+ * Get the parser's allocator, or `NULL` if it uses the library's own
+ * allocation functions.
+ */
+const TSAllocator *ts_parser_allocator(const TSParser *self);
+
 /**
  * Set the parser's current cancellation flag pointer.
  *
@@ -344,8 +577,9 @@ void ts_parser_print_dot_graphs(TSParser *self, int file);
 /**
  * Create a shallow copy of the syntax tree. This is very fast.
  *
- * You need to copy a syntax tree in order to use it on more than one thread at
- * a time, as syntax trees are not thread safe.
+ * Several threads can read the same syntax tree at once, by navigating its
+ * nodes, walking it with tree cursors, or running queries on it. You need to
+ * copy the tree before editing it while other threads are still using it.
  */
 TSTree *ts_tree_copy(const TSTree *self);
 
@@ -354,6 +588,36 @@ TSTree *ts_tree_copy(const TSTree *self);
  */
 void ts_tree_delete(TSTree *self);
 
+/**
+ * Create a new queue of syntax trees whose memory should be freed later.
+ */
+TSTreeReclaimer *ts_tree_reclaimer_new(void);
+
+/**
+ * Delete a tree reclaimer, first freeing all of the trees that are still
+ * queued in it.
+ */
+void ts_tree_reclaimer_delete(TSTreeReclaimer *self);
+
+/**
+ * Delete the syntax tree without freeing its memory right away. The tree is
+ * added to the given reclaimer's queue, and its memory is freed by later
+ * calls to `ts_tree_reclaimer_drain`. This takes constant time, and it can be
+ * called from any thread, including while another thread is draining the
+ * reclaimer.
+ */
+void ts_tree_delete_deferred(TSTree *self, TSTreeReclaimer *reclaimer);
+
+/**
+ * Free the memory of trees that have been queued in the reclaimer, freeing
+ * at most `max_node_count` nodes. This can be called periodically from a
+ * background thread, or whenever the application is idle.
+ *
+ * Returns `true` if there may be more memory left to free. If another thread
+ * is already draining the reclaimer, this returns `true` immediately.
+ */
+bool ts_tree_reclaimer_drain(TSTreeReclaimer *self, uint32_t max_node_count);
+
 /**
  * Get the root node of the syntax tree.
  */
@@ -364,6 +628,81 @@ TSNode ts_tree_root_node(const TSTree *self);
  */
 const TSLanguage *ts_tree_language(const TSTree *);
 
+/**
+ * Build an index of the syntax tree's nodes, so that finding a node's parent
+ * or siblings takes constant time, instead of searching the tree.
+ *
+ * This visits every node in the tree once, and uses about 48 bytes of memory
+ * per node. It is worthwhile for trees that are walked many times using
+ * `ts_node_parent` and the sibling functions. The index is discarded if the
+ * tree is edited. Like editing, this must not be done while other threads are
+ * using the tree.
+ */
+void ts_tree_build_index(TSTree *self);
+
+/**
+ * Compact the syntax tree's memory, for trees that will be kept for a long
+ * time without being re-parsed.
+ *
+ * This copies the tree's nodes into a single block of memory, in the order
+ * that a depth-first traversal visits them, and frees the original nodes
+ * unless they are shared with another tree. Nodes that were discarded during
+ * the parse, and unused space left over from parsing, are not kept. If the
+ * tree was parsed with an allocator (see `ts_parser_set_allocator`), the
+ * block comes from the same allocator.
+ *
+ * The copied nodes use a smaller layout that leaves out the fields that the
+ * parser only needs while parsing, such as reference counts, error costs and
+ * most of the lexer's bookkeeping on internal nodes, and leaves with identical
+ * contents are only stored once. This typically saves a third or more of the
+ * tree's memory, and more when it was parsed with an arena.
+ *
+ * Nodes, tree cursors and queries read the compact nodes directly and work
+ * the same way on the frozen tree, but its nodes have new ids, so any
+ * `TSNode` or `TSTreeCursor` that was created from the tree beforehand must
+ * not be used afterwards. The tree can still be edited and used for
+ * incremental parsing. An edit only copies the nodes that contain the edited
+ * range back into the parser's layout, and the rest stay compact and are
+ * shared with any parse that reuses them. Like editing, freezing must not be
+ * done while other threads are using the tree.
+ */
+void ts_tree_freeze(TSTree *self);
+
+/**
+ * Serialize the syntax tree into a binary format, so that it can be saved
+ * and read again later using `ts_tree_open_mapped`. The serialized tree
+ * includes the state of the language's external scanner, so it can be used
+ * for incremental parsing.
+ *
+ * The format stores the tree's nodes in the compact layout of a frozen tree
+ * (see `ts_tree_freeze`), so it can only be read by the same version of the
+ * library, on the same kind of platform, using the same version of the
+ * language.
+ *
+ * The returned buffer is allocated with `malloc` and the caller is
+ * responsible for freeing it using `free`. Its length is written to the
+ * `length` parameter.
+ */
+char *ts_tree_serialize(const TSTree *self, size_t *length);
+
+/**
+ * Read a syntax tree that was serialized using `ts_tree_serialize`.
+ *
+ * The data is typically a read-only memory mapping of a file. It is not
+ * parsed node by node: the tree's nodes are copied out of it all at once,
+ * and then linked together in one pass, so the data can be unmapped as soon
+ * as this function returns. The result behaves like a tree that has been
+ * frozen using `ts_tree_freeze`.
+ *
+ * Returns `NULL` if the data was not written by this version of the library,
+ * or was written using a different language or version of the language, or
+ * has been truncated or corrupted. These checks are meant to catch stale
+ * files, so the data should still come from a trusted source. The language is
+ * identified by a hash of its parse table, which is computed each time a tree
+ * is serialized or read, and takes time proportional to the table's size.
+ */
+TSTree *ts_tree_open_mapped(const TSLanguage *language, const void *data, size_t length);
+
 /**
  * Edit the syntax tree to keep it in sync with source code that has been
  * edited.
@@ -373,6 +712,17 @@ const TSLanguage *ts_tree_language(const TSTree *);
  */
 void ts_tree_edit(TSTree *self, const TSInputEdit *edit);
 
+/**
+ * Edit the syntax tree to reflect several edits to the source code at once.
+ *
+ * This has the same effect as calling `ts_tree_edit` with each of the edits
+ * in order, so each edit must be described in terms of the document as it is
+ * after the preceding edits. When the edits are sorted by position and don't
+ * overlap, as with multiple cursors or the output of a formatter, the tree is
+ * only traversed once, and each node is copied at most once.
+ */
+void ts_tree_edit_batch(TSTree *self, const TSInputEdit *edits, uint32_t count);
+
 /**
  * Compare an old edited syntax tree to a new syntax tree representing the same
  * document, returning an array of ranges whose syntactic structure has changed.
@@ -506,6 +856,11 @@ TSNode ts_node_named_child(TSNode, uint32_t);
  */
 uint32_t ts_node_named_child_count(TSNode);
 
+/**
+ * Get the node's number of descendants, including one for the node itself.
+ */
+uint32_t ts_node_descendant_count(TSNode);
+
 /**
  * Get the node's child with the given field name.
  */
@@ -635,6 +990,14 @@ bool ts_tree_cursor_goto_parent(TSTreeCursor *);
  */
 bool ts_tree_cursor_goto_next_sibling(TSTreeCursor *);
 
+/**
+ * Move the cursor to the previous sibling of its current node.
+ *
+ * This returns `true` if the cursor successfully moved, and returns `false`
+ * if there was no previous sibling node.
+ */
+bool ts_tree_cursor_goto_previous_sibling(TSTreeCursor *);
+
 /**
  * Move the cursor to the first child of its current node.
  *
@@ -652,6 +1015,20 @@ bool ts_tree_cursor_goto_first_child(TSTreeCursor *);
  */
 int64_t ts_tree_cursor_goto_first_child_for_byte(TSTreeCursor *, uint32_t);
 
+/**
+ * Move the cursor to the node that is the nth descendant of the node that
+ * the cursor was constructed with, where zero represents that original node
+ * itself. The cursor skips over whole subtrees that precede the goal node,
+ * using their descendant counts.
+ */
+void ts_tree_cursor_goto_descendant(TSTreeCursor *, uint32_t);
+
+/**
+ * Get the index of the cursor's current node out of all of the descendants
+ * of the node that the cursor was constructed with, in preorder.
+ */
+uint32_t ts_tree_cursor_current_descendant_index(const TSTreeCursor *);
+
 TSTreeCursor ts_tree_cursor_copy(const TSTreeCursor *);
 
 /*******************/
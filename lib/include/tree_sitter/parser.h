@@ -87,6 +87,12 @@ typedef union {
   } entry;
 } TSParseActionEntry;
 
+typedef struct {
+  const char *text;
+  uint16_t length;
+  TSSymbol symbol;
+} TSKeywordEntry;
+
 struct TSLanguage {
   uint32_t version;
   uint32_t symbol_count;
@@ -123,6 +129,14 @@ struct TSLanguage {
     unsigned (*serialize)(void *, char *);
     void (*deserialize)(void *, const char *, unsigned);
   } external_scanner;
+  struct {
+    const TSKeywordEntry *entries;
+    const uint16_t *displacements;
+    uint32_t bucket_count;
+    uint32_t slot_count;
+    uint32_t seed;
+    uint32_t max_length;
+  } keyword_hash;
 };
 
 /*
@@ -161,6 +175,89 @@ struct TSLanguage {
 
 #define END_STATE() return result;
 
+/*
+ *  Lexer Tables
+ *
+ *  Instead of a `switch` statement, a lex function can be generated as a
+ *  set of transition tables, which are then interpreted by `ts_lex_table_run`.
+ *  Characters are first mapped to character classes: the first 256 code
+ *  points via a direct lookup, and all others via a binary search over
+ *  sorted ranges. Each lex state then has a row of transitions, indexed by
+ *  character class. A transition is either zero, meaning that lexing stops,
+ *  or the next state plus one, with the `TS_LEX_TABLE_SKIP` bit set if the
+ *  character should be skipped rather than included in the token.
+ */
+
+#define TS_LEX_TABLE_SKIP 0x8000
+
+typedef struct {
+  int32_t start;
+  int32_t end;
+  uint16_t character_class;
+} TSLexTableRange;
+
+typedef struct {
+  TSSymbol accept_symbol;
+  uint16_t eof_transition;
+  uint16_t row;
+  bool accepts;
+} TSLexTableState;
+
+typedef struct {
+  const uint16_t *character_classes;
+  const TSLexTableRange *ranges;
+  uint32_t range_count;
+  uint16_t invalid_character_class;
+  uint16_t character_class_count;
+  const TSLexTableState *states;
+  const uint16_t *transitions;
+} TSLexTable;
+
+static inline uint16_t ts_lex_table_character_class(const TSLexTable *self, int32_t c) {
+  if (c < 0) return self->invalid_character_class;
+  if (c < 256) return self->character_classes[c];
+  uint32_t start = 0;
+  uint32_t end = self->range_count;
+  while (start < end) {
+    uint32_t mid = start + (end - start) / 2;
+    const TSLexTableRange *range = &self->ranges[mid];
+    if (c < range->start) {
+      end = mid;
+    } else if (c > range->end) {
+      start = mid + 1;
+    } else {
+      return range->character_class;
+    }
+  }
+  return self->invalid_character_class;
+}
+
+static inline bool ts_lex_table_run(const TSLexTable *self, TSLexer *lexer, TSStateId state) {
+  bool result = false;
+  for (;;) {
+    const TSLexTableState *entry = &self->states[state];
+    if (entry->accepts) {
+      result = true;
+      lexer->result_symbol = entry->accept_symbol;
+      lexer->mark_end(lexer);
+    }
+
+    uint16_t transition;
+    if (entry->eof_transition && lexer->eof(lexer)) {
+      transition = entry->eof_transition;
+    } else {
+      uint16_t character_class = ts_lex_table_character_class(self, lexer->lookahead);
+      transition = self->transitions[
+        (uint32_t)entry->row * self->character_class_count + character_class
+      ];
+    }
+    if (!transition) return result;
+
+    lexer->advance(lexer, transition & TS_LEX_TABLE_SKIP);
+    state = (TSStateId)((transition & ~TS_LEX_TABLE_SKIP) - 1);
+  }
+}
+
 /*
  *  Parse Table Macros
  */
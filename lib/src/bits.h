@@ -20,6 +20,16 @@ static inline uint32_t count_leading_zeros(uint32_t x) {
   return count;
 }
 
+static inline uint32_t count_trailing_zeros(uint32_t x) {
+  if (x == 0) return 32;
+  uint32_t count = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    count++;
+  }
+  return count;
+}
+
 #elif defined _WIN32 && !defined __GNUC__
 
 #include <intrin.h>
@@ -31,6 +41,13 @@ static inline uint32_t count_leading_zeros(uint32_t x) {
   return 31 - result;
 }
 
+static inline uint32_t count_trailing_zeros(uint32_t x) {
+  if (x == 0) return 32;
+  uint32_t result;
+  _BitScanForward(&result, x);
+  return result;
+}
+
 #else
 
 static inline uint32_t count_leading_zeros(uint32_t x) {
@@ -38,5 +55,10 @@ static inline uint32_t count_leading_zeros(uint32_t x) {
   return __builtin_clz(x);
 }
 
+static inline uint32_t count_trailing_zeros(uint32_t x) {
+  if (x == 0) return 32;
+  return __builtin_ctz(x);
+}
+
 #endif
 #endif  // TREE_SITTER_BITS_H_
@@ -15,6 +15,35 @@ uint32_t ts_language_field_count(const TSLanguage *self) {
   return self->field_count;
 }
 
+// Find the keyword whose text matches the given string, using the perfect hash
+// generated for the language's keywords. The hash must be computed exactly as
+// it is in the CLI's `build_keyword_table` module.
+bool ts_language_keyword_symbol(
+  const TSLanguage *self,
+  const char *text,
+  uint32_t length,
+  TSSymbol *symbol
+) {
+  uint64_t hash = 0xcbf29ce484222325ull ^ self->keyword_hash.seed;
+  for (uint32_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)text[i];
+    hash *= 0x100000001b3ull;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+
+  uint32_t high = (uint32_t)(hash >> 32);
+  uint32_t displacement = self->keyword_hash.displacements[high % self->keyword_hash.bucket_count];
+  uint32_t slot = ((uint32_t)hash + displacement * (high | 1)) & (self->keyword_hash.slot_count - 1);
+  const TSKeywordEntry *entry = &self->keyword_hash.entries[slot];
+  if (entry->text && entry->length == length && memcmp(entry->text, text, length) == 0) {
+    *symbol = entry->symbol;
+    return true;
+  }
+  return false;
+}
+
 void ts_language_table_entry(
   const TSLanguage *self,
   TSStateId state,
@@ -9,6 +9,8 @@ extern "C" {
 #include "tree_sitter/parser.h"
 
 #define ts_builtin_sym_error_repeat (ts_builtin_sym_error - 1)
+#define LANGUAGE_VERSION_WITH_KEYWORD_HASH 14
+#define LANGUAGE_VERSION_WITH_SORTED_SMALL_STATES 14
 
 typedef struct {
   const TSParseAction *actions;
@@ -20,6 +22,7 @@ typedef struct {
   const TSLanguage *language;
   const uint16_t *data;
   const uint16_t *group_end;
+  const uint16_t *values;
   TSStateId state;
   uint16_t table_value;
   uint16_t section_index;
@@ -38,6 +41,14 @@ TSSymbolMetadata ts_language_symbol_metadata(const TSLanguage *, TSSymbol);
 
 TSSymbol ts_language_public_symbol(const TSLanguage *, TSSymbol);
 
+bool ts_language_keyword_symbol(const TSLanguage *, const char *, uint32_t, TSSymbol *);
+
+static inline bool ts_language_has_keyword_hash(const TSLanguage *self) {
+  return
+    self->version >= LANGUAGE_VERSION_WITH_KEYWORD_HASH &&
+    self->keyword_hash.slot_count > 0;
+}
+
 static inline bool ts_language_is_symbol_external(const TSLanguage *self, TSSymbol symbol) {
   return 0 < symbol && symbol < self->external_token_count + 1;
 }
@@ -69,8 +80,10 @@ static inline bool ts_language_has_reduce_action(
 // For non-terminal symbols, the table value represents a successor state.
 // For terminal symbols, it represents an index in the actions table.
 // For 'large' parse states, this is a direct lookup. For 'small' parse
-// states, this requires searching through the symbol groups to find
-// the given symbol.
+// states, this requires searching for the given symbol, either with a
+// binary search through the state's sorted symbols, or, in languages
+// generated before that representation existed, with a linear scan
+// through the symbol groups.
 static inline uint16_t ts_language_lookup(
   const TSLanguage *self,
   TSStateId state,
@@ -79,6 +92,18 @@ static inline uint16_t ts_language_lookup(
   if (state >= self->large_state_count) {
     uint32_t index = self->small_parse_table_map[state - self->large_state_count];
     const uint16_t *data = &self->small_parse_table[index];
+    if (self->version >= LANGUAGE_VERSION_WITH_SORTED_SMALL_STATES) {
+      uint16_t symbol_count = *(data++);
+      if (symbol_count == 0) return 0;
+      const uint16_t *base = data;
+      for (uint16_t size = symbol_count; size > 1;) {
+        uint16_t half = size / 2;
+        base = base[half] <= symbol ? base + half : base;
+        size -= half;
+      }
+      return *base == symbol ? base[symbol_count] : 0;
+    }
+
     uint16_t group_count = *(data++);
     for (unsigned i = 0; i < group_count; i++) {
       uint16_t section_value = *(data++);
@@ -114,12 +139,18 @@ static inline LookaheadIterator ts_language_lookaheads(
   bool is_small_state = state >= self->large_state_count;
   const uint16_t *data;
   const uint16_t *group_end = NULL;
+  const uint16_t *values = NULL;
   uint16_t group_count = 0;
   if (is_small_state) {
     uint32_t index = self->small_parse_table_map[state - self->large_state_count];
     data = &self->small_parse_table[index];
-    group_end = data + 1;
-    group_count = *data;
+    if (self->version >= LANGUAGE_VERSION_WITH_SORTED_SMALL_STATES) {
+      group_end = data + 1 + *data;
+      values = group_end;
+    } else {
+      group_end = data + 1;
+      group_count = *data;
+    }
   } else {
     data = &self->parse_table[state * self->symbol_count] - 1;
   }
@@ -127,6 +158,7 @@ static inline LookaheadIterator ts_language_lookaheads(
     .language = self,
     .data = data,
     .group_end = group_end,
+    .values = values,
     .group_count = group_count,
     .is_small_state = is_small_state,
     .symbol = UINT16_MAX,
@@ -135,12 +167,17 @@ static inline LookaheadIterator ts_language_lookaheads(
 }
 
 static inline bool ts_lookahead_iterator_next(LookaheadIterator *self) {
-  // For small parse states, valid symbols are listed explicitly,
-  // grouped by their value. There's no need to look up the actions
-  // again until moving to the next group.
+  // For small parse states, valid symbols are listed explicitly. In the
+  // sorted representation, each symbol has its own value. Otherwise, the
+  // symbols are grouped by their value, and there's no need to look up the
+  // actions again until moving to the next group.
   if (self->is_small_state) {
     self->data++;
-    if (self->data == self->group_end) {
+    if (self->values) {
+      if (self->data == self->group_end) return false;
+      self->symbol = *self->data;
+      self->table_value = *(self->values++);
+    } else if (self->data == self->group_end) {
       if (self->group_count == 0) return false;
       self->group_count--;
       self->table_value = *(self->data++);
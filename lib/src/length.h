@@ -36,6 +36,10 @@ static inline Length length_sub(Length len1, Length len2) {
   return result;
 }
 
+static inline bool length_eq(Length len1, Length len2) {
+  return len1.bytes == len2.bytes && point_eq(len1.extent, len2.extent);
+}
+
 static inline Length length_zero(void) {
   Length result = {0, {0, 0}};
   return result;
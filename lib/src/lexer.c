@@ -36,6 +36,11 @@ static const TSRange DEFAULT_RANGE = {
   .end_byte = UINT32_MAX
 };
 
+// The number of bytes that are classified at a time when looking for the
+// end of a run of ASCII characters. Runs are extended lazily, one block at
+// a time, so the lexer never scans far beyond the characters it consumes.
+static const uint32_t ASCII_RUN_SCAN_SIZE = 128;
+
 // Check if the lexer has reached EOF. This state is stored
 // by setting the lexer's `current_included_range_index` such that
 // it has consumed all of its available ranges.
@@ -50,18 +55,32 @@ static void ts_lexer__clear_chunk(Lexer *self) {
   self->chunk = NULL;
   self->chunk_size = 0;
   self->chunk_start = 0;
+  self->ascii_run_start = 0;
+  self->ascii_run_end = 0;
 }
 
 // Call the lexer's input callback to obtain a new chunk of source code
-// for the current position.
+// for the current position. When the input is a contiguous string, the
+// whole string is used as the chunk instead.
 static void ts_lexer__get_chunk(Lexer *self) {
-  self->chunk_start = self->current_position.bytes;
-  self->chunk = self->input.read(
-    self->input.payload,
-    self->current_position.bytes,
-    self->current_position.extent,
-    &self->chunk_size
-  );
+  if (self->string) {
+    if (self->current_position.bytes < self->string_length) {
+      self->chunk_start = 0;
+      self->chunk = self->string;
+      self->chunk_size = self->string_length;
+    } else {
+      self->chunk_start = self->current_position.bytes;
+      self->chunk_size = 0;
+    }
+  } else {
+    self->chunk_start = self->current_position.bytes;
+    self->chunk = self->input.read(
+      self->input.payload,
+      self->current_position.bytes,
+      self->current_position.extent,
+      &self->chunk_size
+    );
+  }
   if (!self->chunk_size) {
     self->current_included_range_index = self->included_range_count;
     self->chunk = NULL;
@@ -89,8 +108,9 @@ static void ts_lexer__get_lookahead(Lexer *self) {
   self->lookahead_size = decode(chunk, size, &self->data.lookahead);
 
   // If this chunk ended in the middle of a multi-byte character,
-  // try again with a fresh chunk.
-  if (self->data.lookahead == TS_DECODE_ERROR && size < 4) {
+  // try again with a fresh chunk. A string input is a single chunk,
+  // so there is nothing more to retrieve.
+  if (self->data.lookahead == TS_DECODE_ERROR && size < 4 && !self->string) {
     ts_lexer__get_chunk(self);
     chunk = (const uint8_t *)self->chunk;
     size = self->chunk_size;
@@ -102,7 +122,108 @@ static void ts_lexer__get_lookahead(Lexer *self) {
   }
 }
 
+// Get the byte offset where the current run of ASCII characters has to end,
+// because either the current chunk or the current included range ends there.
+static uint32_t ts_lexer__ascii_run_limit(const Lexer *self) {
+  uint32_t end = self->chunk_start + self->chunk_size;
+  const TSRange *current_range = &self->included_ranges[self->current_included_range_index];
+  if (current_range->end_byte < end) end = current_range->end_byte;
+  return end;
+}
+
+// If the lookahead character is ASCII, start a run of ASCII characters
+// there, not including newlines. Until the lexer reaches the end of that
+// run, it can advance without decoding any characters, and without
+// computing columns.
+static void ts_lexer__find_ascii_run(Lexer *self) {
+#ifdef TREE_SITTER_DISABLE_ASCII_RUNS
+  return;
+#endif
+
+  if (
+    self->input.encoding != TSInputEncodingUTF8 ||
+    self->current_included_range_index == self->included_range_count
+  ) return;
+
+  uint32_t position = self->current_position.bytes;
+  uint32_t end = ts_lexer__ascii_run_limit(self);
+  if (position >= end) return;
+  if (end - position > ASCII_RUN_SCAN_SIZE) end = position + ASCII_RUN_SCAN_SIZE;
+
+  const uint8_t *chunk = (const uint8_t *)self->chunk + position - self->chunk_start;
+  uint32_t length = ts_ascii_run_length(chunk, end - position);
+  if (!length) return;
+  self->ascii_run_start = position;
+  self->ascii_run_end = position + length;
+  self->ascii_run_column = self->current_position.extent.column;
+}
+
+// Classify the next block of bytes after the current run of ASCII
+// characters, and extend the run with the ones that are ASCII as well.
+// Returns false if the run can't be extended.
+static bool ts_lexer__extend_ascii_run(Lexer *self) {
+  if (!self->ascii_run_end) return false;
+  uint32_t end = ts_lexer__ascii_run_limit(self);
+  if (self->ascii_run_end >= end) return false;
+  uint32_t size = end - self->ascii_run_end;
+  if (size > ASCII_RUN_SCAN_SIZE) size = ASCII_RUN_SCAN_SIZE;
+
+  const uint8_t *chunk = (const uint8_t *)self->chunk + self->ascii_run_end - self->chunk_start;
+  uint32_t length = ts_ascii_run_length(chunk, size);
+  self->ascii_run_end += length;
+  return length > 0;
+}
+
+// Within a run of ASCII characters, the lexer only keeps track of byte
+// offsets. The run doesn't contain any newlines, so the columns of the
+// positions in the run are computed from their offsets when they are needed.
+static inline void ts_lexer__sync_ascii_run(Lexer *self) {
+  uint32_t start = self->ascii_run_start;
+  uint32_t length = self->ascii_run_end - start;
+  uint32_t column = self->ascii_run_column - start;
+  if (self->current_position.bytes - start < length) {
+    self->current_position.extent.column = column + self->current_position.bytes;
+  }
+  if (self->token_start_position.bytes - start < length) {
+    self->token_start_position.extent.column = column + self->token_start_position.bytes;
+  }
+  if (
+    self->token_end_position.bytes - start < length &&
+    !length_is_undefined(self->token_end_position)
+  ) {
+    self->token_end_position.extent.column = column + self->token_end_position.bytes;
+  }
+}
+
+// Stop advancing through the current run of ASCII characters.
+static inline void ts_lexer__leave_ascii_run(Lexer *self) {
+  ts_lexer__sync_ascii_run(self);
+  self->ascii_run_start = 0;
+  self->ascii_run_end = 0;
+}
+
+// Advance to the next character within the current run of ASCII characters,
+// extending the run if needed. Only the byte offset is updated. Returns
+// false if the next character is not part of the run.
+static inline bool ts_lexer__advance_in_ascii_run(Lexer *self, bool skip) {
+  uint32_t position = self->current_position.bytes + 1;
+  if (position >= self->ascii_run_end && !ts_lexer__extend_ascii_run(self)) return false;
+  self->current_position.bytes = position;
+  self->data.lookahead = (uint8_t)self->chunk[position - self->chunk_start];
+  if (skip) self->token_start_position = self->current_position;
+  return true;
+}
+
 static void ts_lexer_goto(Lexer *self, Length position) {
+  // Keep the current run of ASCII characters if the new position is inside
+  // of it. The lexer often moves back a few characters, for example after
+  // an external scanner fails to find a token.
+  if (position.bytes - self->ascii_run_start < self->ascii_run_end - self->ascii_run_start) {
+    ts_lexer__sync_ascii_run(self);
+  } else {
+    ts_lexer__leave_ascii_run(self);
+  }
+
   self->current_position = position;
   bool found_included_range = false;
 
@@ -152,18 +273,10 @@ static void ts_lexer_goto(Lexer *self, Length position) {
   }
 }
 
-// Advance to the next character in the source code, retrieving a new
-// chunk of source code if needed.
-static void ts_lexer__advance(TSLexer *_self, bool skip) {
-  Lexer *self = (Lexer *)_self;
-  if (!self->chunk) return;
-
-  if (skip) {
-    LOG("skip", self->data.lookahead);
-  } else {
-    LOG("consume", self->data.lookahead);
-  }
-
+// Move the current position past the lookahead character, and into the
+// next included range if needed. Returns false if the lexer has moved
+// past the last included range.
+static inline bool ts_lexer__advance_position(Lexer *self, bool skip) {
   if (self->lookahead_size) {
     self->current_position.bytes += self->lookahead_size;
     if (self->data.lookahead == '\n') {
@@ -192,12 +305,30 @@ static void ts_lexer__advance(TSLexer *_self, bool skip) {
   }
 
   if (skip) self->token_start_position = self->current_position;
+  return current_range;
+}
 
-  if (current_range) {
+// Advance to the next character in the source code, retrieving a new
+// chunk of source code if needed.
+static void ts_lexer__advance(TSLexer *_self, bool skip) {
+  Lexer *self = (Lexer *)_self;
+  if (!self->chunk) return;
+
+  if (skip) {
+    LOG("skip", self->data.lookahead);
+  } else {
+    LOG("consume", self->data.lookahead);
+  }
+
+  if (ts_lexer__advance_in_ascii_run(self, skip)) return;
+  ts_lexer__leave_ascii_run(self);
+
+  if (ts_lexer__advance_position(self, skip)) {
     if (self->current_position.bytes >= self->chunk_start + self->chunk_size) {
       ts_lexer__get_chunk(self);
     }
     ts_lexer__get_lookahead(self);
+    ts_lexer__find_ascii_run(self);
   } else {
     ts_lexer__clear_chunk(self);
     self->data.lookahead = '\0';
@@ -205,6 +336,42 @@ static void ts_lexer__advance(TSLexer *_self, bool skip) {
   }
 }
 
+// Advance to the next character in a contiguous UTF8 string. The whole
+// string is the lexer's chunk, so there is never a new chunk to retrieve,
+// and ASCII characters are decoded inline.
+static void ts_lexer__advance_string(TSLexer *_self, bool skip) {
+  Lexer *self = (Lexer *)_self;
+  if (!self->chunk) return;
+  if (self->logger.log) {
+    ts_lexer__advance(_self, skip);
+    return;
+  }
+
+  if (ts_lexer__advance_in_ascii_run(self, skip)) return;
+  ts_lexer__leave_ascii_run(self);
+
+  if (ts_lexer__advance_position(self, skip)) {
+    uint32_t position = self->current_position.bytes;
+    if (position < self->string_length) {
+      const uint8_t *string = (const uint8_t *)self->string + position;
+      if (*string < 0x80) {
+        self->data.lookahead = *string;
+        self->lookahead_size = 1;
+        ts_lexer__find_ascii_run(self);
+      } else {
+        self->lookahead_size = ts_decode_utf8(string, self->string_length - position, &self->data.lookahead);
+        if (self->data.lookahead == TS_DECODE_ERROR) self->lookahead_size = 1;
+      }
+      return;
+    }
+    self->current_included_range_index = self->included_range_count;
+  }
+
+  ts_lexer__clear_chunk(self);
+  self->data.lookahead = '\0';
+  self->lookahead_size = 1;
+}
+
 // Mark that a token match has completed. This can be called multiple
 // times if a longer match is found later.
 static void ts_lexer__mark_end(TSLexer *_self) {
@@ -234,6 +401,7 @@ static void ts_lexer__mark_end(TSLexer *_self) {
 static uint32_t ts_lexer__get_column(TSLexer *_self) {
   Lexer *self = (Lexer *)_self;
   self->did_get_column = true;
+  ts_lexer__sync_ascii_run(self);
   return self->current_position.extent.column;
 }
 
@@ -265,8 +433,13 @@ void ts_lexer_init(Lexer *self) {
       .result_symbol = 0,
     },
     .chunk = NULL,
+    .string = NULL,
+    .string_length = 0,
     .chunk_size = 0,
     .chunk_start = 0,
+    .ascii_run_start = 0,
+    .ascii_run_end = 0,
+    .ascii_run_column = 0,
     .current_position = {0, {0, 0}},
     .logger = {
       .payload = NULL,
@@ -285,6 +458,20 @@ void ts_lexer_delete(Lexer *self) {
 
 void ts_lexer_set_input(Lexer *self, TSInput input) {
   self->input = input;
+  self->string = NULL;
+  self->string_length = 0;
+  self->data.advance = ts_lexer__advance;
+  ts_lexer__clear_chunk(self);
+  ts_lexer_goto(self, self->current_position);
+}
+
+// Use a contiguous UTF8 string as the lexer's input. This avoids the input
+// callback entirely, and lets the lexer use a faster `advance` function.
+void ts_lexer_set_string_input(Lexer *self, const char *string, uint32_t length) {
+  self->input = (TSInput) {NULL, NULL, TSInputEncodingUTF8};
+  self->string = string;
+  self->string_length = length;
+  self->data.advance = ts_lexer__advance_string;
   ts_lexer__clear_chunk(self);
   ts_lexer_goto(self, self->current_position);
 }
@@ -298,6 +485,7 @@ void ts_lexer_reset(Lexer *self, Length position) {
 }
 
 void ts_lexer_start(Lexer *self) {
+  ts_lexer__sync_ascii_run(self);
   self->token_start_position = self->current_position;
   self->token_end_position = LENGTH_UNDEFINED;
   self->data.result_symbol = 0;
@@ -316,6 +504,7 @@ void ts_lexer_finish(Lexer *self, uint32_t *lookahead_end_byte) {
   if (length_is_undefined(self->token_end_position)) {
     ts_lexer__mark_end(&self->data);
   }
+  ts_lexer__sync_ascii_run(self);
 
   uint32_t current_lookahead_end_byte = self->current_position.bytes + 1;
 
@@ -332,6 +521,13 @@ void ts_lexer_finish(Lexer *self, uint32_t *lookahead_end_byte) {
   }
 }
 
+// Advance past the lookahead character outside of a lex function. The
+// lexer's position is kept up to date, so it can be read directly.
+void ts_lexer_advance(Lexer *self, bool skip) {
+  self->data.advance(&self->data, skip);
+  ts_lexer__sync_ascii_run(self);
+}
+
 void ts_lexer_advance_to_end(Lexer *self) {
   while (self->chunk) {
     ts_lexer__advance(&self->data, false);
@@ -342,6 +538,34 @@ void ts_lexer_mark_end(Lexer *self) {
   ts_lexer__mark_end(&self->data);
 }
 
+// Get a pointer to the UTF8 text between the given byte offsets, if that text
+// is available without reading more input, and lies within a single included
+// range.
+const char *ts_lexer_text(const Lexer *self, uint32_t start_byte, uint32_t end_byte) {
+  const char *text;
+  uint32_t text_start, text_size;
+  if (self->string) {
+    text = self->string;
+    text_start = 0;
+    text_size = self->string_length;
+  } else if (self->chunk && self->input.encoding == TSInputEncodingUTF8) {
+    text = self->chunk;
+    text_start = self->chunk_start;
+    text_size = self->chunk_size;
+  } else {
+    return NULL;
+  }
+  if (start_byte < text_start || end_byte > text_start + text_size) return NULL;
+
+  uint32_t i = self->current_included_range_index;
+  if (i >= self->included_range_count) i = self->included_range_count - 1;
+  while (i > 0 && self->included_ranges[i].start_byte > start_byte) i--;
+  const TSRange *range = &self->included_ranges[i];
+  if (range->start_byte > start_byte || range->end_byte < end_byte) return NULL;
+
+  return &text[start_byte - text_start];
+}
+
 bool ts_lexer_set_included_ranges(
   Lexer *self,
   const TSRange *ranges,
@@ -366,6 +590,9 @@ bool ts_lexer_set_included_ranges(
   self->included_ranges = ts_realloc(self->included_ranges, size);
   memcpy(self->included_ranges, ranges, size);
   self->included_range_count = count;
+
+  // The current run of ASCII characters may extend beyond the new ranges.
+  ts_lexer__leave_ascii_run(self);
   ts_lexer_goto(self, self->current_position);
   return true;
 }
@@ -18,14 +18,19 @@ typedef struct {
 
   TSRange *included_ranges;
   const char *chunk;
+  const char *string;
   TSInput input;
   TSLogger logger;
 
+  uint32_t string_length;
   uint32_t included_range_count;
   uint32_t current_included_range_index;
   uint32_t chunk_start;
   uint32_t chunk_size;
   uint32_t lookahead_size;
+  uint32_t ascii_run_start;
+  uint32_t ascii_run_end;
+  uint32_t ascii_run_column;
   bool did_get_column;
 
   char debug_buffer[TREE_SITTER_SERIALIZATION_BUFFER_SIZE];
@@ -34,11 +39,14 @@ typedef struct {
 void ts_lexer_init(Lexer *);
 void ts_lexer_delete(Lexer *);
 void ts_lexer_set_input(Lexer *, TSInput);
+void ts_lexer_set_string_input(Lexer *, const char *, uint32_t);
 void ts_lexer_reset(Lexer *, Length);
 void ts_lexer_start(Lexer *);
 void ts_lexer_finish(Lexer *, uint32_t *);
+void ts_lexer_advance(Lexer *, bool);
 void ts_lexer_advance_to_end(Lexer *);
 void ts_lexer_mark_end(Lexer *);
+const char *ts_lexer_text(const Lexer *, uint32_t, uint32_t);
 bool ts_lexer_set_included_ranges(Lexer *self, const TSRange *ranges, uint32_t count);
 TSRange *ts_lexer_included_ranges(const Lexer *self, uint32_t *count);
 
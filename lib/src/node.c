@@ -187,7 +187,40 @@ static bool ts_subtree_has_trailing_empty_descendant(
   return false;
 }
 
+// Find a node's siblings using the tree's index. Returns false if the node
+// isn't in the index.
+static inline bool ts_node__indexed_sibling(
+  TSNode self,
+  bool include_anonymous,
+  bool forward,
+  TSNode *result
+) {
+  const TreeIndex *index = self.tree->index;
+  uint32_t i = ts_tree_index_find(self.tree, &self);
+  if (i == TREE_INDEX_NONE) return false;
+
+  uint32_t parent = index->entries[i].parent;
+  uint32_t parent_end = parent == TREE_INDEX_NONE
+    ? 0
+    : parent + index->entries[parent].descendant_count;
+  for (;;) {
+    if (forward) {
+      i += index->entries[i].descendant_count;
+      if (i >= parent_end) i = TREE_INDEX_NONE;
+    } else {
+      i = index->entries[i].prev_sibling;
+    }
+    *result = ts_tree_index_node(self.tree, i);
+    if (i == TREE_INDEX_NONE || ts_node__is_relevant(*result, include_anonymous)) return true;
+  }
+}
+
 static inline TSNode ts_node__prev_sibling(TSNode self, bool include_anonymous) {
+  TSNode result;
+  if (self.tree->index && ts_node__indexed_sibling(self, include_anonymous, false, &result)) {
+    return result;
+  }
+
   Subtree self_subtree = ts_node__subtree(self);
   bool self_is_empty = ts_subtree_total_bytes(self_subtree) == 0;
   uint32_t target_end_byte = ts_node_end_byte(self);
@@ -247,6 +280,11 @@ static inline TSNode ts_node__prev_sibling(TSNode self, bool include_anonymous)
 }
 
 static inline TSNode ts_node__next_sibling(TSNode self, bool include_anonymous) {
+  TSNode result;
+  if (self.tree->index && ts_node__indexed_sibling(self, include_anonymous, true, &result)) {
+    return result;
+  }
+
   uint32_t target_end_byte = ts_node_end_byte(self);
 
   TSNode node = ts_node_parent(self);
@@ -460,10 +498,17 @@ bool ts_node_has_changes(TSNode self) {
 }
 
 bool ts_node_has_error(TSNode self) {
-  return ts_subtree_error_cost(ts_node__subtree(self)) > 0;
+  return ts_subtree_has_error(ts_node__subtree(self));
 }
 
 TSNode ts_node_parent(TSNode self) {
+  if (self.tree->index) {
+    uint32_t index = ts_tree_index_find(self.tree, &self);
+    if (index != TREE_INDEX_NONE) {
+      return ts_tree_index_node(self.tree, self.tree->index->entries[index].parent);
+    }
+  }
+
   TSNode node = ts_tree_get_cached_parent(self.tree, &self);
   if (node.id) return node;
 
@@ -600,6 +645,10 @@ uint32_t ts_node_child_count(TSNode self) {
   }
 }
 
+uint32_t ts_node_descendant_count(TSNode self) {
+  return ts_subtree_visible_descendant_count(ts_node__subtree(self)) + 1;
+}
+
 uint32_t ts_node_named_child_count(TSNode self) {
   Subtree tree = ts_node__subtree(self);
   if (ts_subtree_child_count(tree) > 0) {
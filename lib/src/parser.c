@@ -17,6 +17,7 @@
 #include "./reusable_node.h"
 #include "./stack.h"
 #include "./subtree.h"
+#include "./thread.h"
 #include "./tree.h"
 
 #define LOG(...)                                                                            \
@@ -57,32 +58,60 @@
 
 #define LOG_STACK()                                                              \
   if (self->dot_graph_file) {                                                    \
+    ts_parser__lock_output(self);                                                \
     ts_stack_print_dot_graph(self->stack, self->language, self->dot_graph_file); \
     fputs("\n\n", self->dot_graph_file);                                         \
+    ts_parser__unlock_output(self);                                              \
   }
 
 #define LOG_TREE(tree)                                                      \
   if (self->dot_graph_file) {                                               \
+    ts_parser__lock_output(self);                                           \
     ts_subtree_print_dot_graph(tree, self->language, self->dot_graph_file); \
     fputs("\n", self->dot_graph_file);                                      \
+    ts_parser__unlock_output(self);                                         \
   }
 
 #define SYM_NAME(symbol) ts_language_symbol_name(self->language, symbol)
 
 #define TREE_NAME(tree) SYM_NAME(ts_subtree_symbol(tree))
 
-static const unsigned MAX_VERSION_COUNT = 6;
+static const unsigned DEFAULT_VERSION_LIMIT = 6;
 static const unsigned MAX_VERSION_COUNT_OVERFLOW = 4;
+static const unsigned MAX_VERSION_LIMIT = UINT16_MAX;
 static const unsigned MAX_SUMMARY_DEPTH = 16;
 static const unsigned MAX_COST_DIFFERENCE = 16 * ERROR_COST_PER_SKIPPED_TREE;
 static const unsigned OP_COUNT_PER_TIMEOUT_CHECK = 100;
+static const uint32_t MIN_PARALLEL_CHUNK_SIZE = 64 * 1024;
+
+#define TOKEN_CACHE_SIZE 8
 
 typedef struct {
   Subtree token;
   Subtree last_external_token;
   uint32_t byte_index;
+  TSLexMode lex_mode;
+} TokenCacheEntry;
+
+// A small cache of recently-lexed tokens, so that when several stack versions
+// need a token at the same position, or when error recovery revisits a
+// position, the lexer doesn't need to run again. Entries are keyed by
+// position, lex mode and external scanner state, and are replaced in
+// first-in, first-out order.
+typedef struct {
+  TokenCacheEntry entries[TOKEN_CACHE_SIZE];
+  unsigned next_index;
 } TokenCache;
 
+typedef struct {
+  unsigned cost;
+  unsigned node_count;
+  int dynamic_precedence;
+  bool is_in_error;
+} ErrorStatus;
+
+typedef Array(ErrorStatus) ErrorStatusArray;
+
 struct TSParser {
   Lexer lexer;
   Stack *stack;
@@ -97,23 +126,29 @@ struct TSParser {
   ReusableNode reusable_node;
   void *external_scanner_payload;
   FILE *dot_graph_file;
+  TSMutex *output_mutex;
   TSClock end_clock;
   TSDuration timeout_duration;
   unsigned accept_count;
   unsigned operation_count;
   const volatile size_t *cancellation_flag;
   Subtree old_tree;
+  SubtreeArena *frozen_arena;
   TSRangeArray included_range_differences;
   unsigned included_range_difference_index;
+  TSParseStats stats;
+  unsigned version_limit;
+  ErrorStatusArray version_statuses;
+  bool arena_enabled;
+  TSAllocator allocator;
+  struct {
+    bool enabled;
+    uint64_t *parse_state_hits;
+    uint64_t *lex_state_hits;
+    uint32_t lex_state_count;
+  } profile;
 };
 
-typedef struct {
-  unsigned cost;
-  unsigned node_count;
-  int dynamic_precedence;
-  bool is_in_error;
-} ErrorStatus;
-
 typedef enum {
   ErrorComparisonTakeLeft,
   ErrorComparisonPreferLeft,
@@ -148,6 +183,16 @@ static const char *ts_string_input_read(
 
 // Parser - Private
 
+// While several parsers write to the same dot graph file, each of them holds
+// their shared mutex while writing a graph.
+static inline void ts_parser__lock_output(TSParser *self) {
+  if (self->output_mutex) ts_mutex_lock(self->output_mutex);
+}
+
+static inline void ts_parser__unlock_output(TSParser *self) {
+  if (self->output_mutex) ts_mutex_unlock(self->output_mutex);
+}
+
 static void ts_parser__log(TSParser *self) {
   if (self->lexer.logger.log) {
     self->lexer.logger.log(
@@ -158,12 +203,14 @@ static void ts_parser__log(TSParser *self) {
   }
 
   if (self->dot_graph_file) {
+    ts_parser__lock_output(self);
     fprintf(self->dot_graph_file, "graph {\nlabel=\"");
     for (char *c = &self->lexer.debug_buffer[0]; *c != 0; c++) {
       if (*c == '"') fputc('\\', self->dot_graph_file);
       fputc(*c, self->dot_graph_file);
     }
     fprintf(self->dot_graph_file, "\"\n}\n\n");
+    ts_parser__unlock_output(self);
   }
 }
 
@@ -332,6 +379,14 @@ static bool ts_parser__better_version_exists(
   return false;
 }
 
+static bool ts_parser__merge_versions(TSParser *self, StackVersion version1, StackVersion version2) {
+  if (ts_stack_merge(self->stack, version1, version2)) {
+    self->stats.merge_count++;
+    return true;
+  }
+  return false;
+}
+
 static void ts_parser__restore_external_scanner(
   TSParser *self,
   Subtree external_token
@@ -382,6 +437,35 @@ static bool ts_parser__can_reuse_first_leaf(
   return current_lex_mode.external_lex_state == 0 && table_entry->is_reusable;
 }
 
+// Determine whether the word token that was just lexed is actually a keyword.
+// When the language provides a perfect hash of its keywords, and the token's
+// text is directly available, the text can be looked up without lexing it
+// a second time.
+static bool ts_parser__lex_keyword(TSParser *self, TSSymbol *symbol) {
+  Length start_position = self->lexer.token_start_position;
+  uint32_t end_byte = self->lexer.token_end_position.bytes;
+
+  if (ts_language_has_keyword_hash(self->language)) {
+    uint32_t length = end_byte - start_position.bytes;
+    const char *text = ts_lexer_text(&self->lexer, start_position.bytes, end_byte);
+    if (text) {
+      if (length > self->language->keyword_hash.max_length) return false;
+      return ts_language_keyword_symbol(self->language, text, length, symbol);
+    }
+  }
+
+  ts_lexer_reset(&self->lexer, start_position);
+  ts_lexer_start(&self->lexer);
+  if (
+    self->language->keyword_lex_fn(&self->lexer.data, 0) &&
+    self->lexer.token_end_position.bytes == end_byte
+  ) {
+    *symbol = self->lexer.data.result_symbol;
+    return true;
+  }
+  return false;
+}
+
 static Subtree ts_parser__lex(
   TSParser *self,
   StackVersion version,
@@ -393,6 +477,8 @@ static Subtree ts_parser__lex(
     return NULL_SUBTREE;
   }
 
+  self->stats.lex_count++;
+  if (self->profile.lex_state_hits) self->profile.lex_state_hits[lex_mode.lex_state]++;
   Length start_position = ts_stack_position(self->stack, version);
   Subtree external_token = ts_stack_last_external_token(self->stack, version);
   const bool *valid_external_tokens = ts_language_enabled_external_tokens(
@@ -422,6 +508,7 @@ static Subtree ts_parser__lex(
       );
       ts_lexer_start(&self->lexer);
       ts_parser__restore_external_scanner(self, external_token);
+      self->stats.external_scanner_call_count++;
       bool found_token = self->language->external_scanner.scan(
         self->external_scanner_payload,
         &self->lexer.data,
@@ -488,7 +575,7 @@ static Subtree ts_parser__lex(
         self->lexer.data.result_symbol = ts_builtin_sym_error;
         break;
       }
-      self->lexer.data.advance(&self->lexer.data, false);
+      ts_lexer_advance(&self->lexer, false);
     }
 
     error_end_position = self->lexer.current_position;
@@ -527,16 +614,13 @@ static Subtree ts_parser__lex(
     if (found_external_token) {
       symbol = self->language->external_scanner.symbol_map[symbol];
     } else if (symbol == self->language->keyword_capture_token && symbol != 0) {
-      uint32_t end_byte = self->lexer.token_end_position.bytes;
-      ts_lexer_reset(&self->lexer, self->lexer.token_start_position);
-      ts_lexer_start(&self->lexer);
+      TSSymbol keyword_symbol;
       if (
-        self->language->keyword_lex_fn(&self->lexer.data, 0) &&
-        self->lexer.token_end_position.bytes == end_byte &&
-        ts_language_has_actions(self->language, parse_state, self->lexer.data.result_symbol)
+        ts_parser__lex_keyword(self, &keyword_symbol) &&
+        ts_language_has_actions(self->language, parse_state, keyword_symbol)
       ) {
         is_keyword = true;
-        symbol = self->lexer.data.result_symbol;
+        symbol = keyword_symbol;
       }
     }
 
@@ -560,6 +644,7 @@ static Subtree ts_parser__lex(
       );
       ts_external_scanner_state_init(
         &((SubtreeHeapData *)result.ptr)->external_scanner_state,
+        &self->tree_pool,
         self->lexer.debug_buffer,
         length
       );
@@ -582,33 +667,87 @@ static Subtree ts_parser__get_cached_token(
   TableEntry *table_entry
 ) {
   TokenCache *cache = &self->token_cache;
-  if (
-    cache->token.ptr && cache->byte_index == position &&
-    ts_subtree_external_scanner_state_eq(cache->last_external_token, last_external_token)
-  ) {
-    ts_language_table_entry(self->language, state, ts_subtree_symbol(cache->token), table_entry);
-    if (ts_parser__can_reuse_first_leaf(self, state, cache->token, table_entry)) {
-      ts_subtree_retain(cache->token);
-      return cache->token;
+  TSLexMode lex_mode = self->language->lex_modes[state];
+
+  // Prefer a token that was lexed in the same lex mode, but also accept any
+  // token at this position that would be valid in the current state.
+  Subtree result = NULL_SUBTREE;
+  for (unsigned i = 0; i < TOKEN_CACHE_SIZE; i++) {
+    TokenCacheEntry *entry = &cache->entries[i];
+    if (
+      !entry->token.ptr || entry->byte_index != position ||
+      !ts_subtree_external_scanner_state_eq(entry->last_external_token, last_external_token)
+    ) continue;
+
+    TableEntry entry_table_entry;
+    ts_language_table_entry(self->language, state, ts_subtree_symbol(entry->token), &entry_table_entry);
+    if (ts_parser__can_reuse_first_leaf(self, state, entry->token, &entry_table_entry)) {
+      bool has_same_lex_mode = memcmp(&entry->lex_mode, &lex_mode, sizeof(TSLexMode)) == 0;
+      if (!result.ptr || has_same_lex_mode) {
+        result = entry->token;
+        *table_entry = entry_table_entry;
+      }
+      if (has_same_lex_mode) break;
     }
   }
-  return NULL_SUBTREE;
+
+  if (result.ptr) {
+    self->stats.token_cache_hit_count++;
+    ts_subtree_retain(result);
+  } else {
+    self->stats.token_cache_miss_count++;
+  }
+  return result;
 }
 
 static void ts_parser__set_cached_token(
   TSParser *self,
+  TSStateId state,
   size_t byte_index,
   Subtree last_external_token,
   Subtree token
 ) {
   TokenCache *cache = &self->token_cache;
-  if (token.ptr) ts_subtree_retain(token);
+  TSLexMode lex_mode = self->language->lex_modes[state];
+
+  // Replace an existing entry with the same key, or else the oldest entry.
+  TokenCacheEntry *entry = NULL;
+  for (unsigned i = 0; i < TOKEN_CACHE_SIZE; i++) {
+    TokenCacheEntry *existing_entry = &cache->entries[i];
+    if (
+      existing_entry->token.ptr &&
+      existing_entry->byte_index == byte_index &&
+      memcmp(&existing_entry->lex_mode, &lex_mode, sizeof(TSLexMode)) == 0 &&
+      ts_subtree_external_scanner_state_eq(existing_entry->last_external_token, last_external_token)
+    ) {
+      entry = existing_entry;
+      break;
+    }
+  }
+  if (!entry) {
+    entry = &cache->entries[cache->next_index];
+    cache->next_index = (cache->next_index + 1) % TOKEN_CACHE_SIZE;
+  }
+
+  ts_subtree_retain(token);
   if (last_external_token.ptr) ts_subtree_retain(last_external_token);
-  if (cache->token.ptr) ts_subtree_release(&self->tree_pool, cache->token);
-  if (cache->last_external_token.ptr) ts_subtree_release(&self->tree_pool, cache->last_external_token);
-  cache->token = token;
-  cache->byte_index = byte_index;
-  cache->last_external_token = last_external_token;
+  if (entry->token.ptr) ts_subtree_release(&self->tree_pool, entry->token);
+  if (entry->last_external_token.ptr) ts_subtree_release(&self->tree_pool, entry->last_external_token);
+  entry->token = token;
+  entry->byte_index = byte_index;
+  entry->lex_mode = lex_mode;
+  entry->last_external_token = last_external_token;
+}
+
+static void ts_parser__clear_token_cache(TSParser *self) {
+  TokenCache *cache = &self->token_cache;
+  for (unsigned i = 0; i < TOKEN_CACHE_SIZE; i++) {
+    TokenCacheEntry *entry = &cache->entries[i];
+    if (entry->token.ptr) ts_subtree_release(&self->tree_pool, entry->token);
+    if (entry->last_external_token.ptr) ts_subtree_release(&self->tree_pool, entry->last_external_token);
+    *entry = (TokenCacheEntry) {.token = NULL_SUBTREE, .last_external_token = NULL_SUBTREE};
+  }
+  cache->next_index = 0;
 }
 
 static bool ts_parser__has_included_range_difference(
@@ -696,6 +835,8 @@ static Subtree ts_parser__reuse_node(
     }
 
     LOG("reuse_node symbol:%s", TREE_NAME(result));
+    self->stats.reused_node_count++;
+    self->stats.reused_byte_count += ts_subtree_total_bytes(result);
     ts_subtree_retain(result);
     return result;
   }
@@ -766,6 +907,7 @@ static bool ts_parser__select_children(
   // room for its own heap data. The scratch tree is never explicitly released,
   // so the same 'scratch trees' array can be reused again later.
   MutableSubtree scratch_tree = ts_subtree_new_node(
+    NULL,
     ts_subtree_symbol(left),
     &self->scratch_trees,
     0,
@@ -786,6 +928,7 @@ static void ts_parser__shift(
   Subtree lookahead,
   bool extra
 ) {
+  self->stats.shift_count++;
   Subtree subtree_to_push;
   if (extra != ts_subtree_extra(lookahead)) {
     MutableSubtree result = ts_subtree_make_mut(&self->tree_pool, lookahead);
@@ -814,6 +957,7 @@ static StackVersion ts_parser__reduce(
   bool is_fragile,
   bool end_of_non_terminal_extra
 ) {
+  self->stats.reduce_count++;
   uint32_t initial_version_count = ts_stack_version_count(self->stack);
 
   // Pop the given number of nodes from the given version of the parse stack.
@@ -831,7 +975,8 @@ static StackVersion ts_parser__reduce(
     // will all be sorted and truncated at the end of the outer parsing loop.
     // Allow the maximum version count to be temporarily exceeded, but only
     // by a limited threshold.
-    if (slice_version > MAX_VERSION_COUNT + MAX_VERSION_COUNT_OVERFLOW) {
+    if (slice_version > self->version_limit + MAX_VERSION_COUNT_OVERFLOW) {
+      self->stats.version_limit_hit_count++;
       ts_stack_remove_version(self->stack, slice_version);
       ts_subtree_array_delete(&self->tree_pool, &slice.subtrees);
       removed_version_count++;
@@ -851,7 +996,7 @@ static StackVersion ts_parser__reduce(
     ts_subtree_array_remove_trailing_extras(&children, &self->trailing_extras);
 
     MutableSubtree parent = ts_subtree_new_node(
-      symbol, &children, production_id, self->language
+      &self->tree_pool, symbol, &children, production_id, self->language
     );
 
     // This pop operation may have caused multiple stack versions to collapse
@@ -875,7 +1020,7 @@ static StackVersion ts_parser__reduce(
         ts_subtree_release(&self->tree_pool, ts_subtree_from_mut(parent));
         array_swap(&self->trailing_extras, &self->trailing_extras2);
         parent = ts_subtree_new_node(
-          symbol, &children, production_id, self->language
+          &self->tree_pool, symbol, &children, production_id, self->language
         );
       } else {
         array_clear(&self->trailing_extras2);
@@ -885,6 +1030,7 @@ static StackVersion ts_parser__reduce(
 
     TSStateId state = ts_stack_state(self->stack, slice_version);
     TSStateId next_state = ts_language_next_state(self->language, state, symbol);
+    if (self->profile.parse_state_hits) self->profile.parse_state_hits[state]++;
     if (end_of_non_terminal_extra && next_state == state) {
       parent.ptr->extra = true;
     }
@@ -904,12 +1050,9 @@ static StackVersion ts_parser__reduce(
       ts_stack_push(self->stack, slice_version, self->trailing_extras.contents[j], false, next_state);
     }
 
-    for (StackVersion j = 0; j < slice_version; j++) {
-      if (j == version) continue;
-      if (ts_stack_merge(self->stack, j, slice_version)) {
-        removed_version_count++;
-        break;
-      }
+    StackVersion j = ts_stack_merge_candidate(self->stack, slice_version, 0, version);
+    if (j != STACK_VERSION_NONE && ts_parser__merge_versions(self, j, slice_version)) {
+      removed_version_count++;
     }
   }
 
@@ -943,6 +1086,7 @@ static void ts_parser__accept(
         }
         array_splice(&trees, j, 1, child_count, children);
         root = ts_subtree_from_mut(ts_subtree_new_node(
+          &self->tree_pool,
           ts_subtree_symbol(tree),
           &trees,
           tree.ptr->production_id,
@@ -985,14 +1129,16 @@ static bool ts_parser__do_all_potential_reductions(
     uint32_t version_count = ts_stack_version_count(self->stack);
     if (version >= version_count) break;
 
-    bool merged = false;
-    for (StackVersion i = initial_version_count; i < version; i++) {
-      if (ts_stack_merge(self->stack, i, version)) {
-        merged = true;
-        break;
-      }
-    }
-    if (merged) continue;
+    StackVersion merge_version = ts_stack_merge_candidate(
+      self->stack,
+      version,
+      initial_version_count,
+      STACK_VERSION_NONE
+    );
+    if (
+      merge_version != STACK_VERSION_NONE &&
+      ts_parser__merge_versions(self, merge_version, version)
+    ) continue;
 
     TSStateId state = ts_stack_state(self->stack, version);
     bool has_shift_action = false;
@@ -1045,7 +1191,7 @@ static bool ts_parser__do_all_potential_reductions(
 
     if (has_shift_action) {
       can_shift_lookahead_symbol = true;
-    } else if (reduction_version != STACK_VERSION_NONE && i < MAX_VERSION_COUNT) {
+    } else if (reduction_version != STACK_VERSION_NONE && i < self->version_limit) {
       ts_stack_renumber_version(self->stack, reduction_version, version);
       continue;
     } else if (lookahead_symbol != 0) {
@@ -1135,7 +1281,7 @@ static void ts_parser__handle_error(
   }
 
   for (unsigned i = previous_version_count; i < version_count; i++) {
-    bool did_merge = ts_stack_merge(self->stack, version, previous_version_count);
+    bool did_merge = ts_parser__merge_versions(self, version, previous_version_count);
     assert(did_merge);
   }
 
@@ -1185,7 +1331,12 @@ static bool ts_parser__recover_to_state(
     ts_subtree_array_remove_trailing_extras(&slice.subtrees, &self->trailing_extras);
 
     if (slice.subtrees.size > 0) {
-      Subtree error = ts_subtree_new_error_node(&slice.subtrees, true, self->language);
+      Subtree error = ts_subtree_new_error_node(
+        &self->tree_pool,
+        &slice.subtrees,
+        true,
+        self->language
+      );
       ts_stack_push(self->stack, slice.version, error, false, goal_state);
     } else {
       array_delete(&slice.subtrees);
@@ -1207,6 +1358,7 @@ static void ts_parser__recover(
   StackVersion version,
   Subtree lookahead
 ) {
+  self->stats.recovery_count++;
   bool did_recover = false;
   unsigned previous_version_count = ts_stack_version_count(self->stack);
   Length position = ts_stack_position(self->stack, version);
@@ -1282,7 +1434,8 @@ static void ts_parser__recover(
   // current lookahead token by wrapping it in an ERROR node.
 
   // Don't pursue this additional strategy if there are already too many stack versions.
-  if (did_recover && ts_stack_version_count(self->stack) > MAX_VERSION_COUNT) {
+  if (did_recover && ts_stack_version_count(self->stack) > self->version_limit) {
+    self->stats.version_limit_hit_count++;
     ts_stack_halt(self->stack, version);
     ts_subtree_release(&self->tree_pool, lookahead);
     return;
@@ -1293,7 +1446,7 @@ static void ts_parser__recover(
   if (ts_subtree_is_eof(lookahead)) {
     LOG("recover_eof");
     SubtreeArray children = array_new();
-    Subtree parent = ts_subtree_new_error_node(&children, false, self->language);
+    Subtree parent = ts_subtree_new_error_node(&self->tree_pool, &children, false, self->language);
     ts_stack_push(self->stack, version, parent, false, 1);
     ts_parser__accept(self, version, lookahead);
     return;
@@ -1326,6 +1479,7 @@ static void ts_parser__recover(
   array_reserve(&children, 1);
   array_push(&children, lookahead);
   MutableSubtree error_repeat = ts_subtree_new_node(
+    &self->tree_pool,
     ts_builtin_sym_error_repeat,
     &children,
     0,
@@ -1354,6 +1508,7 @@ static void ts_parser__recover(
     ts_stack_renumber_version(self->stack, pop.contents[0].version, version);
     array_push(&pop.contents[0].subtrees, ts_subtree_from_mut(error_repeat));
     error_repeat = ts_subtree_new_node(
+      &self->tree_pool,
       ts_builtin_sym_error_repeat,
       &pop.contents[0].subtrees,
       0,
@@ -1378,6 +1533,7 @@ static bool ts_parser__advance(
   TSStateId state = ts_stack_state(self->stack, version);
   uint32_t position = ts_stack_position(self->stack, version).bytes;
   Subtree last_external_token = ts_stack_last_external_token(self->stack, version);
+  if (self->profile.parse_state_hits) self->profile.parse_state_hits[state]++;
 
   bool did_reuse = true;
   Subtree lookahead = NULL_SUBTREE;
@@ -1407,7 +1563,7 @@ static bool ts_parser__advance(
       lookahead = ts_parser__lex(self, version, state);
 
       if (lookahead.ptr) {
-        ts_parser__set_cached_token(self, position, last_external_token, lookahead);
+        ts_parser__set_cached_token(self, state, position, last_external_token, lookahead);
         ts_language_table_entry(self->language, state, ts_subtree_symbol(lookahead), &table_entry);
       }
 
@@ -1585,8 +1741,16 @@ static bool ts_parser__advance(
 }
 
 static unsigned ts_parser__condense_stack(TSParser *self) {
+  self->stats.condense_count++;
   bool made_changes = false;
   unsigned min_error_cost = UINT_MAX;
+
+  // Keep the status of each version that has been examined, so that it isn't
+  // recomputed for every pair of versions. Only merging changes a version's
+  // status.
+  ErrorStatusArray *statuses = &self->version_statuses;
+  array_clear(statuses);
+
   for (StackVersion i = 0; i < ts_stack_version_count(self->stack); i++) {
     // Prune any versions that have been marked for removal.
     if (ts_stack_is_halted(self->stack, i)) {
@@ -1601,25 +1765,29 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
     if (!status_i.is_in_error && status_i.cost < min_error_cost) {
       min_error_cost = status_i.cost;
     }
+    array_push(statuses, status_i);
 
     // Examine each pair of stack versions, removing any versions that
     // are clearly worse than another version. Ensure that the versions
     // are ordered from most promising to least promising.
     for (StackVersion j = 0; j < i; j++) {
-      ErrorStatus status_j = ts_parser__version_status(self, j);
+      ErrorStatus status_j = statuses->contents[j];
 
       switch (ts_parser__compare_versions(self, status_j, status_i)) {
         case ErrorComparisonTakeLeft:
           made_changes = true;
           ts_stack_remove_version(self->stack, i);
+          array_erase(statuses, i);
           i--;
           j = i;
           break;
 
         case ErrorComparisonPreferLeft:
         case ErrorComparisonNone:
-          if (ts_stack_merge(self->stack, j, i)) {
+          if (ts_parser__merge_versions(self, j, i)) {
             made_changes = true;
+            array_erase(statuses, i);
+            statuses->contents[j] = ts_parser__version_status(self, j);
             i--;
             j = i;
           }
@@ -1627,17 +1795,22 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
 
         case ErrorComparisonPreferRight:
           made_changes = true;
-          if (ts_stack_merge(self->stack, j, i)) {
+          if (ts_parser__merge_versions(self, j, i)) {
+            array_erase(statuses, i);
+            statuses->contents[j] = ts_parser__version_status(self, j);
             i--;
             j = i;
           } else {
             ts_stack_swap_versions(self->stack, i, j);
+            statuses->contents[j] = statuses->contents[i];
+            statuses->contents[i] = status_j;
           }
           break;
 
         case ErrorComparisonTakeRight:
           made_changes = true;
           ts_stack_remove_version(self->stack, j);
+          array_erase(statuses, j);
           i--;
           j--;
           break;
@@ -1647,8 +1820,11 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
 
   // Enfore a hard upper bound on the number of stack versions by
   // discarding the least promising versions.
-  while (ts_stack_version_count(self->stack) > MAX_VERSION_COUNT) {
-    ts_stack_remove_version(self->stack, MAX_VERSION_COUNT);
+  if (ts_stack_version_count(self->stack) > self->version_limit) {
+    self->stats.version_limit_hit_count++;
+    while (ts_stack_version_count(self->stack) > self->version_limit) {
+      ts_stack_remove_version(self->stack, self->version_limit);
+    }
     made_changes = true;
   }
 
@@ -1659,7 +1835,7 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
     bool has_unpaused_version = false;
     for (StackVersion i = 0, n = ts_stack_version_count(self->stack); i < n; i++) {
       if (ts_stack_is_paused(self->stack, i)) {
-        if (!has_unpaused_version && self->accept_count < MAX_VERSION_COUNT) {
+        if (!has_unpaused_version && self->accept_count < self->version_limit) {
           LOG("resume version:%u", i);
           min_error_cost = ts_stack_error_cost(self->stack, i);
           TSSymbol lookahead_symbol = ts_stack_resume(self->stack, i);
@@ -1684,6 +1860,40 @@ static unsigned ts_parser__condense_stack(TSParser *self) {
   return min_error_cost;
 }
 
+static void ts_parser__clear_stats(TSParser *self) {
+  self->stats = (TSParseStats) {0};
+  self->tree_pool.allocation_count = 0;
+  self->tree_pool.reuse_count = 0;
+}
+
+// If arena allocation is enabled, create an arena for the subtrees of the
+// next tree.
+static void ts_parser__start_arena(TSParser *self) {
+  if (self->arena_enabled && !self->tree_pool.arena) {
+    self->tree_pool.arena = ts_subtree_arena_new(ts_parser_allocator(self));
+  }
+}
+
+// Discard the recorded profile, and if profiling is enabled, allocate new
+// zeroed counts that are sized for the current language.
+static void ts_parser__reset_profile(TSParser *self) {
+  ts_free(self->profile.parse_state_hits);
+  ts_free(self->profile.lex_state_hits);
+  self->profile.parse_state_hits = NULL;
+  self->profile.lex_state_hits = NULL;
+  self->profile.lex_state_count = 0;
+  if (!self->profile.enabled || !self->language) return;
+
+  for (unsigned i = 0; i < self->language->state_count; i++) {
+    uint16_t lex_state = self->language->lex_modes[i].lex_state;
+    if (lex_state != (uint16_t)-1 && lex_state >= self->profile.lex_state_count) {
+      self->profile.lex_state_count = lex_state + 1;
+    }
+  }
+  self->profile.parse_state_hits = ts_calloc(self->language->state_count, sizeof(uint64_t));
+  self->profile.lex_state_hits = ts_calloc(self->profile.lex_state_count, sizeof(uint64_t));
+}
+
 static bool ts_parser_has_outstanding_parse(TSParser *self) {
   return (
     ts_stack_state(self->stack, 0) != 1 ||
@@ -1691,26 +1901,374 @@ static bool ts_parser_has_outstanding_parse(TSParser *self) {
   );
 }
 
+// Parser - Parallel
+
+// The logger and dot graph file of a parser are shared with the parsers that
+// work for it on other threads. The logger is wrapped so that it receives one
+// message at a time, and the same mutex guards the dot graph file.
+typedef struct {
+  TSLogger logger;
+  TSMutex mutex;
+} ParallelOutput;
+
+static void ts_parser__log_parallel(void *payload, TSLogType type, const char *message) {
+  ParallelOutput *output = payload;
+  ts_mutex_lock(&output->mutex);
+  output->logger.log(output->logger.payload, type, message);
+  ts_mutex_unlock(&output->mutex);
+}
+
+static void ts_parser__start_parallel_output(TSParser *self, ParallelOutput *output) {
+  output->logger = self->lexer.logger;
+  ts_mutex_init(&output->mutex);
+  if (output->logger.log) {
+    self->lexer.logger = (TSLogger) {
+      .payload = output,
+      .log = ts_parser__log_parallel,
+    };
+  }
+  self->output_mutex = &output->mutex;
+}
+
+static void ts_parser__finish_parallel_output(TSParser *self, ParallelOutput *output) {
+  self->lexer.logger = output->logger;
+  self->output_mutex = NULL;
+  ts_mutex_destroy(&output->mutex);
+}
+
+typedef struct {
+  TSParser *parser;
+  const TSLanguage *language;
+  const volatile size_t *cancellation_flag;
+  TSDuration timeout_duration;
+  bool arena_enabled;
+  unsigned version_limit;
+  TSAllocator allocator;
+  TSLogger logger;
+  FILE *dot_graph_file;
+  TSMutex *output_mutex;
+  const char *string;
+  uint32_t start_byte;
+  uint32_t end_byte;
+  TSTree *tree;
+  TSThread thread;
+  bool has_thread;
+} ParseChunk;
+
+static void *ts_parser__parse_chunk(void *payload) {
+  ParseChunk *chunk = payload;
+  TSParser *parser = chunk->parser;
+  if (!parser) {
+    parser = ts_parser_new();
+    ts_parser_set_language(parser, chunk->language);
+    parser->cancellation_flag = chunk->cancellation_flag;
+    parser->timeout_duration = chunk->timeout_duration;
+    parser->arena_enabled = chunk->arena_enabled;
+    parser->version_limit = chunk->version_limit;
+    parser->allocator = chunk->allocator;
+    parser->lexer.logger = chunk->logger;
+    parser->dot_graph_file = chunk->dot_graph_file;
+    parser->output_mutex = chunk->output_mutex;
+  }
+  chunk->tree = ts_parser_parse_string(
+    parser,
+    NULL,
+    chunk->string + chunk->start_byte,
+    chunk->end_byte - chunk->start_byte
+  );
+  if (parser != chunk->parser) ts_parser_delete(parser);
+  return NULL;
+}
+
+typedef struct {
+  TSParser *parser;
+  const TSInput *inputs;
+  TSTree **trees;
+  uint32_t count;
+  volatile uint32_t *next_index;
+  TSThread thread;
+  bool has_thread;
+} ParseBatchWorker;
+
+// Parse documents from a batch until there are none left. Several workers can
+// share a batch, each claiming the next unparsed document when it finishes
+// the previous one.
+//
+// The worker's parser keeps its stack, subtree pool and caches between
+// documents. If arena allocation is enabled, it also keeps allocating from
+// the arena of the previous document's tree, instead of starting a new arena,
+// with fresh memory, for every document. That arena then holds the nodes of
+// several trees, so it is marked as shared, and it is freed once all of those
+// trees have been deleted.
+static void *ts_parser__parse_batch_documents(void *payload) {
+  ParseBatchWorker *worker = payload;
+  TSParser *parser = worker->parser;
+  SubtreeArena *arena = NULL;
+  for (;;) {
+    if (parser->cancellation_flag && atomic_load(parser->cancellation_flag)) break;
+    uint32_t index = atomic_inc(worker->next_index) - 1;
+    if (index >= worker->count) break;
+
+    if (arena) {
+      arena->is_shared = true;
+      ts_subtree_arena_retain(arena);
+      parser->tree_pool.arena = arena;
+    }
+
+    // A document that can't be finished must not be resumed with the
+    // next document's input.
+    TSTree *tree = ts_parser_parse(parser, NULL, worker->inputs[index]);
+    worker->trees[index] = tree;
+    if (tree) {
+      if (tree->arena) arena = tree->arena;
+    } else {
+      ts_parser_reset(parser);
+    }
+  }
+  return NULL;
+}
+
+// Find the first position at or after `position` that is likely to separate
+// two top-level nodes: the start of a line that begins with something other
+// than whitespace or a closing delimiter.
+static uint32_t ts_parser__find_chunk_boundary(
+  const char *string,
+  uint32_t position,
+  uint32_t length
+) {
+  while (position < length) {
+    const char *newline = memchr(string + position, '\n', length - position);
+    if (!newline) break;
+    position = newline - string + 1;
+    if (position == length) break;
+    switch (string[position]) {
+      case ' ': case '\t': case '\n': case '\r': case '\f': case '\v':
+      case ')': case ']': case '}':
+        break;
+      default:
+        return position;
+    }
+  }
+  return length;
+}
+
+// Determine whether a chunk's tree can be spliced into the tree of a larger
+// document. It must be free of errors, and it must consist of at most one
+// top-level node, surrounded by extras and the end-of-file token.
+static bool ts_parser__chunk_is_joinable(Subtree root, Subtree *content) {
+  *content = NULL_SUBTREE;
+  if (ts_subtree_error_cost(root) > 0) return false;
+  uint32_t child_count = ts_subtree_child_count(root);
+  if (child_count == 0) return false;
+  const Subtree *children = ts_subtree_children(root);
+  if (!ts_subtree_is_eof(children[child_count - 1])) return false;
+  for (uint32_t i = 0; i < child_count; i++) {
+    if (ts_subtree_extra(children[i])) continue;
+    if (content->ptr) return false;
+    *content = children[i];
+  }
+  return true;
+}
+
+// Determine whether any token in a chunk, other than the end-of-file token,
+// was lexed by looking at the end of the chunk. Those tokens might have been
+// lexed differently if the chunk had been followed by the rest of the
+// document. For example, an external scanner might have produced a zero-width
+// token like an automatic semicolon only because it reached the end of the
+// input.
+static bool ts_parser__chunk_depends_on_its_end(Subtree root, uint32_t length) {
+  uint32_t child_count = ts_subtree_child_count(root);
+  const Subtree *children = ts_subtree_children(root);
+  uint32_t end_byte = 0;
+  for (uint32_t i = 0; i + 1 < child_count; i++) {
+    end_byte += ts_subtree_total_bytes(children[i]);
+    if (end_byte + ts_subtree_lookahead_bytes(children[i]) > length) return true;
+  }
+  return false;
+}
+
+// Check each seam between adjacent chunks, marking in `seam_is_clean` the ones
+// at which a serial parse would have behaved exactly like the parse of the
+// following chunk on its own. That requires the tokens before the seam not to
+// have been affected by the end of their chunk, requires the token after the
+// seam to have been lexed in the same lex mode and external scanner state, and
+// requires the chunks' top-level nodes to be children of a common repetition.
+// Returns the repetition symbol, or zero if no seam is clean.
+static TSSymbol ts_parser__check_chunk_seams(
+  TSParser *self,
+  const ParseChunk *chunks,
+  uint32_t chunk_count,
+  bool *seam_is_clean
+) {
+  const TSLanguage *language = self->language;
+  TSSymbol repeat_symbol = 0;
+  Subtree root = chunks[0].tree->root;
+  Subtree content;
+
+  for (uint32_t i = 0; i < chunk_count; i++) {
+    if (
+      ts_parser__chunk_is_joinable(chunks[i].tree->root, &content) &&
+      content.ptr &&
+      ts_subtree_child_count(content) > 0 &&
+      !ts_subtree_visible(content) &&
+      !ts_subtree_named(content)
+    ) {
+      repeat_symbol = ts_subtree_symbol(content);
+      break;
+    }
+  }
+  TSStateId repeat_state = repeat_symbol
+    ? ts_language_next_state(language, 1, repeat_symbol)
+    : 0;
+
+  bool previous_is_joinable = ts_parser__chunk_is_joinable(root, &content);
+  Subtree last_external_token = ts_subtree_last_external_token(root);
+  for (uint32_t i = 1; i < chunk_count; i++) {
+    Subtree previous_root = root;
+    root = chunks[i].tree->root;
+    bool is_joinable = ts_parser__chunk_is_joinable(root, &content);
+    seam_is_clean[i] = false;
+
+    if (previous_is_joinable && is_joinable && repeat_state) {
+      const Subtree *previous_children = ts_subtree_children(previous_root);
+      Subtree eof = previous_children[ts_subtree_child_count(previous_root) - 1];
+      TSStateId eof_state = ts_subtree_leaf_parse_state(eof);
+      TSStateId first_leaf_state = ts_subtree_leaf_parse_state(ts_subtree_children(root)[0]);
+      seam_is_clean[i] = (
+        ts_subtree_symbol(root) == ts_subtree_symbol(previous_root) &&
+        !ts_parser__chunk_depends_on_its_end(
+          previous_root,
+          chunks[i - 1].end_byte - chunks[i - 1].start_byte
+        ) &&
+        eof_state != TS_TREE_STATE_NONE &&
+        first_leaf_state != TS_TREE_STATE_NONE &&
+        memcmp(
+          &language->lex_modes[eof_state],
+          &language->lex_modes[first_leaf_state],
+          sizeof(TSLexMode)
+        ) == 0 &&
+        (
+          !last_external_token.ptr ||
+          last_external_token.ptr->external_scanner_state.length == 0
+        ) &&
+        (
+          !content.ptr ||
+          ts_language_next_state(language, repeat_state, ts_subtree_symbol(content)) != 0
+        )
+      );
+    }
+
+    Subtree external_token = ts_subtree_last_external_token(root);
+    if (external_token.ptr) last_external_token = external_token;
+    previous_is_joinable = is_joinable;
+  }
+
+  return repeat_symbol;
+}
+
+// Combine the trees of a sequence of chunks whose seams are all clean into
+// one tree. The top-level nodes of the chunks are joined by nesting them
+// inside the repetition symbol, the same way the parser builds repetitions,
+// and the whitespace at the end of each chunk is moved into the padding of
+// the following chunk's first token.
+static Subtree ts_parser__join_chunks(
+  TSParser *self,
+  const ParseChunk *chunks,
+  uint32_t chunk_count,
+  TSSymbol repeat_symbol
+) {
+  SubtreeArray children = array_new();
+  SubtreeArray pending = array_new();
+  Subtree content = NULL_SUBTREE;
+  uint16_t production_id = 0;
+  Length eof_padding = length_zero();
+
+  for (uint32_t i = 0; i < chunk_count; i++) {
+    // The chunks' nodes are shared with the combined tree.
+    if (chunks[i].tree->arena) chunks[i].tree->arena->is_shared = true;
+
+    Subtree root = chunks[i].tree->root;
+    uint32_t child_count = ts_subtree_child_count(root);
+    const Subtree *root_children = ts_subtree_children(root);
+
+    for (uint32_t j = 0; j < child_count; j++) {
+      Subtree child = root_children[j];
+      if (j + 1 == child_count && i + 1 < chunk_count) {
+        eof_padding = ts_subtree_padding(child);
+        break;
+      }
+
+      ts_subtree_retain(child);
+      if (j == 0 && i > 0) {
+        child = ts_subtree_prepend_padding(child, eof_padding, &self->tree_pool);
+      }
+
+      if (ts_subtree_extra(child)) {
+        if (content.ptr) {
+          array_push(&pending, child);
+        } else {
+          array_push(&children, child);
+        }
+      } else if (!content.ptr) {
+        production_id = ts_subtree_production_id(root);
+        content = child;
+      } else {
+        SubtreeArray repeat_children = array_new();
+        array_reserve(&repeat_children, pending.size + 2);
+        array_push(&repeat_children, content);
+        array_push_all(&repeat_children, &pending);
+        array_push(&repeat_children, child);
+        array_clear(&pending);
+        MutableSubtree repeat = ts_subtree_new_node(
+          &self->tree_pool,
+          repeat_symbol,
+          &repeat_children,
+          0,
+          self->language
+        );
+        repeat.ptr->parse_state = ts_subtree_parse_state(content);
+        content = ts_subtree_from_mut(repeat);
+      }
+    }
+  }
+
+  if (content.ptr) array_push(&children, content);
+  array_push_all(&children, &pending);
+  array_delete(&pending);
+  return ts_subtree_from_mut(ts_subtree_new_node(
+    &self->tree_pool,
+    ts_subtree_symbol(chunks[0].tree->root),
+    &children,
+    production_id,
+    self->language
+  ));
+}
+
 // Parser - Public
 
 TSParser *ts_parser_new(void) {
   TSParser *self = ts_calloc(1, sizeof(TSParser));
   ts_lexer_init(&self->lexer);
   array_init(&self->reduce_actions);
+  array_init(&self->version_statuses);
   array_reserve(&self->reduce_actions, 4);
   self->tree_pool = ts_subtree_pool_new(32);
+  self->tree_pool.is_private = true;
   self->stack = ts_stack_new(&self->tree_pool);
   self->finished_tree = NULL_SUBTREE;
   self->reusable_node = reusable_node_new();
   self->dot_graph_file = NULL;
+  self->output_mutex = NULL;
   self->cancellation_flag = NULL;
   self->timeout_duration = 0;
+  self->version_limit = DEFAULT_VERSION_LIMIT;
   self->end_clock = clock_null();
   self->operation_count = 0;
   self->old_tree = NULL_SUBTREE;
+  self->frozen_arena = NULL;
   self->included_range_differences = (TSRangeArray) array_new();
   self->included_range_difference_index = 0;
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_token_cache(self);
   return self;
 }
 
@@ -1722,6 +2280,7 @@ void ts_parser_delete(TSParser *self) {
   if (self->reduce_actions.contents) {
     array_delete(&self->reduce_actions);
   }
+  array_delete(&self->version_statuses);
   if (self->included_range_differences.contents) {
     array_delete(&self->included_range_differences);
   }
@@ -1730,7 +2289,7 @@ void ts_parser_delete(TSParser *self) {
     self->old_tree = NULL_SUBTREE;
   }
   ts_lexer_delete(&self->lexer);
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_token_cache(self);
   ts_subtree_pool_delete(&self->tree_pool);
   reusable_node_delete(&self->reusable_node);
   array_delete(&self->trailing_extras);
@@ -1760,6 +2319,7 @@ bool ts_parser_set_language(TSParser *self, const TSLanguage *language) {
   }
 
   self->language = language;
+  ts_parser__reset_profile(self);
   ts_parser_reset(self);
   return true;
 }
@@ -1800,6 +2360,61 @@ void ts_parser_set_timeout_micros(TSParser *self, uint64_t timeout_micros) {
   self->timeout_duration = duration_from_micros(timeout_micros);
 }
 
+uint32_t ts_parser_version_limit(const TSParser *self) {
+  return self->version_limit;
+}
+
+void ts_parser_set_version_limit(TSParser *self, uint32_t limit) {
+  if (limit < 1) limit = 1;
+  if (limit > MAX_VERSION_LIMIT) limit = MAX_VERSION_LIMIT;
+  self->version_limit = limit;
+}
+
+void ts_parser_stats(const TSParser *self, TSParseStats *stats) {
+  *stats = self->stats;
+  stats->subtree_allocation_count = self->tree_pool.allocation_count;
+  stats->subtree_pool_hit_count = self->tree_pool.reuse_count;
+}
+
+void ts_parser_set_profiling_enabled(TSParser *self, bool enabled) {
+  self->profile.enabled = enabled;
+  ts_parser__reset_profile(self);
+}
+
+void ts_parser_profile(const TSParser *self, TSParseProfile *profile) {
+  if (self->profile.parse_state_hits) {
+    profile->parse_state_hits = self->profile.parse_state_hits;
+    profile->parse_state_count = self->language->state_count;
+    profile->lex_state_hits = self->profile.lex_state_hits;
+    profile->lex_state_count = self->profile.lex_state_count;
+  } else {
+    *profile = (TSParseProfile) {NULL, 0, NULL, 0};
+  }
+}
+
+void ts_parser_set_arena_enabled(TSParser *self, bool enabled) {
+  self->arena_enabled = enabled;
+}
+
+bool ts_parser_arena_enabled(const TSParser *self) {
+  return self->arena_enabled;
+}
+
+void ts_parser_set_allocator(TSParser *self, const TSAllocator *allocator) {
+  // Memory must be freed by the same allocator that allocated it, so an
+  // allocator that is missing either function is ignored.
+  if (allocator && allocator->malloc && allocator->free) {
+    self->allocator = *allocator;
+    self->arena_enabled = true;
+  } else {
+    self->allocator = (TSAllocator) {NULL, NULL, NULL};
+  }
+}
+
+const TSAllocator *ts_parser_allocator(const TSParser *self) {
+  return self->allocator.malloc ? &self->allocator : NULL;
+}
+
 bool ts_parser_set_included_ranges(
   TSParser *self,
   const TSRange *ranges,
@@ -1825,29 +2440,41 @@ void ts_parser_reset(TSParser *self) {
   reusable_node_clear(&self->reusable_node);
   ts_lexer_reset(&self->lexer, length_zero());
   ts_stack_clear(self->stack);
-  ts_parser__set_cached_token(self, 0, NULL_SUBTREE, NULL_SUBTREE);
+  ts_parser__clear_token_cache(self);
   if (self->finished_tree.ptr) {
     ts_subtree_release(&self->tree_pool, self->finished_tree);
     self->finished_tree = NULL_SUBTREE;
   }
+  SubtreeArena *arena = ts_subtree_pool_take_arena(&self->tree_pool);
+  if (arena) ts_subtree_arena_release(arena);
+  if (self->frozen_arena) {
+    ts_subtree_arena_release(self->frozen_arena);
+    self->frozen_arena = NULL;
+  }
   self->accept_count = 0;
 }
 
-TSTree *ts_parser_parse(
-  TSParser *self,
-  const TSTree *old_tree,
-  TSInput input
-) {
-  if (!self->language || !input.read) return NULL;
-
-  ts_lexer_set_input(&self->lexer, input);
-
+// Parse the document that has already been assigned as the lexer's input.
+static TSTree *ts_parser__parse(TSParser *self, const TSTree *old_tree) {
   array_clear(&self->included_range_differences);
   self->included_range_difference_index = 0;
 
   if (ts_parser_has_outstanding_parse(self)) {
     LOG("resume_parsing");
   } else if (old_tree) {
+    ts_parser__clear_stats(self);
+    ts_parser__start_arena(self);
+
+    // The new tree will reuse nodes from the old tree, so neither tree's
+    // arena can be freed without releasing its nodes individually. Frozen
+    // nodes are reused as they are, so the new tree also keeps the block
+    // that holds them.
+    if (self->tree_pool.arena) self->tree_pool.arena->is_shared = true;
+    if (old_tree->arena) old_tree->arena->is_shared = true;
+    if (old_tree->frozen_arena) {
+      ts_subtree_arena_retain(old_tree->frozen_arena);
+      self->frozen_arena = old_tree->frozen_arena;
+    }
     ts_subtree_retain(old_tree->root);
     self->old_tree = old_tree->root;
     ts_range_array_get_changed_ranges(
@@ -1855,7 +2482,7 @@ TSTree *ts_parser_parse(
       self->lexer.included_ranges, self->lexer.included_range_count,
       &self->included_range_differences
     );
-    reusable_node_reset(&self->reusable_node, old_tree->root);
+    reusable_node_reset(&self->reusable_node, self->old_tree);
     LOG("parse_after_edit");
     LOG_TREE(self->old_tree);
     for (unsigned i = 0; i < self->included_range_differences.size; i++) {
@@ -1863,6 +2490,8 @@ TSTree *ts_parser_parse(
       LOG("different_included_range %u - %u", range->start_byte, range->end_byte);
     }
   } else {
+    ts_parser__clear_stats(self);
+    ts_parser__start_arena(self);
     reusable_node_clear(&self->reusable_node);
     LOG("new_parse");
   }
@@ -1898,6 +2527,10 @@ TSTree *ts_parser_parse(
       }
     }
 
+    if (version_count > self->stats.max_version_count) {
+      self->stats.max_version_count = version_count;
+    }
+
     unsigned min_error_cost = ts_parser__condense_stack(self);
     if (self->finished_tree.ptr && ts_subtree_error_cost(self->finished_tree) < min_error_cost) {
       break;
@@ -1923,11 +2556,24 @@ TSTree *ts_parser_parse(
     self->lexer.included_ranges,
     self->lexer.included_range_count
   );
+  result->arena = ts_subtree_pool_take_arena(&self->tree_pool);
+  result->frozen_arena = self->frozen_arena;
+  self->frozen_arena = NULL;
   self->finished_tree = NULL_SUBTREE;
   ts_parser_reset(self);
   return result;
 }
 
+TSTree *ts_parser_parse(
+  TSParser *self,
+  const TSTree *old_tree,
+  TSInput input
+) {
+  if (!self->language || !input.read) return NULL;
+  ts_lexer_set_input(&self->lexer, input);
+  return ts_parser__parse(self, old_tree);
+}
+
 TSTree *ts_parser_parse_string(
   TSParser *self,
   const TSTree *old_tree,
@@ -1939,6 +2585,12 @@ TSTree *ts_parser_parse_string(
 
 TSTree *ts_parser_parse_string_encoding(TSParser *self, const TSTree *old_tree,
                                         const char *string, uint32_t length, TSInputEncoding encoding) {
+  if (encoding == TSInputEncodingUTF8) {
+    if (!self->language) return NULL;
+    ts_lexer_set_string_input(&self->lexer, string, length);
+    return ts_parser__parse(self, old_tree);
+  }
+
   TSStringInput input = {string, length};
   return ts_parser_parse(self, old_tree, (TSInput) {
     &input,
@@ -1947,4 +2599,229 @@ TSTree *ts_parser_parse_string_encoding(TSParser *self, const TSTree *old_tree,
   });
 }
 
+TSTree *ts_parser_parse_string_parallel(
+  TSParser *self,
+  const char *string,
+  uint32_t length,
+  uint32_t thread_count
+) {
+  if (!self->language) return NULL;
+
+  uint32_t included_range_count;
+  const TSRange *included_ranges = ts_lexer_included_ranges(&self->lexer, &included_range_count);
+  if (
+    thread_count < 2 ||
+    length / thread_count < MIN_PARALLEL_CHUNK_SIZE ||
+    ts_parser_has_outstanding_parse(self) ||
+    included_range_count != 1 ||
+    included_ranges[0].start_byte != 0 ||
+    included_ranges[0].end_byte < length
+  ) {
+    return ts_parser_parse_string(self, NULL, string, length);
+  }
+
+  ParallelOutput output;
+  ts_parser__start_parallel_output(self, &output);
+  Array(ParseChunk) chunks = array_new();
+  uint32_t start_byte = 0;
+  for (uint32_t i = 1; start_byte < length; i++) {
+    uint32_t end_byte = length;
+    if (i < thread_count) {
+      uint32_t target_byte = (uint32_t)((uint64_t)length * i / thread_count);
+      if (target_byte < start_byte + MIN_PARALLEL_CHUNK_SIZE) {
+        target_byte = start_byte + MIN_PARALLEL_CHUNK_SIZE;
+      }
+      if (target_byte < length) {
+        end_byte = ts_parser__find_chunk_boundary(string, target_byte, length);
+      }
+    }
+    array_push(&chunks, ((ParseChunk) {
+      .parser = NULL,
+      .language = self->language,
+      .cancellation_flag = self->cancellation_flag,
+      .timeout_duration = self->timeout_duration,
+      .arena_enabled = self->arena_enabled,
+      .version_limit = self->version_limit,
+      .allocator = self->allocator,
+      .logger = self->lexer.logger,
+      .dot_graph_file = self->dot_graph_file,
+      .output_mutex = self->output_mutex,
+      .string = string,
+      .start_byte = start_byte,
+      .end_byte = end_byte,
+      .tree = NULL,
+      .has_thread = false,
+    }));
+    start_byte = end_byte;
+  }
+
+  LOG("parallel_parse chunk_count:%u", chunks.size);
+  for (uint32_t i = 1; i < chunks.size; i++) {
+    ParseChunk *chunk = &chunks.contents[i];
+    chunk->has_thread = ts_thread_spawn(&chunk->thread, ts_parser__parse_chunk, chunk);
+    if (!chunk->has_thread) ts_parser__parse_chunk(chunk);
+  }
+  chunks.contents[0].parser = self;
+  ts_parser__parse_chunk(&chunks.contents[0]);
+  chunks.contents[0].parser = NULL;
+
+  bool did_halt = false;
+  for (uint32_t i = 0; i < chunks.size; i++) {
+    ParseChunk *chunk = &chunks.contents[i];
+    if (chunk->has_thread) ts_thread_join(&chunk->thread);
+    if (!chunk->tree) did_halt = true;
+  }
+  ts_parser__finish_parallel_output(self, &output);
+
+  // If a seam could not be joined, then reparse the chunks on either side of it
+  // together, and check the seams again. If that still fails, then give up and
+  // parse the entire document serially.
+  TSTree *result = NULL;
+  bool *seam_is_clean = ts_calloc(chunks.size, sizeof(bool));
+  for (unsigned attempt = 0; !did_halt && attempt < 2; attempt++) {
+    TSSymbol repeat_symbol = ts_parser__check_chunk_seams(
+      self,
+      chunks.contents,
+      chunks.size,
+      seam_is_clean
+    );
+
+    bool are_all_seams_clean = true;
+    for (uint32_t i = 1; i < chunks.size; i++) {
+      if (!seam_is_clean[i]) are_all_seams_clean = false;
+    }
+    if (are_all_seams_clean) {
+      Subtree root = ts_parser__join_chunks(self, chunks.contents, chunks.size, repeat_symbol);
+      ts_subtree_balance(root, &self->tree_pool, self->language);
+      result = ts_tree_new(root, self->language, self->lexer.included_ranges, 1);
+      break;
+    }
+    if (attempt > 0) break;
+
+    uint32_t chunk_count = 0;
+    for (uint32_t i = 0; i < chunks.size; i++) {
+      ParseChunk *chunk = &chunks.contents[chunk_count];
+      if (i > 0 && !seam_is_clean[i]) {
+        chunk--;
+        ts_tree_delete(chunk->tree);
+        ts_tree_delete(chunks.contents[i].tree);
+        chunk->tree = NULL;
+        chunk->end_byte = chunks.contents[i].end_byte;
+      } else {
+        *chunk = chunks.contents[i];
+        chunk_count++;
+      }
+    }
+    chunks.size = chunk_count;
+
+    for (uint32_t i = 0; i < chunks.size; i++) {
+      ParseChunk *chunk = &chunks.contents[i];
+      if (!chunk->tree) {
+        LOG("reparse_seam start:%u, end:%u", chunk->start_byte, chunk->end_byte);
+        chunk->parser = self;
+        ts_parser__parse_chunk(chunk);
+        chunk->parser = NULL;
+        if (!chunk->tree) did_halt = true;
+      }
+    }
+  }
+  ts_free(seam_is_clean);
+
+  for (uint32_t i = 0; i < chunks.size; i++) {
+    if (chunks.contents[i].tree) ts_tree_delete(chunks.contents[i].tree);
+  }
+  array_delete(&chunks);
+
+  if (did_halt) {
+    ts_parser_reset(self);
+    return NULL;
+  }
+  if (!result) {
+    LOG("parallel_parse_failed");
+    result = ts_parser_parse_string(self, NULL, string, length);
+  }
+  return result;
+}
+
+bool ts_parser_parse_batch(
+  TSParser *self,
+  const TSInput *inputs,
+  uint32_t count,
+  TSTree **trees
+) {
+  return ts_parser_parse_batch_parallel(self, inputs, count, trees, 1);
+}
+
+bool ts_parser_parse_batch_parallel(
+  TSParser *self,
+  const TSInput *inputs,
+  uint32_t count,
+  TSTree **trees,
+  uint32_t thread_count
+) {
+  for (uint32_t i = 0; i < count; i++) trees[i] = NULL;
+  if (!self->language) return false;
+
+  // A parse that was previously halted can't be resumed with these inputs.
+  ts_parser_reset(self);
+
+  if (thread_count > count) thread_count = count;
+  if (thread_count < 1) thread_count = 1;
+
+  ParallelOutput output;
+  ts_parser__start_parallel_output(self, &output);
+  volatile uint32_t next_index = 0;
+  ParseBatchWorker *workers = ts_calloc(thread_count, sizeof(ParseBatchWorker));
+  for (uint32_t i = 0; i < thread_count; i++) {
+    TSParser *parser = self;
+    if (i > 0) {
+      parser = ts_parser_new();
+      ts_parser_set_language(parser, self->language);
+      ts_lexer_set_included_ranges(
+        &parser->lexer,
+        self->lexer.included_ranges,
+        self->lexer.included_range_count
+      );
+      parser->cancellation_flag = self->cancellation_flag;
+      parser->timeout_duration = self->timeout_duration;
+      parser->arena_enabled = self->arena_enabled;
+      parser->version_limit = self->version_limit;
+      parser->allocator = self->allocator;
+      parser->lexer.logger = self->lexer.logger;
+      parser->dot_graph_file = self->dot_graph_file;
+      parser->output_mutex = self->output_mutex;
+    }
+    workers[i] = (ParseBatchWorker) {
+      .parser = parser,
+      .inputs = inputs,
+      .trees = trees,
+      .count = count,
+      .next_index = &next_index,
+      .has_thread = false,
+    };
+  }
+
+  // If a thread can't be started, the remaining workers pick up its share
+  // of the documents.
+  for (uint32_t i = 1; i < thread_count; i++) {
+    workers[i].has_thread = ts_thread_spawn(
+      &workers[i].thread,
+      ts_parser__parse_batch_documents,
+      &workers[i]
+    );
+  }
+  ts_parser__parse_batch_documents(&workers[0]);
+  for (uint32_t i = 1; i < thread_count; i++) {
+    if (workers[i].has_thread) ts_thread_join(&workers[i].thread);
+    ts_parser_delete(workers[i].parser);
+  }
+  ts_free(workers);
+  ts_parser__finish_parallel_output(self, &output);
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (!trees[i]) return false;
+  }
+  return true;
+}
+
 #undef LOG
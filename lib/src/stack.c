@@ -8,8 +8,9 @@
 #include <stdio.h>
 
 #define MAX_LINK_COUNT 8
-#define MAX_NODE_POOL_SIZE 50
 #define MAX_ITERATOR_COUNT 64
+#define MIN_NODE_SLAB_SIZE 4096
+#define MAX_NODE_SLAB_SIZE (256 * 1024)
 
 #if defined _WIN32 && !defined __GNUC__
 #define inline __forceinline
@@ -25,10 +26,19 @@ typedef struct {
   bool is_pending;
 } StackLink;
 
+// The links of a node beyond the first one. These are only needed where
+// two versions of the stack have been merged, so they are stored separately.
+typedef union StackLinkBlock StackLinkBlock;
+union StackLinkBlock {
+  StackLinkBlock *next_free;
+  StackLink links[MAX_LINK_COUNT - 1];
+};
+
 struct StackNode {
-  TSStateId state;
+  StackLink link;
+  StackLinkBlock *overflow_links;
   Length position;
-  StackLink links[MAX_LINK_COUNT];
+  TSStateId state;
   short unsigned int link_count;
   uint32_t ref_count;
   unsigned error_cost;
@@ -48,7 +58,24 @@ typedef struct {
   StackIterateCallback callback;
 } StackIterateSession;
 
-typedef Array(StackNode *) StackNodeArray;
+typedef struct StackNodeSlab StackNodeSlab;
+
+struct StackNodeSlab {
+  StackNodeSlab *next;
+  size_t size;
+};
+
+// The memory for a stack's nodes and their overflow links. It is allocated in
+// slabs, which are kept until the stack is deleted, and the nodes and link
+// blocks that are released are kept in free lists for reuse. A free node's
+// first link points to the next free node.
+typedef struct {
+  StackNodeSlab *slabs;
+  char *next;
+  char *end;
+  StackNode *free_nodes;
+  StackLinkBlock *free_link_blocks;
+} StackNodePool;
 
 typedef enum {
   StackStatusActive,
@@ -65,13 +92,29 @@ typedef struct {
   StackStatus status;
 } StackHead;
 
+typedef struct {
+  uint32_t hash;
+  StackVersion next;
+} StackMergeIndexEntry;
+
+// An index of the stack's versions by the state, position and error cost of
+// their heads, which have to be equal for two versions to be merged. It covers
+// a prefix of the versions, and is extended when it is searched. Each bucket
+// lists its versions in descending order, so that the index can be truncated
+// by unlinking versions from the fronts of their buckets.
+typedef struct {
+  Array(StackVersion) buckets;
+  Array(StackMergeIndexEntry) entries;
+} StackMergeIndex;
+
 struct Stack {
   Array(StackHead) heads;
   StackSliceArray slices;
   Array(StackIterator) iterators;
-  StackNodeArray node_pool;
+  StackNodePool node_pool;
   StackNode *base_node;
   SubtreePool *subtree_pool;
+  StackMergeIndex merge_index;
 };
 
 typedef unsigned StackAction;
@@ -83,6 +126,45 @@ enum {
 
 typedef StackAction (*StackCallback)(void *, const StackIterator *);
 
+static void *stack_node_pool__allocate(StackNodePool *self, size_t size) {
+  if ((size_t)(self->end - self->next) < size) {
+    size_t slab_size = self->slabs ? 2 * self->slabs->size : MIN_NODE_SLAB_SIZE;
+    if (slab_size > MAX_NODE_SLAB_SIZE) slab_size = MAX_NODE_SLAB_SIZE;
+    StackNodeSlab *slab = ts_malloc(slab_size);
+    slab->next = self->slabs;
+    slab->size = slab_size;
+    self->slabs = slab;
+    self->next = (char *)slab + sizeof(StackNodeSlab);
+    self->end = (char *)slab + slab_size;
+  }
+  void *result = self->next;
+  self->next += size;
+  return result;
+}
+
+static void stack_node_pool_delete(StackNodePool *self) {
+  StackNodeSlab *slab = self->slabs;
+  while (slab) {
+    StackNodeSlab *next = slab->next;
+    ts_free(slab);
+    slab = next;
+  }
+  *self = (StackNodePool) {0};
+}
+
+static StackLinkBlock *stack_node_pool__allocate_links(StackNodePool *self) {
+  StackLinkBlock *result = self->free_link_blocks;
+  if (result) {
+    self->free_link_blocks = result->next_free;
+    return result;
+  }
+  return stack_node_pool__allocate(self, sizeof(StackLinkBlock));
+}
+
+inline StackLink *stack_node_link(StackNode *self, unsigned index) {
+  return index == 0 ? &self->link : &self->overflow_links->links[index - 1];
+}
+
 static void stack_node_retain(StackNode *self) {
   if (!self)
     return;
@@ -91,7 +173,7 @@ static void stack_node_retain(StackNode *self) {
   assert(self->ref_count != 0);
 }
 
-static void stack_node_release(StackNode *self, StackNodeArray *pool, SubtreePool *subtree_pool) {
+static void stack_node_release(StackNode *self, StackNodePool *pool, SubtreePool *subtree_pool) {
 recur:
   assert(self->ref_count != 0);
   self->ref_count--;
@@ -100,20 +182,21 @@ recur:
   StackNode *first_predecessor = NULL;
   if (self->link_count > 0) {
     for (unsigned i = self->link_count - 1; i > 0; i--) {
-      StackLink link = self->links[i];
+      StackLink link = self->overflow_links->links[i - 1];
       if (link.subtree.ptr) ts_subtree_release(subtree_pool, link.subtree);
       stack_node_release(link.node, pool, subtree_pool);
     }
-    StackLink link = self->links[0];
+    StackLink link = self->link;
     if (link.subtree.ptr) ts_subtree_release(subtree_pool, link.subtree);
-    first_predecessor = self->links[0].node;
+    first_predecessor = self->link.node;
   }
 
-  if (pool->size < MAX_NODE_POOL_SIZE) {
-    array_push(pool, self);
-  } else {
-    ts_free(self);
+  if (self->overflow_links) {
+    self->overflow_links->next_free = pool->free_link_blocks;
+    pool->free_link_blocks = self->overflow_links;
   }
+  self->link.node = pool->free_nodes;
+  pool->free_nodes = self;
 
   if (first_predecessor) {
     self = first_predecessor;
@@ -122,15 +205,18 @@ recur:
 }
 
 static StackNode *stack_node_new(StackNode *previous_node, Subtree subtree,
-                                 bool is_pending, TSStateId state, StackNodeArray *pool) {
-  StackNode *node = pool->size > 0 ?
-    array_pop(pool) :
-    ts_malloc(sizeof(StackNode));
+                                 bool is_pending, TSStateId state, StackNodePool *pool) {
+  StackNode *node = pool->free_nodes;
+  if (node) {
+    pool->free_nodes = node->link.node;
+  } else {
+    node = stack_node_pool__allocate(pool, sizeof(StackNode));
+  }
   *node = (StackNode){.ref_count = 1, .link_count = 0, .state = state};
 
   if (previous_node) {
     node->link_count = 1;
-    node->links[0] = (StackLink){
+    node->link = (StackLink){
       .node = previous_node,
       .subtree = subtree,
       .is_pending = is_pending,
@@ -155,6 +241,22 @@ static StackNode *stack_node_new(StackNode *previous_node, Subtree subtree,
   return node;
 }
 
+// The heads of two stack versions can only be merged if they have the same
+// state, position and error cost.
+inline bool stack_node__can_merge(const StackNode *left, const StackNode *right) {
+  return
+    left->state == right->state &&
+    left->position.bytes == right->position.bytes &&
+    left->error_cost == right->error_cost;
+}
+
+inline uint32_t stack_node__merge_hash(const StackNode *self) {
+  uint32_t hash = self->state;
+  hash = (hash ^ self->position.bytes) * 0x9E3779B1u;
+  hash = (hash ^ self->error_cost) * 0x9E3779B1u;
+  return hash ^ (hash >> 16);
+}
+
 static bool stack__subtree_is_equivalent(Subtree left, Subtree right) {
   return
     left.ptr == right.ptr ||
@@ -168,11 +270,12 @@ static bool stack__subtree_is_equivalent(Subtree left, Subtree right) {
        ts_subtree_external_scanner_state_eq(left, right))));
 }
 
-static void stack_node_add_link(StackNode *self, StackLink link, SubtreePool *subtree_pool) {
+static void stack_node_add_link(StackNode *self, StackLink link,
+                                StackNodePool *pool, SubtreePool *subtree_pool) {
   if (link.node == self) return;
 
   for (int i = 0; i < self->link_count; i++) {
-    StackLink *existing_link = &self->links[i];
+    StackLink *existing_link = stack_node_link(self, i);
     if (stack__subtree_is_equivalent(existing_link->subtree, link.subtree)) {
       // In general, we preserve ambiguities until they are removed from the stack
       // during a pop operation where multiple paths lead to the same node. But in
@@ -196,7 +299,7 @@ static void stack_node_add_link(StackNode *self, StackLink link, SubtreePool *su
       if (existing_link->node->state == link.node->state &&
           existing_link->node->position.bytes == link.node->position.bytes) {
         for (int j = 0; j < link.node->link_count; j++) {
-          stack_node_add_link(existing_link->node, link.node->links[j], subtree_pool);
+          stack_node_add_link(existing_link->node, *stack_node_link(link.node, j), pool, subtree_pool);
         }
         int32_t dynamic_precedence = link.node->dynamic_precedence;
         if (link.subtree.ptr) {
@@ -211,11 +314,12 @@ static void stack_node_add_link(StackNode *self, StackLink link, SubtreePool *su
   }
 
   if (self->link_count == MAX_LINK_COUNT) return;
+  if (self->link_count == 1) self->overflow_links = stack_node_pool__allocate_links(pool);
 
   stack_node_retain(link.node);
   unsigned node_count = link.node->node_count;
   int dynamic_precedence = link.node->dynamic_precedence;
-  self->links[self->link_count++] = link;
+  *stack_node_link(self, self->link_count++) = link;
 
   if (link.subtree.ptr) {
     ts_subtree_retain(link.subtree);
@@ -227,7 +331,83 @@ static void stack_node_add_link(StackNode *self, StackLink link, SubtreePool *su
   if (dynamic_precedence > self->dynamic_precedence) self->dynamic_precedence = dynamic_precedence;
 }
 
-static void stack_head_delete(StackHead *self, StackNodeArray *pool, SubtreePool *subtree_pool) {
+inline uint32_t stack__merge_index_mask(const Stack *self) {
+  return self->merge_index.buckets.size - 1;
+}
+
+// Remove the versions at and after the given one from the merge index.
+static void stack__merge_index_truncate(Stack *self, StackVersion version) {
+  StackMergeIndex *index = &self->merge_index;
+  while (index->entries.size > version) {
+    StackVersion last = index->entries.size - 1;
+    StackMergeIndexEntry *entry = &index->entries.contents[last];
+    StackVersion *bucket = &index->buckets.contents[entry->hash & stack__merge_index_mask(self)];
+    assert(*bucket == last);
+    *bucket = entry->next;
+    index->entries.size--;
+  }
+}
+
+// Link the given version into its bucket, keeping the bucket in descending order.
+static void stack__merge_index_link(Stack *self, StackVersion version) {
+  StackMergeIndex *index = &self->merge_index;
+  StackVersion *next = &index->buckets.contents[
+    index->entries.contents[version].hash & stack__merge_index_mask(self)
+  ];
+  while (*next != STACK_VERSION_NONE && *next > version) {
+    next = &index->entries.contents[*next].next;
+  }
+  index->entries.contents[version].next = *next;
+  *next = version;
+}
+
+// Add versions to the merge index until it covers the given number of versions.
+static void stack__merge_index_extend(Stack *self, StackVersion count) {
+  StackMergeIndex *index = &self->merge_index;
+  if (index->entries.size >= count) return;
+
+  if (index->buckets.size < 2 * count) {
+    uint32_t bucket_count = index->buckets.size ? index->buckets.size : 16;
+    while (bucket_count < 2 * count) bucket_count *= 2;
+    array_reserve(&index->buckets, bucket_count);
+    index->buckets.size = bucket_count;
+    for (uint32_t i = 0; i < bucket_count; i++) {
+      index->buckets.contents[i] = STACK_VERSION_NONE;
+    }
+    for (StackVersion i = 0; i < index->entries.size; i++) {
+      stack__merge_index_link(self, i);
+    }
+  }
+
+  while (index->entries.size < count) {
+    StackVersion version = index->entries.size;
+    StackMergeIndexEntry entry = {
+      .hash = stack_node__merge_hash(self->heads.contents[version].node),
+      .next = STACK_VERSION_NONE,
+    };
+    array_push(&index->entries, entry);
+    stack__merge_index_link(self, version);
+  }
+}
+
+// Update the merge index after the head of the given version has changed.
+static void stack__merge_index_update(Stack *self, StackVersion version) {
+  StackMergeIndex *index = &self->merge_index;
+  if (version >= index->entries.size) return;
+  StackMergeIndexEntry *entry = &index->entries.contents[version];
+  uint32_t hash = stack_node__merge_hash(self->heads.contents[version].node);
+  if (hash == entry->hash) return;
+
+  StackVersion *next = &index->buckets.contents[entry->hash & stack__merge_index_mask(self)];
+  while (*next != version) {
+    next = &index->entries.contents[*next].next;
+  }
+  *next = entry->next;
+  entry->hash = hash;
+  stack__merge_index_link(self, version);
+}
+
+static void stack_head_delete(StackHead *self, StackNodePool *pool, SubtreePool *subtree_pool) {
   if (self->node) {
     if (self->last_external_token.ptr) {
       ts_subtree_release(subtree_pool, self->last_external_token);
@@ -288,7 +468,10 @@ inline StackSliceArray stack__iter(Stack *self, StackVersion version,
   bool include_subtrees = false;
   if (goal_subtree_count >= 0) {
     include_subtrees = true;
-    array_reserve(&iterator.subtrees, ts_subtree_alloc_size(goal_subtree_count) / sizeof(Subtree));
+    iterator.subtrees = ts_subtree_array_new(
+      self->subtree_pool,
+      ts_subtree_alloc_size(goal_subtree_count) / sizeof(Subtree)
+    );
   }
 
   array_push(&self->iterators, iterator);
@@ -305,7 +488,7 @@ inline StackSliceArray stack__iter(Stack *self, StackVersion version,
       if (should_pop) {
         SubtreeArray subtrees = iterator->subtrees;
         if (!should_stop) {
-          ts_subtree_array_copy(subtrees, &subtrees);
+          ts_subtree_array_copy(self->subtree_pool, subtrees, &subtrees);
         }
         ts_subtree_array_reverse(&subtrees);
         ts_stack__add_slice(
@@ -328,15 +511,15 @@ inline StackSliceArray stack__iter(Stack *self, StackVersion version,
         StackIterator *next_iterator;
         StackLink link;
         if (j == node->link_count) {
-          link = node->links[0];
+          link = node->link;
           next_iterator = &self->iterators.contents[i];
         } else {
           if (self->iterators.size >= MAX_ITERATOR_COUNT) continue;
-          link = node->links[j];
+          link = node->overflow_links->links[j - 1];
           StackIterator current_iterator = self->iterators.contents[i];
           array_push(&self->iterators, current_iterator);
           next_iterator = array_back(&self->iterators);
-          ts_subtree_array_copy(next_iterator->subtrees, &next_iterator->subtrees);
+          ts_subtree_array_copy(self->subtree_pool, next_iterator->subtrees, &next_iterator->subtrees);
         }
 
         next_iterator->node = link.node;
@@ -367,13 +550,13 @@ Stack *ts_stack_new(SubtreePool *subtree_pool) {
   Stack *self = ts_calloc(1, sizeof(Stack));
 
   array_init(&self->heads);
+  array_init(&self->merge_index.buckets);
+  array_init(&self->merge_index.entries);
   array_init(&self->slices);
   array_init(&self->iterators);
-  array_init(&self->node_pool);
   array_reserve(&self->heads, 4);
   array_reserve(&self->slices, 4);
   array_reserve(&self->iterators, 4);
-  array_reserve(&self->node_pool, MAX_NODE_POOL_SIZE);
 
   self->subtree_pool = subtree_pool;
   self->base_node = stack_node_new(NULL, NULL_SUBTREE, false, 1, &self->node_pool);
@@ -392,12 +575,10 @@ void ts_stack_delete(Stack *self) {
     stack_head_delete(&self->heads.contents[i], &self->node_pool, self->subtree_pool);
   }
   array_clear(&self->heads);
-  if (self->node_pool.contents) {
-    for (uint32_t i = 0; i < self->node_pool.size; i++)
-      ts_free(self->node_pool.contents[i]);
-    array_delete(&self->node_pool);
-  }
+  stack_node_pool_delete(&self->node_pool);
   array_delete(&self->heads);
+  array_delete(&self->merge_index.buckets);
+  array_delete(&self->merge_index.entries);
   ts_free(self);
 }
 
@@ -429,7 +610,7 @@ unsigned ts_stack_error_cost(const Stack *self, StackVersion version) {
   unsigned result = head->node->error_cost;
   if (
     head->status == StackStatusPaused ||
-    (head->node->state == ERROR_STATE && !head->node->links[0].subtree.ptr)) {
+    (head->node->state == ERROR_STATE && !head->node->link.subtree.ptr)) {
     result += ERROR_COST_PER_RECOVERY;
   }
   return result;
@@ -449,6 +630,7 @@ void ts_stack_push(Stack *self, StackVersion version, Subtree subtree,
   StackNode *new_node = stack_node_new(head->node, subtree, pending, state, &self->node_pool);
   if (!subtree.ptr) head->node_count_at_last_error = new_node->node_count;
   head->node = new_node;
+  stack__merge_index_update(self, version);
 }
 
 inline StackAction iterate_callback(void *payload, const StackIterator *iterator) {
@@ -519,7 +701,8 @@ inline StackAction pop_error_callback(void *payload, const StackIterator *iterat
 SubtreeArray ts_stack_pop_error(Stack *self, StackVersion version) {
   StackNode *node = array_get(&self->heads, version)->node;
   for (unsigned i = 0; i < node->link_count; i++) {
-    if (node->links[i].subtree.ptr && ts_subtree_is_error(node->links[i].subtree)) {
+    Subtree subtree = stack_node_link(node, i)->subtree;
+    if (subtree.ptr && ts_subtree_is_error(subtree)) {
       bool found_error = false;
       StackSliceArray pop = stack__iter(self, version, pop_error_callback, &found_error, 1);
       if (pop.size > 0) {
@@ -594,7 +777,7 @@ bool ts_stack_has_advanced_since_error(const Stack *self, StackVersion version)
   if (node->error_cost == 0) return true;
   while (node) {
     if (node->link_count > 0) {
-      Subtree subtree = node->links[0].subtree;
+      Subtree subtree = node->link.subtree;
       if (subtree.ptr) {
         if (ts_subtree_total_bytes(subtree) > 0) {
           return true;
@@ -602,7 +785,7 @@ bool ts_stack_has_advanced_since_error(const Stack *self, StackVersion version)
           node->node_count > head->node_count_at_last_error &&
           ts_subtree_error_cost(subtree) == 0
         ) {
-          node = node->links[0].node;
+          node = node->link.node;
           continue;
         }
       }
@@ -613,6 +796,7 @@ bool ts_stack_has_advanced_since_error(const Stack *self, StackVersion version)
 }
 
 void ts_stack_remove_version(Stack *self, StackVersion version) {
+  stack__merge_index_truncate(self, version);
   stack_head_delete(array_get(&self->heads, version), &self->node_pool, self->subtree_pool);
   array_erase(&self->heads, version);
 }
@@ -627,15 +811,19 @@ void ts_stack_renumber_version(Stack *self, StackVersion v1, StackVersion v2) {
     source_head->summary = target_head->summary;
     target_head->summary = NULL;
   }
+  stack__merge_index_truncate(self, v1);
   stack_head_delete(target_head, &self->node_pool, self->subtree_pool);
   *target_head = *source_head;
   array_erase(&self->heads, v1);
+  stack__merge_index_update(self, v2);
 }
 
 void ts_stack_swap_versions(Stack *self, StackVersion v1, StackVersion v2) {
   StackHead temporary_head = self->heads.contents[v1];
   self->heads.contents[v1] = self->heads.contents[v2];
   self->heads.contents[v2] = temporary_head;
+  stack__merge_index_update(self, v1);
+  stack__merge_index_update(self, v2);
 }
 
 StackVersion ts_stack_copy_version(Stack *self, StackVersion version) {
@@ -653,7 +841,12 @@ bool ts_stack_merge(Stack *self, StackVersion version1, StackVersion version2) {
   StackHead *head1 = &self->heads.contents[version1];
   StackHead *head2 = &self->heads.contents[version2];
   for (uint32_t i = 0; i < head2->node->link_count; i++) {
-    stack_node_add_link(head1->node, head2->node->links[i], self->subtree_pool);
+    stack_node_add_link(
+      head1->node,
+      *stack_node_link(head2->node, i),
+      &self->node_pool,
+      self->subtree_pool
+    );
   }
   if (head1->node->state == ERROR_STATE) {
     head1->node_count_at_last_error = head1->node->node_count;
@@ -668,12 +861,36 @@ bool ts_stack_can_merge(Stack *self, StackVersion version1, StackVersion version
   return
     head1->status == StackStatusActive &&
     head2->status == StackStatusActive &&
-    head1->node->state == head2->node->state &&
-    head1->node->position.bytes == head2->node->position.bytes &&
-    head1->node->error_cost == head2->node->error_cost &&
+    stack_node__can_merge(head1->node, head2->node) &&
     ts_subtree_external_scanner_state_eq(head1->last_external_token, head2->last_external_token);
 }
 
+StackVersion ts_stack_merge_candidate(
+  Stack *self,
+  StackVersion version,
+  StackVersion start,
+  StackVersion skip
+) {
+  StackHead *head = array_get(&self->heads, version);
+  if (head->status != StackStatusActive) return STACK_VERSION_NONE;
+  stack__merge_index_extend(self, version);
+  if (!self->merge_index.buckets.size) return STACK_VERSION_NONE;
+
+  StackVersion result = STACK_VERSION_NONE;
+  StackVersion candidate = self->merge_index.buckets.contents[
+    stack_node__merge_hash(head->node) & stack__merge_index_mask(self)
+  ];
+  while (candidate != STACK_VERSION_NONE && candidate >= start) {
+    if (
+      candidate < version &&
+      candidate != skip &&
+      ts_stack_can_merge(self, candidate, version)
+    ) result = candidate;
+    candidate = self->merge_index.entries.contents[candidate].next;
+  }
+  return result;
+}
+
 void ts_stack_halt(Stack *self, StackVersion version) {
   array_get(&self->heads, version)->status = StackStatusHalted;
 }
@@ -707,6 +924,7 @@ TSSymbol ts_stack_resume(Stack *self, StackVersion version) {
 }
 
 void ts_stack_clear(Stack *self) {
+  stack__merge_index_truncate(self, 0);
   stack_node_retain(self->base_node);
   for (uint32_t i = 0; i < self->heads.size; i++) {
     stack_head_delete(&self->heads.contents[i], &self->node_pool, self->subtree_pool);
@@ -787,8 +1005,8 @@ bool ts_stack_print_dot_graph(Stack *self, const TSLanguage *language, FILE *f)
         fprintf(f, "label=\"?\"");
       } else if (
         node->link_count == 1 &&
-        node->links[0].subtree.ptr &&
-        ts_subtree_extra(node->links[0].subtree)
+        node->link.subtree.ptr &&
+        ts_subtree_extra(node->link.subtree)
       ) {
         fprintf(f, "shape=point margin=0 label=\"\"");
       } else {
@@ -806,7 +1024,7 @@ bool ts_stack_print_dot_graph(Stack *self, const TSLanguage *language, FILE *f)
       );
 
       for (int j = 0; j < node->link_count; j++) {
-        StackLink link = node->links[j];
+        StackLink link = *stack_node_link(node, j);
         fprintf(f, "node_%p -> node_%p [", node, link.node);
         if (link.is_pending) fprintf(f, "style=dashed ");
         if (link.subtree.ptr && ts_subtree_extra(link.subtree)) fprintf(f, "fontcolor=gray ");
@@ -99,6 +99,13 @@ bool ts_stack_merge(Stack *, StackVersion, StackVersion);
 // Determine whether the given two stack versions can be merged.
 bool ts_stack_can_merge(Stack *, StackVersion, StackVersion);
 
+// Find the first version that the given version can be merged into, among
+// the versions between `start` and the given version, other than `skip`.
+// The versions are looked up by the state, position and error cost of their
+// heads, so this doesn't compare the version with every other version.
+// Returns STACK_VERSION_NONE if there is no such version.
+StackVersion ts_stack_merge_candidate(Stack *, StackVersion, StackVersion start, StackVersion skip);
+
 TSSymbol ts_stack_resume(Stack *, StackVersion);
 
 void ts_stack_pause(Stack *, StackVersion, TSSymbol);
@@ -20,36 +20,264 @@ typedef struct {
 
 #define TS_MAX_INLINE_TREE_LENGTH UINT8_MAX
 #define TS_MAX_TREE_POOL_SIZE 32
+#define TS_MAX_ARRAY_POOL_SIZE 32
+#define TS_MAX_POOLED_ARRAY_CAPACITY 256
+#define TS_MIN_ARENA_SLAB_SIZE 4096
+#define TS_MAX_ARENA_SLAB_SIZE (1024 * 1024)
+#define TS_ARENA_ALIGNMENT 8
 
-static const ExternalScannerState empty_state = {{.short_data = {0}}, .length = 0};
+static const ExternalScannerState empty_state = {{.short_data = {0}}, .length = 0, .hash = 0};
+
+// SubtreeArena
+
+struct SubtreeArenaSlab {
+  SubtreeArenaSlab *next;
+  size_t size;
+};
+
+static void *ts_subtree_arena__malloc(const TSAllocator *allocator, size_t size) {
+  if (allocator->malloc) return allocator->malloc(allocator->payload, size);
+  return ts_malloc(size);
+}
+
+static void ts_subtree_arena__free(const TSAllocator *allocator, void *buffer, size_t size) {
+  if (allocator->free) {
+    allocator->free(allocator->payload, buffer, size);
+  } else {
+    ts_free(buffer);
+  }
+}
+
+// Create an arena whose memory comes from the given allocator, or from the
+// default allocation functions if the allocator is NULL or doesn't have both
+// of its functions.
+SubtreeArena *ts_subtree_arena_new(const TSAllocator *allocator) {
+  TSAllocator arena_allocator = allocator && allocator->malloc && allocator->free
+    ? *allocator
+    : (TSAllocator) {.payload = NULL, .malloc = NULL, .free = NULL};
+  SubtreeArena *self = ts_subtree_arena__malloc(&arena_allocator, sizeof(SubtreeArena));
+  *self = (SubtreeArena) {
+    .slabs = NULL,
+    .next = NULL,
+    .end = NULL,
+    .free_trees = array_new(),
+    .allocator = arena_allocator,
+    .ref_count = 1,
+    .is_shared = false,
+  };
+  return self;
+}
+
+void ts_subtree_arena_retain(SubtreeArena *self) {
+  assert(self->ref_count > 0);
+  atomic_inc(&self->ref_count);
+  assert(self->ref_count != 0);
+}
+
+void ts_subtree_arena_release(SubtreeArena *self) {
+  assert(self->ref_count > 0);
+  if (atomic_dec(&self->ref_count) == 0) {
+    ts_subtree_arena_delete(self);
+  }
+}
+
+// Free all of the arena's memory at once, regardless of which of its
+// subtrees are still alive.
+void ts_subtree_arena_delete(SubtreeArena *self) {
+  SubtreeArenaSlab *slab = self->slabs;
+  while (slab) {
+    SubtreeArenaSlab *next = slab->next;
+    ts_subtree_arena__free(&self->allocator, slab, slab->size);
+    slab = next;
+  }
+  array_delete(&self->free_trees);
+  TSAllocator allocator = self->allocator;
+  ts_subtree_arena__free(&allocator, self, sizeof(SubtreeArena));
+}
+
+static inline size_t ts_subtree_arena__align(size_t size) {
+  return (size + TS_ARENA_ALIGNMENT - 1) & ~(size_t)(TS_ARENA_ALIGNMENT - 1);
+}
+
+static void ts_subtree_arena__add_slab(SubtreeArena *self, size_t slab_size) {
+  SubtreeArenaSlab *slab = ts_subtree_arena__malloc(&self->allocator, slab_size);
+  slab->next = self->slabs;
+  slab->size = slab_size;
+  self->slabs = slab;
+  self->next = (char *)slab + sizeof(SubtreeArenaSlab);
+  self->end = (char *)slab + slab_size;
+}
+
+// Allocate memory from an arena. This is only done by the parser that owns
+// the arena, before any of the arena's subtrees are visible to other threads.
+static void *ts_subtree_arena__allocate(SubtreeArena *self, size_t size) {
+  size = ts_subtree_arena__align(size);
+  if ((size_t)(self->end - self->next) < size) {
+    size_t slab_size = self->slabs ? 2 * self->slabs->size : TS_MIN_ARENA_SLAB_SIZE;
+    if (slab_size > TS_MAX_ARENA_SLAB_SIZE) slab_size = TS_MAX_ARENA_SLAB_SIZE;
+    if (slab_size < sizeof(SubtreeArenaSlab) + size) slab_size = sizeof(SubtreeArenaSlab) + size;
+    ts_subtree_arena__add_slab(self, slab_size);
+  }
+  void *result = self->next;
+  self->next += size;
+  return result;
+}
+
+// Allocate a subtree with room for the given number of children from an
+// arena. The subtree retains the arena, and a pointer to the arena is stored
+// immediately before the children.
+static SubtreeHeapData *ts_subtree_arena__allocate_node(SubtreeArena *self, uint32_t child_count) {
+  SubtreeArena **header = ts_subtree_arena__allocate(
+    self,
+    sizeof(SubtreeArena *) + ts_subtree_alloc_size(child_count)
+  );
+  *header = self;
+
+  // No other thread can release this arena's subtrees yet, so the count
+  // doesn't need to be updated atomically.
+  self->ref_count++;
+  return (SubtreeHeapData *)((Subtree *)(header + 1) + child_count);
+}
 
 // ExternalScannerState
 
-void ts_external_scanner_state_init(ExternalScannerState *self, const char *data, unsigned length) {
-  self->length = length;
+// A long external scanner state that is stored on the heap, and shared by
+// the subtrees whose states have the same bytes.
+typedef struct {
+  volatile uint32_t ref_count;
+  char data[];
+} ExternalScannerStateBuffer;
+
+static inline ExternalScannerStateBuffer *ts_external_scanner_state__buffer(
+  const ExternalScannerState *self
+) {
+  return (ExternalScannerStateBuffer *)(self->long_data - offsetof(ExternalScannerStateBuffer, data));
+}
+
+static inline uint32_t ts_external_scanner_state__hash(const char *data, unsigned length) {
+  uint32_t hash = length;
+  for (unsigned i = 0; i < length; i++) {
+    hash = hash * 31 + (unsigned char)data[i];
+  }
+  return hash;
+}
+
+static void ts_external_scanner_state_retain(const ExternalScannerState *self) {
+  if (self->length > sizeof(self->short_data)) {
+    atomic_inc(&ts_external_scanner_state__buffer(self)->ref_count);
+  }
+}
+
+// Release a state that is stored on the heap.
+void ts_external_scanner_state_delete(ExternalScannerState *self) {
+  if (self->length > sizeof(self->short_data)) {
+    ExternalScannerStateBuffer *buffer = ts_external_scanner_state__buffer(self);
+    if (atomic_dec(&buffer->ref_count) == 0) ts_free(buffer);
+  }
+}
+
+// Find the long state with the given bytes in a table, adding one if there
+// isn't any. New states are stored in the given arena if there is one, and
+// otherwise in a buffer on the heap, which the table retains.
+static const ExternalScannerState *ts_external_scanner_state_table__intern(
+  ExternalScannerStateTable *self,
+  SubtreeArena *arena,
+  const char *data,
+  unsigned length,
+  uint32_t hash
+) {
+  if (2 * (self->size + 1) > self->mask) {
+    uint32_t old_capacity = self->entries ? self->mask + 1 : 0;
+    ExternalScannerState *old_entries = self->entries;
+    uint32_t capacity = old_capacity ? 2 * old_capacity : 16;
+    self->entries = ts_calloc(capacity, sizeof(ExternalScannerState));
+    self->mask = capacity - 1;
+    for (uint32_t i = 0; i < old_capacity; i++) {
+      if (!old_entries[i].long_data) continue;
+      uint32_t j = (old_entries[i].hash * 2654435761u) & self->mask;
+      while (self->entries[j].long_data) j = (j + 1) & self->mask;
+      self->entries[j] = old_entries[i];
+    }
+    ts_free(old_entries);
+  }
+
+  uint32_t i = (hash * 2654435761u) & self->mask;
+  while (self->entries[i].long_data) {
+    ExternalScannerState *entry = &self->entries[i];
+    if (
+      entry->hash == hash &&
+      entry->length == length &&
+      !memcmp(entry->long_data, data, length)
+    ) return entry;
+    i = (i + 1) & self->mask;
+  }
+
+  ExternalScannerState *entry = &self->entries[i];
+  if (arena) {
+    entry->long_data = ts_subtree_arena__allocate(arena, length);
+  } else {
+    ExternalScannerStateBuffer *buffer = ts_malloc(sizeof(ExternalScannerStateBuffer) + length);
+    buffer->ref_count = 1;
+    entry->long_data = buffer->data;
+  }
+  memcpy(entry->long_data, data, length);
+  entry->length = length;
+  entry->hash = hash;
+  self->size++;
+  return entry;
+}
+
+// Remove all of the states from a table. If the states are on the heap, the
+// table's references to them are released.
+static void ts_external_scanner_state_table__clear(ExternalScannerStateTable *self, bool is_in_arena) {
+  if (!is_in_arena) {
+    for (uint32_t i = 0; self->entries && i <= self->mask; i++) {
+      if (self->entries[i].long_data) ts_external_scanner_state_delete(&self->entries[i]);
+    }
+  }
+  ts_free(self->entries);
+  *self = (ExternalScannerStateTable) {.entries = NULL, .size = 0, .mask = 0};
+}
+
+// Initialize the external scanner state of a subtree that was allocated from
+// the given pool. Long states are interned in the pool's table, and are stored
+// in the pool's arena, if it has one.
+void ts_external_scanner_state_init(
+  ExternalScannerState *self,
+  SubtreePool *pool,
+  const char *data,
+  unsigned length
+) {
+  uint32_t hash = ts_external_scanner_state__hash(data, length);
   if (length > sizeof(self->short_data)) {
-    self->long_data = ts_malloc(length);
-    memcpy(self->long_data, data, length);
+    *self = *ts_external_scanner_state_table__intern(
+      &pool->external_scanner_states,
+      pool->arena,
+      data,
+      length,
+      hash
+    );
+    if (!pool->arena) ts_external_scanner_state_retain(self);
   } else {
+    self->length = length;
+    self->hash = hash;
     memcpy(self->short_data, data, length);
   }
 }
 
-ExternalScannerState ts_external_scanner_state_copy(const ExternalScannerState *self) {
+// Copy a state into an arena.
+static ExternalScannerState ts_external_scanner_state_copy(
+  const ExternalScannerState *self,
+  SubtreeArena *arena
+) {
   ExternalScannerState result = *self;
   if (self->length > sizeof(self->short_data)) {
-    result.long_data = ts_malloc(self->length);
+    result.long_data = ts_subtree_arena__allocate(arena, self->length);
     memcpy(result.long_data, self->long_data, self->length);
   }
   return result;
 }
 
-void ts_external_scanner_state_delete(ExternalScannerState *self) {
-  if (self->length > sizeof(self->short_data)) {
-    ts_free(self->long_data);
-  }
-}
-
 const char *ts_external_scanner_state_data(const ExternalScannerState *self) {
   if (self->length > sizeof(self->short_data)) {
     return self->long_data;
@@ -59,20 +287,66 @@ const char *ts_external_scanner_state_data(const ExternalScannerState *self) {
 }
 
 bool ts_external_scanner_state_eq(const ExternalScannerState *a, const ExternalScannerState *b) {
-  return a == b || (
-    a->length == b->length &&
-    !memcmp(ts_external_scanner_state_data(a), ts_external_scanner_state_data(b), a->length)
-  );
+  if (a == b) return true;
+  if (a->length != b->length || a->hash != b->hash) return false;
+  const char *a_data = ts_external_scanner_state_data(a);
+  const char *b_data = ts_external_scanner_state_data(b);
+  return a_data == b_data || !memcmp(a_data, b_data, a->length);
 }
 
 // SubtreeArray
 
-void ts_subtree_array_copy(SubtreeArray self, SubtreeArray *dest) {
+// The arrays of subtrees that are popped from the stack are often only
+// temporary: stack iteration copies them for each path, and the arrays of
+// paths that are discarded are deleted. While a pool is allocating from an
+// arena, every array is temporary, because the children of each new node are
+// copied into the arena. So the arrays' buffers are kept in the pool and
+// reused, instead of being allocated and freed for every pop.
+//
+// Without an arena, a new node takes ownership of its array of children, so
+// only the buffers of arrays that don't become nodes are kept.
+static void ts_subtree_pool__recycle_array(SubtreePool *self, SubtreeArray *array) {
+  if (
+    array->capacity > 0 &&
+    array->capacity <= TS_MAX_POOLED_ARRAY_CAPACITY &&
+    self->free_arrays.size < TS_MAX_ARRAY_POOL_SIZE
+  ) {
+    array->size = 0;
+    array_push(&self->free_arrays, *array);
+    *array = (SubtreeArray) array_new();
+  } else {
+    array_delete(array);
+  }
+}
+
+// Create an empty array of subtrees with room for the given number of
+// subtrees, reusing one of the pool's buffers if possible. Without an arena,
+// the buffer may become the storage of a new node, so only a buffer with
+// exactly the given capacity is reused, to avoid wasting memory in the tree.
+SubtreeArray ts_subtree_array_new(SubtreePool *pool, uint32_t capacity) {
+  SubtreeArray result = array_new();
+  if (pool) {
+    for (uint32_t i = pool->free_arrays.size; i > 0; i--) {
+      SubtreeArray *array = &pool->free_arrays.contents[i - 1];
+      if (pool->arena || array->capacity == capacity) {
+        result = *array;
+        *array = *array_back(&pool->free_arrays);
+        pool->free_arrays.size--;
+        break;
+      }
+    }
+  }
+  array_reserve(&result, capacity);
+  return result;
+}
+
+void ts_subtree_array_copy(SubtreePool *pool, SubtreeArray self, SubtreeArray *dest) {
   dest->size = self.size;
   dest->capacity = self.capacity;
   dest->contents = self.contents;
   if (self.capacity > 0) {
-    dest->contents = ts_calloc(self.capacity, sizeof(Subtree));
+    *dest = ts_subtree_array_new(pool, self.capacity);
+    dest->size = self.size;
     memcpy(dest->contents, self.contents, self.size * sizeof(Subtree));
     for (uint32_t i = 0; i < self.size; i++) {
       ts_subtree_retain(dest->contents[i]);
@@ -89,7 +363,11 @@ void ts_subtree_array_clear(SubtreePool *pool, SubtreeArray *self) {
 
 void ts_subtree_array_delete(SubtreePool *pool, SubtreeArray *self) {
   ts_subtree_array_clear(pool, self);
-  array_delete(self);
+  if (pool) {
+    ts_subtree_pool__recycle_array(pool, self);
+  } else {
+    array_delete(self);
+  }
 }
 
 void ts_subtree_array_remove_trailing_extras(
@@ -121,7 +399,16 @@ void ts_subtree_array_reverse(SubtreeArray *self) {
 // SubtreePool
 
 SubtreePool ts_subtree_pool_new(uint32_t capacity) {
-  SubtreePool self = {array_new(), array_new()};
+  SubtreePool self = {
+    .free_trees = array_new(),
+    .tree_stack = array_new(),
+    .free_arrays = array_new(),
+    .allocation_count = 0,
+    .reuse_count = 0,
+    .arena = NULL,
+    .external_scanner_states = {.entries = NULL, .size = 0, .mask = 0},
+    .is_private = false,
+  };
   array_reserve(&self.free_trees, capacity);
   return self;
 }
@@ -134,16 +421,44 @@ void ts_subtree_pool_delete(SubtreePool *self) {
     array_delete(&self->free_trees);
   }
   if (self->tree_stack.contents) array_delete(&self->tree_stack);
+  for (unsigned i = 0; i < self->free_arrays.size; i++) {
+    array_delete(&self->free_arrays.contents[i]);
+  }
+  array_delete(&self->free_arrays);
+  ts_external_scanner_state_table__clear(&self->external_scanner_states, self->arena != NULL);
 }
 
 static SubtreeHeapData *ts_subtree_pool_allocate(SubtreePool *self) {
-  if (self->free_trees.size > 0) {
+  self->allocation_count++;
+  if (self->arena) {
+    if (self->arena->free_trees.size > 0) {
+      self->reuse_count++;
+      return array_pop(&self->arena->free_trees).ptr;
+    }
+    return ts_subtree_arena__allocate_node(self->arena, 0);
+  } else if (self->free_trees.size > 0) {
+    self->reuse_count++;
     return array_pop(&self->free_trees).ptr;
   } else {
     return ts_malloc(sizeof(SubtreeHeapData));
   }
 }
 
+// Stop allocating subtrees from the pool's arena, and return the arena.
+//
+// This is done at the end of each parse, so the pool's interned external
+// scanner states are forgotten as well.
+SubtreeArena *ts_subtree_pool_take_arena(SubtreePool *self) {
+  SubtreeArena *arena = self->arena;
+  ts_external_scanner_state_table__clear(&self->external_scanner_states, arena != NULL);
+  if (arena) {
+    arena->ref_count -= arena->free_trees.size;
+    array_delete(&arena->free_trees);
+    self->arena = NULL;
+  }
+  return arena;
+}
+
 static void ts_subtree_pool_free(SubtreePool *self, SubtreeHeapData *tree) {
   if (self->free_trees.capacity > 0 && self->free_trees.size + 1 <= TS_MAX_TREE_POOL_SIZE) {
     array_push(&self->free_trees, (MutableSubtree) {.ptr = tree});
@@ -155,13 +470,40 @@ static void ts_subtree_pool_free(SubtreePool *self, SubtreeHeapData *tree) {
 // Subtree
 
 static inline bool ts_subtree_can_inline(Length padding, Length size, uint32_t lookahead_bytes) {
-  return
-    padding.bytes < TS_MAX_INLINE_TREE_LENGTH &&
-    padding.extent.row < 16 &&
-    padding.extent.column < TS_MAX_INLINE_TREE_LENGTH &&
-    size.extent.row == 0 &&
-    size.extent.column < TS_MAX_INLINE_TREE_LENGTH &&
-    lookahead_bytes < 16;
+  if (size.extent.row > 0 || size.extent.column != size.bytes || lookahead_bytes >= 16) return false;
+  if (padding.extent.row == 0) {
+    return
+      padding.extent.column == padding.bytes &&
+      padding.bytes < (1 << 10) &&
+      size.bytes < (1 << 18);
+  } else {
+    return
+      padding.extent.row < 16 &&
+      padding.extent.column < (1 << 9) &&
+      padding.bytes - padding.extent.column < (1 << 7) &&
+      size.bytes < (1 << 8);
+  }
+}
+
+// Store the extent of an inline leaf, which must satisfy `ts_subtree_can_inline`.
+static inline void ts_subtree__set_inline_extent(
+  SubtreeInlineData *self,
+  Length padding,
+  Length size,
+  uint32_t lookahead_bytes
+) {
+  self->has_padding_rows = padding.extent.row > 0;
+  if (self->has_padding_rows) {
+    self->multi_line.padding_rows = padding.extent.row;
+    self->multi_line.padding_columns = padding.extent.column;
+    self->multi_line.padding_row_bytes = padding.bytes - padding.extent.column;
+    self->multi_line.size_bytes = size.bytes;
+    self->multi_line.lookahead_bytes = lookahead_bytes;
+  } else {
+    self->single_line.padding_bytes = padding.bytes;
+    self->single_line.size_bytes = size.bytes;
+    self->single_line.lookahead_bytes = lookahead_bytes;
+  }
 }
 
 Subtree ts_subtree_new_leaf(
@@ -180,14 +522,9 @@ Subtree ts_subtree_new_leaf(
   );
 
   if (is_inline) {
-    return (Subtree) {{
+    Subtree result = {{
       .parse_state = parse_state,
       .symbol = symbol,
-      .padding_bytes = padding.bytes,
-      .padding_rows = padding.extent.row,
-      .padding_columns = padding.extent.column,
-      .size_bytes = size.bytes,
-      .lookahead_bytes = lookahead_bytes,
       .visible = metadata.visible,
       .named = metadata.named,
       .extra = extra,
@@ -196,6 +533,8 @@ Subtree ts_subtree_new_leaf(
       .is_keyword = is_keyword,
       .is_inline = true,
     }};
+    ts_subtree__set_inline_extent(&result.data, padding, size, lookahead_bytes);
+    return result;
   } else {
     SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
     *data = (SubtreeHeapData) {
@@ -217,6 +556,8 @@ Subtree ts_subtree_new_leaf(
       .depends_on_column = depends_on_column,
       .is_missing = false,
       .is_keyword = is_keyword,
+      .is_arena_allocated = pool->arena != NULL,
+      .is_private = pool->is_private,
       {{.first_leaf = {.symbol = 0, .parse_state = 0}}}
     };
     return (Subtree) {.ptr = data};
@@ -257,25 +598,518 @@ Subtree ts_subtree_new_error(
 }
 
 // Clone a subtree.
-MutableSubtree ts_subtree_clone(Subtree self) {
-  size_t alloc_size = ts_subtree_alloc_size(self.ptr->child_count);
-  Subtree *new_children = ts_malloc(alloc_size);
+MutableSubtree ts_subtree_clone(SubtreePool *pool, Subtree self) {
+  uint32_t child_count = self.ptr->child_count;
+  size_t alloc_size = ts_subtree_alloc_size(child_count);
+  SubtreeHeapData *result;
+  pool->allocation_count++;
+  if (pool->arena) {
+    result = ts_subtree_arena__allocate_node(pool->arena, child_count);
+  } else {
+    result = (SubtreeHeapData *)((Subtree *)ts_malloc(alloc_size) + child_count);
+  }
+  Subtree *new_children = (Subtree *)result - child_count;
   Subtree *old_children = ts_subtree_children(self);
   memcpy(new_children, old_children, alloc_size);
-  SubtreeHeapData *result = (SubtreeHeapData *)&new_children[self.ptr->child_count];
-  if (self.ptr->child_count > 0) {
-    for (uint32_t i = 0; i < self.ptr->child_count; i++) {
+  result->is_arena_allocated = pool->arena != NULL;
+  result->is_private = pool->is_private;
+  if (child_count > 0) {
+    for (uint32_t i = 0; i < child_count; i++) {
       ts_subtree_retain(new_children[i]);
     }
   } else if (self.ptr->has_external_tokens) {
-    result->external_scanner_state = ts_external_scanner_state_copy(
-      &self.ptr->external_scanner_state
-    );
+    const ExternalScannerState *state = &self.ptr->external_scanner_state;
+    if (!pool->arena && !self.ptr->is_arena_allocated) {
+      ts_external_scanner_state_retain(state);
+    } else {
+      ts_external_scanner_state_init(
+        &result->external_scanner_state,
+        pool,
+        ts_external_scanner_state_data(state),
+        state->length
+      );
+    }
+  }
+  result->ref_count = 1;
+  return (MutableSubtree) {.ptr = result};
+}
+
+// A hash table of leaves, used to find leaves with identical contents.
+typedef struct {
+  const SubtreeHeapData *leaf;
+  SubtreeHeapData *copy;
+} LeafTableEntry;
+
+typedef struct {
+  LeafTableEntry *entries;
+  uint32_t size;
+  uint32_t mask;
+} LeafTable;
+
+static inline uint32_t ts_subtree__leaf_hash(const SubtreeHeapData *self) {
+  uint32_t hash = self->symbol;
+  hash = hash * 31 + self->parse_state;
+  hash = hash * 31 + self->padding.bytes;
+  hash = hash * 31 + self->padding.extent.row;
+  hash = hash * 31 + self->size.bytes;
+  hash = hash * 31 + self->size.extent.row;
+  hash = hash * 31 + self->lookahead_bytes;
+  if (self->has_external_tokens) hash = hash * 31 + self->external_scanner_state.hash;
+  return hash * 2654435761u;
+}
+
+static bool ts_subtree__leaf_eq(const SubtreeHeapData *self, const SubtreeHeapData *other) {
+  if (
+    self->symbol != other->symbol ||
+    self->parse_state != other->parse_state ||
+    !length_eq(self->padding, other->padding) ||
+    !length_eq(self->size, other->size) ||
+    self->lookahead_bytes != other->lookahead_bytes ||
+    self->visible != other->visible ||
+    self->named != other->named ||
+    self->extra != other->extra ||
+    self->fragile_left != other->fragile_left ||
+    self->fragile_right != other->fragile_right ||
+    self->has_changes != other->has_changes ||
+    self->has_external_tokens != other->has_external_tokens ||
+    self->depends_on_column != other->depends_on_column ||
+    self->is_missing != other->is_missing ||
+    self->is_keyword != other->is_keyword
+  ) return false;
+  if (self->has_external_tokens) {
+    return ts_external_scanner_state_eq(&self->external_scanner_state, &other->external_scanner_state);
+  }
+  if (self->symbol == ts_builtin_sym_error) {
+    return self->lookahead_char == other->lookahead_char;
+  }
+  return true;
+}
+
+// Find the entry for a leaf with the same contents as the given leaf, adding
+// one if there isn't any.
+static LeafTableEntry *ts_subtree__leaf_table_find(LeafTable *self, const SubtreeHeapData *leaf) {
+  if (2 * (self->size + 1) > self->mask) {
+    uint32_t old_capacity = self->entries ? self->mask + 1 : 0;
+    LeafTableEntry *old_entries = self->entries;
+    uint32_t capacity = old_capacity ? 2 * old_capacity : 64;
+    self->entries = ts_calloc(capacity, sizeof(LeafTableEntry));
+    self->mask = capacity - 1;
+    for (uint32_t i = 0; i < old_capacity; i++) {
+      if (!old_entries[i].leaf) continue;
+      uint32_t j = ts_subtree__leaf_hash(old_entries[i].leaf) & self->mask;
+      while (self->entries[j].leaf) j = (j + 1) & self->mask;
+      self->entries[j] = old_entries[i];
+    }
+    ts_free(old_entries);
+  }
+
+  uint32_t i = ts_subtree__leaf_hash(leaf) & self->mask;
+  while (self->entries[i].leaf) {
+    if (ts_subtree__leaf_eq(self->entries[i].leaf, leaf)) return &self->entries[i];
+    i = (i + 1) & self->mask;
+  }
+  self->entries[i] = (LeafTableEntry) {.leaf = leaf, .copy = NULL};
+  self->size++;
+  return &self->entries[i];
+}
+
+// Get the number of bytes of heap data that a frozen subtree keeps.
+static inline size_t ts_subtree__frozen_size(uint32_t child_count) {
+  return ts_subtree_arena__align(
+    child_count > 0
+      ? offsetof(SubtreeHeapData, frozen_lookahead_bytes) + sizeof(uint32_t)
+      : offsetof(SubtreeHeapData, ref_count)
+  );
+}
+
+// Allocate a frozen subtree with room for the given number of children from
+// an arena. Unlike other subtrees in an arena, it doesn't retain the arena.
+static SubtreeHeapData *ts_subtree_arena__allocate_frozen_node(SubtreeArena *self, uint32_t child_count) {
+  Subtree *children = ts_subtree_arena__allocate(
+    self,
+    child_count * sizeof(Subtree) + ts_subtree__frozen_size(child_count)
+  );
+  return (SubtreeHeapData *)(children + child_count);
+}
+
+// Copy a subtree and all of its descendants into an arena as frozen
+// subtrees, in preorder, so that they occupy one block of memory with no
+// unused space between them. The subtree may already be frozen.
+//
+// Leaves with identical contents are copied once and shared. This doesn't
+// affect the leaves' nodes, whose ids are the addresses of the leaves'
+// positions within their parents.
+//
+// A parent node's dynamic precedence can't be recomputed from its children,
+// because the parser adds the precedence of the rule that produced it. So
+// parents whose dynamic precedence isn't zero are marked as fragile, which
+// prevents the parser from reusing them once they are thawed.
+Subtree ts_subtree_freeze(Subtree self, SubtreeArena *arena) {
+  if (self.data.is_inline) return self;
+
+  // Measure the subtrees first, so that the arena can allocate a block of
+  // exactly the right size.
+  Array(Subtree *) stack = array_new();
+  LeafTable leaves = {.entries = NULL, .size = 0, .mask = 0};
+  size_t size = 0;
+  array_push(&stack, &self);
+  while (stack.size > 0) {
+    Subtree tree = *array_pop(&stack);
+    uint32_t child_count = tree.ptr->child_count;
+    if (child_count == 0) {
+      uint32_t leaf_count = leaves.size;
+      ts_subtree__leaf_table_find(&leaves, tree.ptr);
+      if (leaves.size == leaf_count) continue;
+      const ExternalScannerState *state = &tree.ptr->external_scanner_state;
+      if (tree.ptr->has_external_tokens && state->length > sizeof(state->short_data)) {
+        size += ts_subtree_arena__align(state->length);
+      }
+    }
+    size += ts_subtree_arena__align(child_count * sizeof(Subtree) + ts_subtree__frozen_size(child_count));
+    Subtree *children = ts_subtree_children(tree);
+    for (uint32_t i = 0; i < child_count; i++) {
+      if (!children[i].data.is_inline) array_push(&stack, &children[i]);
+    }
+  }
+  if ((size_t)(arena->end - arena->next) < size) {
+    ts_subtree_arena__add_slab(arena, sizeof(SubtreeArenaSlab) + size);
   }
+
+  // Copy each subtree before its children, and then replace the children
+  // in the copy with copies of their own.
+  Subtree result = self;
+  array_push(&stack, &result);
+  while (stack.size > 0) {
+    Subtree *slot = array_pop(&stack);
+    Subtree tree = *slot;
+    uint32_t child_count = tree.ptr->child_count;
+
+    LeafTableEntry *entry = NULL;
+    if (child_count == 0) {
+      entry = ts_subtree__leaf_table_find(&leaves, tree.ptr);
+      if (entry->copy) {
+        *slot = (Subtree) {.ptr = entry->copy};
+        continue;
+      }
+    }
+
+    SubtreeHeapData *copy = ts_subtree_arena__allocate_frozen_node(arena, child_count);
+    Subtree *children = (Subtree *)copy - child_count;
+    memcpy(children, (Subtree *)tree.ptr - child_count, child_count * sizeof(Subtree));
+    memcpy(copy, tree.ptr, ts_subtree__frozen_size(child_count));
+    if (!tree.ptr->is_frozen) {
+      copy->is_frozen = true;
+      copy->has_error = ts_subtree_error_cost(tree) > 0;
+      if (child_count > 0) {
+        copy->frozen_parse_state = tree.ptr->parse_state;
+        copy->frozen_lookahead_bytes = tree.ptr->lookahead_bytes;
+        if (tree.ptr->dynamic_precedence != 0) copy->fragile_left = copy->fragile_right = true;
+      }
+    }
+    copy->is_arena_allocated = false;
+    copy->is_private = false;
+    if (child_count == 0 && tree.ptr->has_external_tokens) {
+      copy->external_scanner_state = ts_external_scanner_state_copy(
+        &tree.ptr->external_scanner_state,
+        arena
+      );
+    }
+    if (entry) entry->copy = copy;
+    *slot = (Subtree) {.ptr = copy};
+    for (uint32_t i = child_count; i > 0; i--) {
+      if (!children[i - 1].data.is_inline) array_push(&stack, &children[i - 1]);
+    }
+  }
+  array_delete(&stack);
+  ts_free(leaves.entries);
+  return result;
+}
+
+// Allocate a subtree with room for the given number of children from a pool.
+static SubtreeHeapData *ts_subtree_pool__allocate_node(SubtreePool *self, uint32_t child_count) {
+  if (child_count == 0) return ts_subtree_pool_allocate(self);
+  self->allocation_count++;
+  if (self->arena) return ts_subtree_arena__allocate_node(self->arena, child_count);
+  Subtree *children = ts_malloc(ts_subtree_alloc_size(child_count));
+  return (SubtreeHeapData *)(children + child_count);
+}
+
+// Compute the error cost of a frozen subtree in the same way that
+// `ts_subtree_summarize_children` does, descending only into the children
+// that contain errors.
+uint32_t ts_subtree_frozen_error_cost(Subtree self) {
+  uint32_t result = 0;
+  SubtreeArray stack = array_new();
+  array_push(&stack, self);
+  while (stack.size > 0) {
+    Subtree tree = array_pop(&stack);
+    if (ts_subtree_missing(tree)) {
+      result += ERROR_COST_PER_MISSING_TREE + ERROR_COST_PER_RECOVERY;
+      continue;
+    }
+    if (!ts_subtree_has_error(tree) || tree.ptr->child_count == 0) continue;
+
+    bool is_error = tree.ptr->symbol == ts_builtin_sym_error || tree.ptr->symbol == ts_builtin_sym_error_repeat;
+    Subtree *children = ts_subtree_children(tree);
+    for (uint32_t i = 0; i < tree.ptr->child_count; i++) {
+      Subtree child = children[i];
+      uint32_t grandchild_count = ts_subtree_child_count(child);
+      if (is_error && !ts_subtree_extra(child) && !(ts_subtree_is_error(child) && grandchild_count == 0)) {
+        if (ts_subtree_visible(child)) {
+          result += ERROR_COST_PER_SKIPPED_TREE;
+        } else if (grandchild_count > 0) {
+          result += ERROR_COST_PER_SKIPPED_TREE * child.ptr->visible_child_count;
+        }
+      }
+      if (ts_subtree_symbol(child) != ts_builtin_sym_error_repeat) array_push(&stack, child);
+    }
+    if (is_error) {
+      result +=
+        ERROR_COST_PER_RECOVERY +
+        ERROR_COST_PER_SKIPPED_CHAR * tree.ptr->size.bytes +
+        ERROR_COST_PER_SKIPPED_LINE * tree.ptr->size.extent.row;
+    }
+  }
+  array_delete(&stack);
+  return result;
+}
+
+// Copy a frozen subtree into an ordinary subtree that is allocated from the
+// given pool, so that it can be modified. Its children are shared with the
+// frozen subtree, so only the path to a modified descendant is copied. The
+// fields that frozen subtrees don't store are derived in the same way as by
+// their accessors.
+static MutableSubtree ts_subtree__thaw(SubtreePool *pool, Subtree self) {
+  uint32_t child_count = self.ptr->child_count;
+  SubtreeHeapData *result = ts_subtree_pool__allocate_node(pool, child_count);
+  memcpy((Subtree *)result - child_count, (Subtree *)self.ptr - child_count, child_count * sizeof(Subtree));
+  memcpy(result, self.ptr, ts_subtree__frozen_size(child_count));
   result->ref_count = 1;
+  result->error_cost = 0;
+  result->is_arena_allocated = pool->arena != NULL;
+  result->is_frozen = false;
+  result->has_error = false;
+  result->is_private = pool->is_private;
+  if (child_count == 0) {
+    if (self.ptr->has_external_tokens) {
+      const ExternalScannerState *state = &self.ptr->external_scanner_state;
+      ts_external_scanner_state_init(
+        &result->external_scanner_state,
+        pool,
+        ts_external_scanner_state_data(state),
+        state->length
+      );
+    }
+  } else {
+    result->error_cost = ts_subtree_error_cost(self);
+    result->parse_state = self.ptr->frozen_parse_state;
+    result->lookahead_bytes = self.ptr->frozen_lookahead_bytes;
+    result->first_leaf.symbol = ts_subtree_leaf_symbol(self);
+    result->first_leaf.parse_state = ts_subtree_leaf_parse_state(self);
+    result->repeat_depth = 0;
+    result->dynamic_precedence = 0;
+  }
   return (MutableSubtree) {.ptr = result};
 }
 
+// Write a subtree and its descendants into a new buffer, in the layout that
+// `ts_subtree_freeze` produces, but with each pointer replaced by the offset
+// of its target within the block of nodes. The block is preceded by the given
+// number of bytes, which are left for the caller to fill in.
+char *ts_subtree_serialize(Subtree self, size_t header_size, size_t *length, Subtree *root) {
+  SubtreeArena *arena = ts_subtree_arena_new(NULL);
+  Subtree copy = ts_subtree_freeze(self, arena);
+  const char *block = arena->slabs ? (const char *)arena->slabs + sizeof(SubtreeArenaSlab) : NULL;
+  size_t block_size = block ? (size_t)(arena->next - block) : 0;
+  *length = header_size + block_size;
+  char *result = ts_malloc(*length);
+  char *dest = result + header_size;
+  if (block_size > 0) memcpy(dest, block, block_size);
+
+  *root = copy;
+  if (!copy.data.is_inline) {
+    root->ptr = (const SubtreeHeapData *)(uintptr_t)((const char *)copy.ptr - block);
+    SubtreeArray stack = array_new();
+    array_push(&stack, copy);
+    while (stack.size > 0) {
+      Subtree tree = array_pop(&stack);
+      uint32_t child_count = tree.ptr->child_count;
+      SubtreeHeapData *node = (SubtreeHeapData *)(dest + ((const char *)tree.ptr - block));
+      Subtree *children = (Subtree *)node - child_count;
+      if (child_count == 0) {
+        const ExternalScannerState *state = &tree.ptr->external_scanner_state;
+        if (tree.ptr->has_external_tokens && state->length > sizeof(state->short_data)) {
+          node->external_scanner_state.long_data = (char *)(uintptr_t)(state->long_data - block);
+        }
+      }
+      for (uint32_t i = 0; i < child_count; i++) {
+        Subtree child = ts_subtree_children(tree)[i];
+        if (child.data.is_inline) continue;
+        children[i].ptr = (const SubtreeHeapData *)(uintptr_t)((const char *)child.ptr - block);
+        array_push(&stack, child);
+      }
+    }
+    array_delete(&stack);
+  }
+
+  ts_subtree_arena_delete(arena);
+  return result;
+}
+
+static inline bool ts_subtree__is_valid_symbol(const TSLanguage *language, TSSymbol symbol) {
+  return
+    symbol < language->symbol_count ||
+    symbol == ts_builtin_sym_error ||
+    symbol == ts_builtin_sym_error_repeat;
+}
+
+static inline bool ts_subtree__is_valid_state(const TSLanguage *language, TSStateId state) {
+  return state < language->state_count || state == TS_TREE_STATE_NONE;
+}
+
+// Check the fields of a serialized subtree that are used to index into the
+// language's tables.
+static bool ts_subtree__is_valid(const TSLanguage *language, Subtree self) {
+  if (self.data.is_inline) {
+    return
+      self.data.symbol < language->symbol_count &&
+      ts_subtree__is_valid_state(language, self.data.parse_state);
+  }
+  if (
+    !ts_subtree__is_valid_symbol(language, self.ptr->symbol) ||
+    !ts_subtree__is_valid_state(language, ts_subtree_parse_state(self))
+  ) return false;
+  if (self.ptr->child_count > 0) {
+    return self.ptr->production_id == 0 || self.ptr->production_id < language->production_id_count;
+  }
+  return
+    !self.ptr->has_external_tokens ||
+    self.ptr->external_scanner_state.length <= TREE_SITTER_SERIALIZATION_BUFFER_SIZE;
+}
+
+typedef Array(size_t) OffsetArray;
+
+static bool ts_subtree__contains_offset(const OffsetArray *offsets, size_t offset) {
+  uint32_t start = 0, end = offsets->size;
+  while (start < end) {
+    uint32_t mid = start + (end - start) / 2;
+    if (offsets->contents[mid] < offset) {
+      start = mid + 1;
+    } else if (offsets->contents[mid] > offset) {
+      end = mid;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Read a subtree that was written by `ts_subtree_serialize` into an empty
+// arena. The block of nodes is copied all at once, and then each offset is
+// replaced with a pointer.
+//
+// The nodes are checked as they are visited: each new node must begin where
+// the previous one ended, in preorder, and only leaves can be referred to more
+// than once. Returns false if the block is not consistent with this, or with
+// the language.
+bool ts_subtree_deserialize(
+  const char *block,
+  size_t size,
+  Subtree root,
+  const TSLanguage *language,
+  SubtreeArena *arena,
+  Subtree *result
+) {
+  *result = root;
+  if (root.data.is_inline) return size == 0 && ts_subtree__is_valid(language, root);
+  if (size == 0) return false;
+
+  ts_subtree_arena__add_slab(arena, sizeof(SubtreeArenaSlab) + ts_subtree_arena__align(size));
+  char *base = arena->next;
+  memcpy(base, block, size);
+  arena->next += ts_subtree_arena__align(size);
+
+  Array(Subtree *) stack = array_new();
+  OffsetArray leaf_offsets = array_new();
+  size_t end = 0;
+  bool is_valid = true;
+  array_push(&stack, result);
+  while (stack.size > 0) {
+    Subtree *slot = array_pop(&stack);
+    if (slot->data.is_inline) {
+      if (!ts_subtree__is_valid(language, *slot)) {
+        is_valid = false;
+        break;
+      }
+      continue;
+    }
+
+    // A leaf that has already been visited.
+    size_t offset = (uintptr_t)slot->ptr;
+    if (offset < end) {
+      if (!ts_subtree__contains_offset(&leaf_offsets, offset)) {
+        is_valid = false;
+        break;
+      }
+      slot->ptr = (SubtreeHeapData *)(base + offset);
+      continue;
+    }
+
+    // A new node, which must immediately follow the previous one. Parent
+    // nodes are smaller than leaves, so that much of the node can be read
+    // before knowing which kind it is.
+    if (
+      offset % TS_ARENA_ALIGNMENT != 0 ||
+      offset > size ||
+      size - offset < ts_subtree__frozen_size(1)
+    ) {
+      is_valid = false;
+      break;
+    }
+    SubtreeHeapData *node = (SubtreeHeapData *)(base + offset);
+    uint32_t child_count = node->child_count;
+    if (
+      size - offset < ts_subtree__frozen_size(child_count) ||
+      offset - end != (size_t)child_count * sizeof(Subtree) ||
+      !node->is_frozen ||
+      !ts_subtree__is_valid(language, (Subtree) {.ptr = node})
+    ) {
+      is_valid = false;
+      break;
+    }
+    end += ts_subtree_arena__align(child_count * sizeof(Subtree) + ts_subtree__frozen_size(child_count));
+
+    Subtree *children = (Subtree *)node - child_count;
+    if (child_count == 0) {
+      ExternalScannerState *state = &node->external_scanner_state;
+      if (node->has_external_tokens && state->length > sizeof(state->short_data)) {
+        if ((uintptr_t)state->long_data != end || size - end < state->length) {
+          is_valid = false;
+          break;
+        }
+        state->long_data = base + end;
+        end += ts_subtree_arena__align(state->length);
+      }
+      if (node->has_external_tokens) {
+        state->hash = ts_external_scanner_state__hash(ts_external_scanner_state_data(state), state->length);
+      }
+      array_push(&leaf_offsets, offset);
+    } else {
+      for (uint32_t i = child_count; i > 0; i--) {
+        array_push(&stack, &children[i - 1]);
+      }
+    }
+
+    node->is_arena_allocated = false;
+    node->is_private = false;
+    slot->ptr = node;
+  }
+
+  array_delete(&stack);
+  array_delete(&leaf_offsets);
+  return is_valid && end == size;
+}
+
 // Get mutable version of a subtree.
 //
 // This takes ownership of the subtree. If the subtree has only one owner,
@@ -283,8 +1117,9 @@ MutableSubtree ts_subtree_clone(Subtree self) {
 // perform a copy.
 MutableSubtree ts_subtree_make_mut(SubtreePool *pool, Subtree self) {
   if (self.data.is_inline) return (MutableSubtree) {self.data};
+  if (self.ptr->is_frozen) return ts_subtree__thaw(pool, self);
   if (self.ptr->ref_count == 1) return ts_subtree_to_mut_unsafe(self);
-  MutableSubtree result = ts_subtree_clone(self);
+  MutableSubtree result = ts_subtree_clone(pool, self);
   ts_subtree_release(pool, self);
   return result;
 }
@@ -305,6 +1140,7 @@ static void ts_subtree__compress(
     MutableSubtree child = ts_subtree_to_mut_unsafe(ts_subtree_children(tree)[0]);
     if (
       child.data.is_inline ||
+      child.ptr->is_frozen ||
       child.ptr->child_count < 2 ||
       child.ptr->ref_count > 1 ||
       child.ptr->symbol != symbol
@@ -313,6 +1149,7 @@ static void ts_subtree__compress(
     MutableSubtree grandchild = ts_subtree_to_mut_unsafe(ts_subtree_children(child)[0]);
     if (
       grandchild.data.is_inline ||
+      grandchild.ptr->is_frozen ||
       grandchild.ptr->child_count < 2 ||
       grandchild.ptr->ref_count > 1 ||
       grandchild.ptr->symbol != symbol
@@ -335,17 +1172,25 @@ static void ts_subtree__compress(
   }
 }
 
+// Balance the repetitions within a tree that the parser has finished, and
+// mark the tree's private subtrees as public. Both only need to visit the
+// subtrees that were created during the parse, so they are done together.
+//
+// Subtrees with a single owner can be modified in place, so they can gain
+// private children even if they are public. The descendants of other public
+// subtrees are left alone.
 void ts_subtree_balance(Subtree self, SubtreePool *pool, const TSLanguage *language) {
   array_clear(&pool->tree_stack);
 
-  if (ts_subtree_child_count(self) > 0 && self.ptr->ref_count == 1) {
+  if (!self.data.is_inline && !self.ptr->is_frozen && (self.ptr->is_private || self.ptr->ref_count == 1)) {
     array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(self));
   }
 
   while (pool->tree_stack.size > 0) {
     MutableSubtree tree = array_pop(&pool->tree_stack);
-
-    if (tree.ptr->repeat_depth > 0) {
+    if (tree.ptr->is_private) tree.ptr->is_private = false;
+    if (tree.ptr->child_count == 0) continue;
+    if (tree.ptr->repeat_depth > 0 && tree.ptr->ref_count == 1) {
       Subtree child1 = ts_subtree_children(tree)[0];
       Subtree child2 = ts_subtree_children(tree)[tree.ptr->child_count - 1];
       long repeat_delta = (long)ts_subtree_repeat_depth(child1) - (long)ts_subtree_repeat_depth(child2);
@@ -360,7 +1205,10 @@ void ts_subtree_balance(Subtree self, SubtreePool *pool, const TSLanguage *langu
 
     for (uint32_t i = 0; i < tree.ptr->child_count; i++) {
       Subtree child = ts_subtree_children(tree)[i];
-      if (ts_subtree_child_count(child) > 0 && child.ptr->ref_count == 1) {
+      if (child.data.is_inline || child.ptr->is_frozen) continue;
+      if (child.ptr->child_count == 0) {
+        if (child.ptr->is_private) ((SubtreeHeapData *)child.ptr)->is_private = false;
+      } else if (child.ptr->is_private || child.ptr->ref_count == 1) {
         array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(child));
       }
     }
@@ -379,6 +1227,7 @@ void ts_subtree_summarize_children(
   self.ptr->error_cost = 0;
   self.ptr->repeat_depth = 0;
   self.ptr->node_count = 1;
+  self.ptr->visible_descendant_count = 0;
   self.ptr->has_external_tokens = false;
   self.ptr->depends_on_column = false;
   self.ptr->dynamic_precedence = 0;
@@ -428,13 +1277,16 @@ void ts_subtree_summarize_children(
 
     self.ptr->dynamic_precedence += ts_subtree_dynamic_precedence(child);
     self.ptr->node_count += ts_subtree_node_count(child);
+    self.ptr->visible_descendant_count += ts_subtree_visible_descendant_count(child);
 
     if (alias_sequence && alias_sequence[structural_index] != 0 && !ts_subtree_extra(child)) {
+      self.ptr->visible_descendant_count++;
       self.ptr->visible_child_count++;
       if (ts_language_symbol_metadata(language, alias_sequence[structural_index]).named) {
         self.ptr->named_child_count++;
       }
     } else if (ts_subtree_visible(child)) {
+      self.ptr->visible_descendant_count++;
       self.ptr->visible_child_count++;
       if (ts_subtree_named(child)) self.ptr->named_child_count++;
     } else if (grandchild_count > 0) {
@@ -488,8 +1340,11 @@ void ts_subtree_summarize_children(
 
 // Create a new parent node with the given children.
 //
-// This takes ownership of the children array.
+// This takes ownership of the children array. If the pool has an arena, the
+// node is allocated from the arena and the array is freed. Otherwise, the
+// node's data is allocated at the end of the array.
 MutableSubtree ts_subtree_new_node(
+  SubtreePool *pool,
   TSSymbol symbol,
   SubtreeArray *children,
   unsigned production_id,
@@ -497,25 +1352,39 @@ MutableSubtree ts_subtree_new_node(
 ) {
   TSSymbolMetadata metadata = ts_language_symbol_metadata(language, symbol);
   bool fragile = symbol == ts_builtin_sym_error || symbol == ts_builtin_sym_error_repeat;
-
-  // Allocate the node's data at the end of the array of children.
-  size_t new_byte_size = ts_subtree_alloc_size(children->size);
-  if (children->capacity * sizeof(Subtree) < new_byte_size) {
-    children->contents = ts_realloc(children->contents, new_byte_size);
-    children->capacity = new_byte_size / sizeof(Subtree);
+  uint32_t child_count = children->size;
+  SubtreeArena *arena = pool ? pool->arena : NULL;
+
+  SubtreeHeapData *data;
+  if (pool) pool->allocation_count++;
+  if (arena) {
+    data = ts_subtree_arena__allocate_node(arena, child_count);
+    if (child_count > 0) {
+      memcpy((Subtree *)data - child_count, children->contents, child_count * sizeof(Subtree));
+    }
+    ts_subtree_pool__recycle_array(pool, children);
+  } else {
+    // Allocate the node's data at the end of the array of children.
+    size_t new_byte_size = ts_subtree_alloc_size(child_count);
+    if (children->capacity * sizeof(Subtree) < new_byte_size) {
+      children->contents = ts_realloc(children->contents, new_byte_size);
+      children->capacity = new_byte_size / sizeof(Subtree);
+    }
+    data = (SubtreeHeapData *)&children->contents[child_count];
   }
-  SubtreeHeapData *data = (SubtreeHeapData *)&children->contents[children->size];
 
   *data = (SubtreeHeapData) {
     .ref_count = 1,
     .symbol = symbol,
-    .child_count = children->size,
+    .child_count = child_count,
     .visible = metadata.visible,
     .named = metadata.named,
     .has_changes = false,
     .fragile_left = fragile,
     .fragile_right = fragile,
     .is_keyword = false,
+    .is_arena_allocated = arena != NULL,
+    .is_private = pool && pool->is_private,
     {{
       .node_count = 0,
       .production_id = production_id,
@@ -532,12 +1401,13 @@ MutableSubtree ts_subtree_new_node(
 // This node is treated as 'extra'. Its children are prevented from having
 // having any effect on the parse state.
 Subtree ts_subtree_new_error_node(
+  SubtreePool *pool,
   SubtreeArray *children,
   bool extra,
   const TSLanguage *language
 ) {
   MutableSubtree result = ts_subtree_new_node(
-    ts_builtin_sym_error, children, 0, language
+    pool, ts_builtin_sym_error, children, 0, language
   );
   result.ptr->extra = extra;
   return ts_subtree_from_mut(result);
@@ -565,42 +1435,83 @@ Subtree ts_subtree_new_missing_leaf(
   return result;
 }
 
+static inline uint32_t ts_subtree__dec_ref_count(Subtree self) {
+  volatile uint32_t *ref_count = (volatile uint32_t *)&self.ptr->ref_count;
+  return self.ptr->is_private ? --*ref_count : atomic_dec(ref_count);
+}
+
 void ts_subtree_retain(Subtree self) {
-  if (self.data.is_inline) return;
+  if (self.data.is_inline || self.ptr->is_frozen) return;
   assert(self.ptr->ref_count > 0);
-  atomic_inc((volatile uint32_t *)&self.ptr->ref_count);
+  volatile uint32_t *ref_count = (volatile uint32_t *)&self.ptr->ref_count;
+  if (self.ptr->is_private) {
+    ++*ref_count;
+  } else {
+    atomic_inc(ref_count);
+  }
   assert(self.ptr->ref_count != 0);
 }
 
-void ts_subtree_release(SubtreePool *pool, Subtree self) {
-  if (self.data.is_inline) return;
-  array_clear(&pool->tree_stack);
-
+// Release a subtree. If this was its last reference, the subtree is pushed
+// onto the pool's stack of subtrees to free, but it is not freed yet.
+void ts_subtree_release_deferred(SubtreePool *pool, Subtree self) {
+  if (self.data.is_inline || self.ptr->is_frozen) return;
   assert(self.ptr->ref_count > 0);
-  if (atomic_dec((volatile uint32_t *)&self.ptr->ref_count) == 0) {
+  if (ts_subtree__dec_ref_count(self) == 0) {
     array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(self));
   }
+}
 
-  while (pool->tree_stack.size > 0) {
+void ts_subtree_release(SubtreePool *pool, Subtree self) {
+  if (self.data.is_inline || self.ptr->is_frozen) return;
+  array_clear(&pool->tree_stack);
+  ts_subtree_release_deferred(pool, self);
+  ts_subtree_pool_free_pending(pool, UINT32_MAX);
+}
+
+// Free at most `max_count` of the subtrees on the pool's stack of subtrees to
+// free, releasing their children, and return the number of subtrees that
+// were freed. Children whose last reference is released are pushed onto the
+// stack, so the stack is empty once everything has been freed.
+uint32_t ts_subtree_pool_free_pending(SubtreePool *pool, uint32_t max_count) {
+  uint32_t count = 0;
+  while (pool->tree_stack.size > 0 && count < max_count) {
+    count++;
     MutableSubtree tree = array_pop(&pool->tree_stack);
+    SubtreeArena *arena = ts_subtree_arena(ts_subtree_from_mut(tree));
     if (tree.ptr->child_count > 0) {
       Subtree *children = ts_subtree_children(tree);
       for (uint32_t i = 0; i < tree.ptr->child_count; i++) {
         Subtree child = children[i];
-        if (child.data.is_inline) continue;
+        if (child.data.is_inline || child.ptr->is_frozen) continue;
         assert(child.ptr->ref_count > 0);
-        if (atomic_dec((volatile uint32_t *)&child.ptr->ref_count) == 0) {
+        if (ts_subtree__dec_ref_count(child) == 0) {
           array_push(&pool->tree_stack, ts_subtree_to_mut_unsafe(child));
         }
       }
-      ts_free(children);
-    } else {
+      if (!arena) ts_free(children);
+    } else if (!arena) {
       if (tree.ptr->has_external_tokens) {
         ts_external_scanner_state_delete(&tree.ptr->external_scanner_state);
       }
       ts_subtree_pool_free(pool, tree.ptr);
     }
+    if (!arena) continue;
+    if (arena == pool->arena) {
+      // The pool's arena is private to the pool's parser, and the parser
+      // retains it, so this can't be the last reference. Leaves that are
+      // released while parsing are reused, and keep retaining the arena
+      // until the parser stops allocating from it.
+      if (tree.ptr->child_count == 0) {
+        array_push(&arena->free_trees, tree);
+      } else {
+        arena->ref_count--;
+      }
+    } else {
+      ts_subtree_arena_release(arena);
+    }
   }
+  return count;
 }
 
 bool ts_subtree_eq(Subtree self, Subtree other) {
@@ -659,7 +1570,100 @@ static inline void ts_subtree_set_has_changes(MutableSubtree *self) {
   }
 }
 
-Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool) {
+// Update the padding and size of a mutable subtree. Inline leaves whose new
+// extent no longer fits in the inline representation are moved to the heap.
+static void ts_subtree__set_extent(
+  MutableSubtree *self,
+  Length padding,
+  Length size,
+  SubtreePool *pool
+) {
+  if (self->data.is_inline) {
+    uint32_t lookahead_bytes = ts_subtree_lookahead_bytes(ts_subtree_from_mut(*self));
+    if (ts_subtree_can_inline(padding, size, lookahead_bytes)) {
+      ts_subtree__set_inline_extent(&self->data, padding, size, lookahead_bytes);
+    } else {
+      SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
+      data->ref_count = 1;
+      data->padding = padding;
+      data->size = size;
+      data->lookahead_bytes = lookahead_bytes;
+      data->error_cost = 0;
+      data->child_count = 0;
+      data->symbol = self->data.symbol;
+      data->parse_state = self->data.parse_state;
+      data->visible = self->data.visible;
+      data->named = self->data.named;
+      data->extra = self->data.extra;
+      data->fragile_left = false;
+      data->fragile_right = false;
+      data->has_changes = self->data.has_changes;
+      data->has_external_tokens = false;
+      data->depends_on_column = false;
+      data->is_missing = self->data.is_missing;
+      data->is_keyword = self->data.is_keyword;
+      data->is_arena_allocated = pool->arena != NULL;
+      data->is_frozen = false;
+      data->has_error = false;
+      data->is_private = pool->is_private;
+      self->ptr = data;
+    }
+  } else {
+    self->ptr->padding = padding;
+    self->ptr->size = size;
+  }
+}
+
+// Compute the extent of a subtree after an edit in its coordinate space.
+// Returns false if the edit doesn't reach the subtree, in which case the
+// extent is unchanged.
+static inline bool ts_subtree__edit_extent(
+  Length *padding,
+  Length *size,
+  uint32_t lookahead_bytes,
+  const Edit *edit
+) {
+  bool is_noop = edit->old_end.bytes == edit->start.bytes && edit->new_end.bytes == edit->start.bytes;
+  bool is_pure_insertion = edit->old_end.bytes == edit->start.bytes;
+
+  uint32_t end_byte = padding->bytes + size->bytes + lookahead_bytes;
+  if (edit->start.bytes > end_byte || (is_noop && edit->start.bytes == end_byte)) return false;
+
+  // If the edit is entirely within the space before this subtree, then shift this
+  // subtree over according to the edit without changing its size.
+  if (edit->old_end.bytes <= padding->bytes) {
+    *padding = length_add(edit->new_end, length_sub(*padding, edit->old_end));
+  }
+
+  // If the edit starts in the space before this subtree and extends into this subtree,
+  // shrink the subtree's content to compensate for the change in the space before it.
+  else if (edit->start.bytes < padding->bytes) {
+    *size = length_sub(*size, length_sub(edit->old_end, *padding));
+    *padding = edit->new_end;
+  }
+
+  // If the edit is a pure insertion right at the start of the subtree,
+  // shift the subtree over according to the insertion.
+  else if (edit->start.bytes == padding->bytes && is_pure_insertion) {
+    *padding = edit->new_end;
+  }
+
+  // If the edit is within this subtree, resize the subtree to reflect the edit->
+  else {
+    uint32_t total_bytes = padding->bytes + size->bytes;
+    if (edit->start.bytes < total_bytes ||
+       (edit->start.bytes == total_bytes && is_pure_insertion)) {
+      *size = length_add(
+        length_sub(edit->new_end, *padding),
+        length_sub(*size, length_sub(edit->old_end, *padding))
+      );
+    }
+  }
+
+  return true;
+}
+
+static Subtree ts_subtree__edit(Subtree self, Edit edit, SubtreePool *pool) {
   typedef struct {
     Subtree *tree;
     Edit edit;
@@ -668,91 +1672,22 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
   Array(StackEntry) stack = array_new();
   array_push(&stack, ((StackEntry) {
     .tree = &self,
-    .edit = (Edit) {
-      .start = {edit->start_byte, edit->start_point},
-      .old_end = {edit->old_end_byte, edit->old_end_point},
-      .new_end = {edit->new_end_byte, edit->new_end_point},
-    },
+    .edit = edit,
   }));
 
   while (stack.size) {
     StackEntry entry = array_pop(&stack);
     Edit edit = entry.edit;
-    bool is_noop = edit.old_end.bytes == edit.start.bytes && edit.new_end.bytes == edit.start.bytes;
     bool is_pure_insertion = edit.old_end.bytes == edit.start.bytes;
     bool invalidate_first_row = ts_subtree_depends_on_column(*entry.tree);
 
     Length size = ts_subtree_size(*entry.tree);
     Length padding = ts_subtree_padding(*entry.tree);
     uint32_t lookahead_bytes = ts_subtree_lookahead_bytes(*entry.tree);
-    uint32_t end_byte = padding.bytes + size.bytes + lookahead_bytes;
-    if (edit.start.bytes > end_byte || (is_noop && edit.start.bytes == end_byte)) continue;
-
-    // If the edit is entirely within the space before this subtree, then shift this
-    // subtree over according to the edit without changing its size.
-    if (edit.old_end.bytes <= padding.bytes) {
-      padding = length_add(edit.new_end, length_sub(padding, edit.old_end));
-    }
-
-    // If the edit starts in the space before this subtree and extends into this subtree,
-    // shrink the subtree's content to compensate for the change in the space before it.
-    else if (edit.start.bytes < padding.bytes) {
-      size = length_sub(size, length_sub(edit.old_end, padding));
-      padding = edit.new_end;
-    }
-
-    // If the edit is a pure insertion right at the start of the subtree,
-    // shift the subtree over according to the insertion.
-    else if (edit.start.bytes == padding.bytes && is_pure_insertion) {
-      padding = edit.new_end;
-    }
-
-    // If the edit is within this subtree, resize the subtree to reflect the edit.
-    else {
-      uint32_t total_bytes = padding.bytes + size.bytes;
-      if (edit.start.bytes < total_bytes ||
-         (edit.start.bytes == total_bytes && is_pure_insertion)) {
-        size = length_add(
-          length_sub(edit.new_end, padding),
-          length_sub(size, length_sub(edit.old_end, padding))
-        );
-      }
-    }
+    if (!ts_subtree__edit_extent(&padding, &size, lookahead_bytes, &edit)) continue;
 
     MutableSubtree result = ts_subtree_make_mut(pool, *entry.tree);
-
-    if (result.data.is_inline) {
-      if (ts_subtree_can_inline(padding, size, lookahead_bytes)) {
-        result.data.padding_bytes = padding.bytes;
-        result.data.padding_rows = padding.extent.row;
-        result.data.padding_columns = padding.extent.column;
-        result.data.size_bytes = size.bytes;
-      } else {
-        SubtreeHeapData *data = ts_subtree_pool_allocate(pool);
-        data->ref_count = 1;
-        data->padding = padding;
-        data->size = size;
-        data->lookahead_bytes = lookahead_bytes;
-        data->error_cost = 0;
-        data->child_count = 0;
-        data->symbol = result.data.symbol;
-        data->parse_state = result.data.parse_state;
-        data->visible = result.data.visible;
-        data->named = result.data.named;
-        data->extra = result.data.extra;
-        data->fragile_left = false;
-        data->fragile_right = false;
-        data->has_changes = false;
-        data->has_external_tokens = false;
-        data->depends_on_column = false;
-        data->is_missing = result.data.is_missing;
-        data->is_keyword = result.data.is_keyword;
-        result.ptr = data;
-      }
-    } else {
-      result.ptr->padding = padding;
-      result.ptr->size = size;
-    }
+    ts_subtree__set_extent(&result, padding, size, pool);
 
     ts_subtree_set_has_changes(&result);
     *entry.tree = ts_subtree_from_mut(result);
@@ -821,6 +1756,230 @@ Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool
   return self;
 }
 
+Subtree ts_subtree_edit(Subtree self, const TSInputEdit *edit, SubtreePool *pool) {
+  return ts_subtree__edit(self, (Edit) {
+    .start = {edit->start_byte, edit->start_point},
+    .old_end = {edit->old_end_byte, edit->old_end_point},
+    .new_end = {edit->new_end_byte, edit->new_end_point},
+  }, pool);
+}
+
+// Apply a sequence of edits to a subtree, with the same result as applying
+// them one at a time with `ts_subtree_edit`. The edits must be sorted, and
+// must not overlap: each edit must start at or after the point where the
+// previous edit's new text ends.
+//
+// Each subtree is visited once. A subtree's parent computes the subtree's
+// extent after each of the edits that reach it, and then the subtree is
+// copied once, resized, and its edits are passed down to its children
+// together, in order. Once only a single edit reaches a subtree, the rest
+// of the traversal is the same as for `ts_subtree_edit`.
+Subtree ts_subtree_edit_batch(
+  Subtree self,
+  const TSInputEdit *edits,
+  uint32_t edit_count,
+  SubtreePool *pool
+) {
+  if (edit_count == 1) return ts_subtree_edit(self, edits, pool);
+
+  // An edit that reaches a subtree, along with the row of the subtree's
+  // padding just after the edit, and the edit's progress through the
+  // subtree's children.
+  typedef struct {
+    Edit edit;
+    Length child_left;
+    uint32_t padding_row;
+    bool is_done;
+  } PendingEdit;
+
+  // A subtree, along with its extent after all of its edits, and the range
+  // of its edits in the array of pending edits.
+  typedef struct {
+    Subtree *tree;
+    Length padding;
+    Length size;
+    uint32_t edit_index;
+    uint32_t edit_count;
+  } StackEntry;
+
+  Array(StackEntry) stack = array_new();
+  Array(PendingEdit) pending = array_new();
+
+  Length padding = ts_subtree_padding(self);
+  Length size = ts_subtree_size(self);
+  uint32_t lookahead_bytes = ts_subtree_lookahead_bytes(self);
+  for (uint32_t i = 0; i < edit_count; i++) {
+    Edit edit = {
+      .start = {edits[i].start_byte, edits[i].start_point},
+      .old_end = {edits[i].old_end_byte, edits[i].old_end_point},
+      .new_end = {edits[i].new_end_byte, edits[i].new_end_point},
+    };
+    if (ts_subtree__edit_extent(&padding, &size, lookahead_bytes, &edit)) {
+      array_push(&pending, ((PendingEdit) {
+        .edit = edit,
+        .child_left = length_zero(),
+        .padding_row = padding.extent.row,
+        .is_done = false,
+      }));
+    }
+  }
+  if (pending.size > 0) {
+    array_push(&stack, ((StackEntry) {
+      .tree = &self,
+      .padding = padding,
+      .size = size,
+      .edit_index = 0,
+      .edit_count = pending.size,
+    }));
+  }
+
+  while (stack.size) {
+    StackEntry entry = array_pop(&stack);
+    MutableSubtree result = ts_subtree_make_mut(pool, *entry.tree);
+    ts_subtree__set_extent(&result, entry.padding, entry.size, pool);
+    ts_subtree_set_has_changes(&result);
+    *entry.tree = ts_subtree_from_mut(result);
+    Subtree tree = *entry.tree;
+
+    // The pending edits after this subtree's edits belong to subtrees that
+    // have already been processed. The edits for this subtree's children
+    // are added in their place.
+    uint32_t edit_end = entry.edit_index + entry.edit_count;
+    pending.size = edit_end;
+
+    // The edits before `first_active` are done with this subtree's children.
+    // The edits starting at `first_unstarted` have not reached any child yet.
+    // Because the edits are sorted, once one of them doesn't reach a child,
+    // none of the later ones do either.
+    bool invalidate_first_row = ts_subtree_depends_on_column(tree);
+    uint32_t first_active = entry.edit_index;
+    uint32_t first_unstarted = entry.edit_index;
+    Length unstarted_child_left = length_zero();
+    for (uint32_t i = 0, n = ts_subtree_child_count(tree); i < n && first_active < edit_end; i++) {
+      Subtree *child = &ts_subtree_children(tree)[i];
+      Length child_padding = ts_subtree_padding(*child);
+      Length child_size = ts_subtree_size(*child);
+      Length child_total_size = length_add(child_padding, child_size);
+      uint32_t child_lookahead_bytes = ts_subtree_lookahead_bytes(*child);
+      uint32_t child_edit_index = pending.size;
+
+      for (uint32_t j = first_active; j < edit_end; j++) {
+        PendingEdit *pending_edit = &pending.contents[j];
+        const Edit *edit = &pending_edit->edit;
+
+        if (j >= first_unstarted) {
+          Length child_right = length_add(unstarted_child_left, child_total_size);
+          if (child_right.bytes + child_lookahead_bytes < edit->start.bytes) break;
+          pending_edit->child_left = unstarted_child_left;
+          first_unstarted = j + 1;
+        }
+        if (pending_edit->is_done) continue;
+
+        Length child_left = pending_edit->child_left;
+        Length child_right = length_add(child_left, child_total_size);
+        pending_edit->child_left = child_right;
+
+        // If this child ends before the edit, it is not affected.
+        if (child_right.bytes + child_lookahead_bytes < edit->start.bytes) continue;
+
+        // Keep editing child nodes until a node is reached that starts after the edit.
+        // Also, if this node's validity depends on its column position, then continue
+        // invaliditing child nodes until reaching a line break.
+        if ((
+          (child_left.bytes > edit->old_end.bytes) ||
+          (child_left.bytes == edit->old_end.bytes && child_total_size.bytes > 0 && i > 0)
+        ) && (
+          !invalidate_first_row ||
+          child_left.extent.row > pending_edit->padding_row
+        )) {
+          pending_edit->is_done = true;
+          continue;
+        }
+
+        // Transform edit into the child's coordinate space.
+        Edit child_edit = {
+          .start = length_sub(edit->start, child_left),
+          .old_end = length_sub(edit->old_end, child_left),
+          .new_end = length_sub(edit->new_end, child_left),
+        };
+
+        // Clamp child_edit to the child's bounds.
+        if (edit->start.bytes < child_left.bytes) child_edit.start = length_zero();
+        if (edit->old_end.bytes < child_left.bytes) child_edit.old_end = length_zero();
+        if (edit->new_end.bytes < child_left.bytes) child_edit.new_end = length_zero();
+        if (edit->old_end.bytes > child_right.bytes) child_edit.old_end = child_total_size;
+
+        // Interpret all inserted text as applying to the *first* child that touches the edit.
+        // Subsequent children are only never have any text inserted into them; they are only
+        // shrunk to compensate for the edit.
+        bool is_pure_insertion = edit->old_end.bytes == edit->start.bytes;
+        if (
+          child_right.bytes > edit->start.bytes ||
+          (child_right.bytes == edit->start.bytes && is_pure_insertion)
+        ) {
+          pending_edit->edit.new_end = edit->start;
+        }
+
+        // Children that occur before the edit are not reshaped by the edit.
+        else {
+          child_edit.old_end = child_edit.start;
+          child_edit.new_end = child_edit.start;
+        }
+
+        if (ts_subtree__edit_extent(&child_padding, &child_size, child_lookahead_bytes, &child_edit)) {
+          child_total_size = length_add(child_padding, child_size);
+          array_push(&pending, ((PendingEdit) {
+            .edit = child_edit,
+            .child_left = length_zero(),
+            .padding_row = child_padding.extent.row,
+            .is_done = false,
+          }));
+        }
+      }
+
+      unstarted_child_left = length_add(unstarted_child_left, child_total_size);
+      while (first_active < first_unstarted && pending.contents[first_active].is_done) {
+        first_active++;
+      }
+
+      // Queue processing of this child's subtree, or edit it right away if
+      // only one edit reaches it.
+      if (pending.size == child_edit_index + 1) {
+        *child = ts_subtree__edit(*child, array_pop(&pending).edit, pool);
+      } else if (pending.size > child_edit_index) {
+        array_push(&stack, ((StackEntry) {
+          .tree = child,
+          .padding = child_padding,
+          .size = child_size,
+          .edit_index = child_edit_index,
+          .edit_count = pending.size - child_edit_index,
+        }));
+      }
+    }
+  }
+
+  array_delete(&stack);
+  array_delete(&pending);
+  return self;
+}
+
+Subtree ts_subtree_prepend_padding(Subtree self, Length padding, SubtreePool *pool) {
+  Subtree *tree = &self;
+  for (;;) {
+    MutableSubtree result = ts_subtree_make_mut(pool, *tree);
+    ts_subtree__set_extent(
+      &result,
+      length_add(padding, ts_subtree_padding(*tree)),
+      ts_subtree_size(*tree),
+      pool
+    );
+    *tree = ts_subtree_from_mut(result);
+    if (ts_subtree_child_count(*tree) == 0) break;
+    tree = &ts_subtree_children(*tree)[0];
+  }
+  return self;
+}
+
 Subtree ts_subtree_last_external_token(Subtree tree) {
   if (!ts_subtree_has_external_tokens(tree)) return NULL_SUBTREE;
   while (tree.ptr->child_count > 0) {
@@ -1002,20 +2161,28 @@ void ts_subtree__print_dot_graph(const Subtree *self, uint32_t start_offset,
   fprintf(f, ", tooltip=\""
     "range: %u - %u\n"
     "state: %d\n"
-    "error-cost: %u\n"
     "has-changes: %u\n"
-    "depends-on-column: %u\n"
-    "repeat-depth: %u\n"
-    "lookahead-bytes: %u",
+    "depends-on-column: %u",
     start_offset, end_offset,
     ts_subtree_parse_state(*self),
-    ts_subtree_error_cost(*self),
     ts_subtree_has_changes(*self),
-    ts_subtree_depends_on_column(*self),
-    ts_subtree_repeat_depth(*self),
-    ts_subtree_lookahead_bytes(*self)
+    ts_subtree_depends_on_column(*self)
   );
 
+  // Frozen subtrees don't store the fields that are only used while parsing.
+  if (!ts_subtree_is_frozen(*self)) {
+    fprintf(f, "\n"
+      "error-cost: %u\n"
+      "repeat-depth: %u\n"
+      "lookahead-bytes: %u\n"
+      "private: %u",
+      ts_subtree_error_cost(*self),
+      ts_subtree_repeat_depth(*self),
+      ts_subtree_lookahead_bytes(*self),
+      !self->data.is_inline && self->ptr->is_private
+    );
+  }
+
   if (ts_subtree_is_error(*self) && ts_subtree_child_count(*self) == 0) {
     fprintf(f, "\ncharacter: '%c'", self->ptr->lookahead_char);
   }
@@ -25,20 +25,39 @@ extern "C" {
 // onto the subtree itself so that the scanner's state can later be
 // restored using its `deserialize` function.
 //
-// Small byte arrays are stored inline, and long ones are allocated
-// separately on the heap.
+// Small byte arrays are stored inline. Long ones are stored separately,
+// either in the subtree's arena or in a reference-counted buffer on the
+// heap. While parsing, long states are interned, so subtrees whose states
+// have the same bytes share one copy of them. Each state also stores a hash
+// of its bytes, so that most unequal states can be told apart without
+// comparing them.
 typedef struct {
   union {
     char *long_data;
     char short_data[24];
   };
   uint32_t length;
+  uint32_t hash;
 } ExternalScannerState;
 
+// A hash table of the long external scanner states that were created
+// during one parse, used to intern them.
+typedef struct {
+  ExternalScannerState *entries;
+  uint32_t size;
+  uint32_t mask;
+} ExternalScannerStateTable;
+
 // A compact representation of a subtree.
 //
 // This representation is used for small leaf nodes that are not
 // errors, and were not created by an external scanner.
+//
+// The leaf's extent is stored in one of two layouts. Most leaves are
+// separated from the previous token by padding on the same line, so the
+// padding's column count is the same as its byte count, and the space
+// can be used for a wider byte count and size instead. Leaves whose
+// padding contains line breaks store the padding's rows and columns.
 typedef struct {
   bool is_inline : 1;
   bool visible : 1;
@@ -47,13 +66,23 @@ typedef struct {
   bool has_changes : 1;
   bool is_missing : 1;
   bool is_keyword : 1;
+  bool has_padding_rows : 1;
   uint8_t symbol;
-  uint8_t padding_bytes;
-  uint8_t size_bytes;
-  uint8_t padding_columns;
-  uint8_t padding_rows : 4;
-  uint8_t lookahead_bytes : 4;
   uint16_t parse_state;
+  union {
+    struct {
+      uint32_t padding_bytes : 10;
+      uint32_t size_bytes : 18;
+      uint32_t lookahead_bytes : 4;
+    } single_line;
+    struct {
+      uint32_t padding_rows : 4;
+      uint32_t padding_columns : 9;
+      uint32_t padding_row_bytes : 7;
+      uint32_t size_bytes : 8;
+      uint32_t lookahead_bytes : 4;
+    } multi_line;
+  };
 } SubtreeInlineData;
 
 // A heap-allocated representation of a subtree.
@@ -61,15 +90,25 @@ typedef struct {
 // This representation is used for parent nodes, external tokens,
 // errors, and other leaf nodes whose data is too large to fit into
 // the inlinen representation.
+//
+// Subtrees that are created while parsing are private to the parser's thread
+// until the tree is returned, so their reference counts are updated without
+// atomic operations. When the parser finishes the tree, `ts_subtree_balance`
+// marks them as public.
+//
+// A frozen subtree (see `ts_subtree_freeze`) only stores the beginning of
+// this struct: a parent node stops after `frozen_lookahead_bytes`, which
+// holds its lookahead bytes in place of `first_leaf`, and a leaf stops before
+// `ref_count`. The fields that are left out are only used while parsing, and
+// their accessors derive them from the subtree's children. Frozen subtrees
+// aren't reference counted; they are freed along with the block of memory
+// that holds them, so they can't be modified. `ts_subtree_make_mut` copies a
+// frozen subtree into an ordinary one whose children stay frozen.
 typedef struct {
-  volatile uint32_t ref_count;
   Length padding;
   Length size;
-  uint32_t lookahead_bytes;
-  uint32_t error_cost;
   uint32_t child_count;
   TSSymbol symbol;
-  TSStateId parse_state;
 
   bool visible : 1;
   bool named : 1;
@@ -81,20 +120,29 @@ typedef struct {
   bool depends_on_column: 1;
   bool is_missing : 1;
   bool is_keyword : 1;
+  bool is_arena_allocated : 1;
+  bool is_frozen : 1;
+  bool has_error : 1;
+  bool is_private : 1;
 
   union {
     // Non-terminal subtrees (`child_count > 0`)
     struct {
       uint32_t visible_child_count;
       uint32_t named_child_count;
+      uint32_t visible_descendant_count;
       uint32_t node_count;
+      uint16_t production_id;
+      TSStateId frozen_parse_state;
+      union {
+        struct {
+          TSSymbol symbol;
+          TSStateId parse_state;
+        } first_leaf;
+        uint32_t frozen_lookahead_bytes;
+      };
       uint32_t repeat_depth;
       int32_t dynamic_precedence;
-      uint16_t production_id;
-      struct {
-        TSSymbol symbol;
-        TSStateId parse_state;
-      } first_leaf;
     };
 
     // External terminal subtrees (`child_count == 0 && has_external_tokens`)
@@ -103,6 +151,12 @@ typedef struct {
     // Error terminal subtrees (`child_count == 0 && symbol == ts_builtin_sym_error`)
     int32_t lookahead_char;
   };
+
+  uint32_t lookahead_bytes;
+  TSStateId parse_state;
+
+  volatile uint32_t ref_count;
+  uint32_t error_cost;
 } SubtreeHeapData;
 
 // The fundamental building block of a syntax tree.
@@ -120,15 +174,49 @@ typedef union {
 typedef Array(Subtree) SubtreeArray;
 typedef Array(MutableSubtree) MutableSubtreeArray;
 
+typedef struct SubtreeArenaSlab SubtreeArenaSlab;
+
+// A set of large blocks of memory from which the subtrees that are created
+// during one parse are allocated.
+//
+// The arena is reference counted. It is retained by the parser that allocates
+// from it and by the tree that the parse produces, and each of its subtrees
+// retains it for as long as the subtree is alive. Its memory is freed all at
+// once when the count reaches zero. If the parser has an allocator, the
+// arena's memory comes from that allocator. Frozen subtrees don't retain the
+// arena that holds them; only the trees that use them do.
+//
+// As long as none of the arena's subtrees are linked with subtrees outside of
+// the arena, the tree that owns the arena can free it without releasing its
+// subtrees individually. When a tree is copied, edited, or used for an
+// incremental parse, its arena is marked as shared, and its subtrees must be
+// released like any other subtrees.
+typedef struct {
+  SubtreeArenaSlab *slabs;
+  char *next;
+  char *end;
+  MutableSubtreeArray free_trees;
+  TSAllocator allocator;
+  volatile uint32_t ref_count;
+  volatile bool is_shared;
+} SubtreeArena;
+
 typedef struct {
   MutableSubtreeArray free_trees;
   MutableSubtreeArray tree_stack;
+  Array(SubtreeArray) free_arrays;
+  uint32_t allocation_count;
+  uint32_t reuse_count;
+  SubtreeArena *arena;
+  ExternalScannerStateTable external_scanner_states;
+  bool is_private;
 } SubtreePool;
 
-void ts_external_scanner_state_init(ExternalScannerState *, const char *, unsigned);
+void ts_external_scanner_state_init(ExternalScannerState *, SubtreePool *, const char *, unsigned);
 const char *ts_external_scanner_state_data(const ExternalScannerState *);
 
-void ts_subtree_array_copy(SubtreeArray, SubtreeArray *);
+SubtreeArray ts_subtree_array_new(SubtreePool *, uint32_t);
+void ts_subtree_array_copy(SubtreePool *, SubtreeArray, SubtreeArray *);
 void ts_subtree_array_clear(SubtreePool *, SubtreeArray *);
 void ts_subtree_array_delete(SubtreePool *, SubtreeArray *);
 void ts_subtree_array_remove_trailing_extras(SubtreeArray *, SubtreeArray *);
@@ -136,6 +224,12 @@ void ts_subtree_array_reverse(SubtreeArray *);
 
 SubtreePool ts_subtree_pool_new(uint32_t capacity);
 void ts_subtree_pool_delete(SubtreePool *);
+SubtreeArena *ts_subtree_pool_take_arena(SubtreePool *);
+
+SubtreeArena *ts_subtree_arena_new(const TSAllocator *);
+void ts_subtree_arena_retain(SubtreeArena *);
+void ts_subtree_arena_release(SubtreeArena *);
+void ts_subtree_arena_delete(SubtreeArena *);
 
 Subtree ts_subtree_new_leaf(
   SubtreePool *, TSSymbol, Length, Length, uint32_t,
@@ -144,12 +238,18 @@ Subtree ts_subtree_new_leaf(
 Subtree ts_subtree_new_error(
   SubtreePool *, int32_t, Length, Length, uint32_t, TSStateId, const TSLanguage *
 );
-MutableSubtree ts_subtree_new_node(TSSymbol, SubtreeArray *, unsigned, const TSLanguage *);
-Subtree ts_subtree_new_error_node(SubtreeArray *, bool, const TSLanguage *);
+MutableSubtree ts_subtree_new_node(SubtreePool *, TSSymbol, SubtreeArray *, unsigned, const TSLanguage *);
+Subtree ts_subtree_new_error_node(SubtreePool *, SubtreeArray *, bool, const TSLanguage *);
 Subtree ts_subtree_new_missing_leaf(SubtreePool *, TSSymbol, Length, const TSLanguage *);
 MutableSubtree ts_subtree_make_mut(SubtreePool *, Subtree);
+Subtree ts_subtree_freeze(Subtree, SubtreeArena *);
+uint32_t ts_subtree_frozen_error_cost(Subtree);
+char *ts_subtree_serialize(Subtree, size_t, size_t *, Subtree *);
+bool ts_subtree_deserialize(const char *, size_t, Subtree, const TSLanguage *, SubtreeArena *, Subtree *);
 void ts_subtree_retain(Subtree);
 void ts_subtree_release(SubtreePool *, Subtree);
+void ts_subtree_release_deferred(SubtreePool *, Subtree);
+uint32_t ts_subtree_pool_free_pending(SubtreePool *, uint32_t);
 bool ts_subtree_eq(Subtree, Subtree);
 int ts_subtree_compare(Subtree, Subtree);
 void ts_subtree_set_symbol(MutableSubtree *, TSSymbol, const TSLanguage *);
@@ -157,6 +257,8 @@ void ts_subtree_summarize(MutableSubtree, const Subtree *, uint32_t, const TSLan
 void ts_subtree_summarize_children(MutableSubtree, const TSLanguage *);
 void ts_subtree_balance(Subtree, SubtreePool *, const TSLanguage *);
 Subtree ts_subtree_edit(Subtree, const TSInputEdit *edit, SubtreePool *);
+Subtree ts_subtree_edit_batch(Subtree, const TSInputEdit *, uint32_t, SubtreePool *);
+Subtree ts_subtree_prepend_padding(Subtree, Length, SubtreePool *);
 char *ts_subtree_string(Subtree, const TSLanguage *, bool include_all);
 void ts_subtree_print_dot_graph(Subtree, const TSLanguage *, FILE *);
 Subtree ts_subtree_last_external_token(Subtree);
@@ -171,11 +273,29 @@ static inline bool ts_subtree_extra(Subtree self) { return SUBTREE_GET(self, ext
 static inline bool ts_subtree_has_changes(Subtree self) { return SUBTREE_GET(self, has_changes); }
 static inline bool ts_subtree_missing(Subtree self) { return SUBTREE_GET(self, is_missing); }
 static inline bool ts_subtree_is_keyword(Subtree self) { return SUBTREE_GET(self, is_keyword); }
-static inline TSStateId ts_subtree_parse_state(Subtree self) { return SUBTREE_GET(self, parse_state); }
-static inline uint32_t ts_subtree_lookahead_bytes(Subtree self) { return SUBTREE_GET(self, lookahead_bytes); }
+
+static inline uint32_t ts_subtree_lookahead_bytes(Subtree self) {
+  if (self.data.is_inline) {
+    return self.data.has_padding_rows
+      ? self.data.multi_line.lookahead_bytes
+      : self.data.single_line.lookahead_bytes;
+  }
+  if (self.ptr->is_frozen && self.ptr->child_count > 0) return self.ptr->frozen_lookahead_bytes;
+  return self.ptr->lookahead_bytes;
+}
 
 #undef SUBTREE_GET
 
+static inline bool ts_subtree_is_frozen(Subtree self) {
+  return !self.data.is_inline && self.ptr->is_frozen;
+}
+
+static inline TSStateId ts_subtree_parse_state(Subtree self) {
+  if (self.data.is_inline) return self.data.parse_state;
+  if (self.ptr->is_frozen && self.ptr->child_count > 0) return self.ptr->frozen_parse_state;
+  return self.ptr->parse_state;
+}
+
 // Get the size needed to store a heap-allocated subtree with the given
 // number of children.
 static inline size_t ts_subtree_alloc_size(uint32_t child_count) {
@@ -187,6 +307,13 @@ static inline size_t ts_subtree_alloc_size(uint32_t child_count) {
 #define ts_subtree_children(self) \
   ((self).data.is_inline ? NULL : (Subtree *)((self).ptr) - (self).ptr->child_count)
 
+// Get the arena from which a subtree was allocated, which is stored
+// immediately before the subtree's children.
+static inline SubtreeArena *ts_subtree_arena(Subtree self) {
+  if (self.data.is_inline || !self.ptr->is_arena_allocated) return NULL;
+  return ((SubtreeArena *const *)ts_subtree_children(self))[-1];
+}
+
 static inline void ts_subtree_set_extra(MutableSubtree *self) {
   if (self->data.is_inline) {
     self->data.extra = true;
@@ -195,13 +322,24 @@ static inline void ts_subtree_set_extra(MutableSubtree *self) {
   }
 }
 
+// Frozen parents don't store their first leaf, so it is found by descending
+// through their first children.
+static inline Subtree ts_subtree__skip_frozen_parents(Subtree self) {
+  while (!self.data.is_inline && self.ptr->is_frozen && self.ptr->child_count > 0) {
+    self = ts_subtree_children(self)[0];
+  }
+  return self;
+}
+
 static inline TSSymbol ts_subtree_leaf_symbol(Subtree self) {
+  self = ts_subtree__skip_frozen_parents(self);
   if (self.data.is_inline) return self.data.symbol;
   if (self.ptr->child_count == 0) return self.ptr->symbol;
   return self.ptr->first_leaf.symbol;
 }
 
 static inline TSStateId ts_subtree_leaf_parse_state(Subtree self) {
+  self = ts_subtree__skip_frozen_parents(self);
   if (self.data.is_inline) return self.data.parse_state;
   if (self.ptr->child_count == 0) return self.ptr->parse_state;
   return self.ptr->first_leaf.parse_state;
@@ -209,8 +347,16 @@ static inline TSStateId ts_subtree_leaf_parse_state(Subtree self) {
 
 static inline Length ts_subtree_padding(Subtree self) {
   if (self.data.is_inline) {
-    Length result = {self.data.padding_bytes, {self.data.padding_rows, self.data.padding_columns}};
-    return result;
+    if (self.data.has_padding_rows) {
+      Length result = {
+        self.data.multi_line.padding_row_bytes + self.data.multi_line.padding_columns,
+        {self.data.multi_line.padding_rows, self.data.multi_line.padding_columns}
+      };
+      return result;
+    } else {
+      Length result = {self.data.single_line.padding_bytes, {0, self.data.single_line.padding_bytes}};
+      return result;
+    }
   } else {
     return self.ptr->padding;
   }
@@ -218,7 +364,10 @@ static inline Length ts_subtree_padding(Subtree self) {
 
 static inline Length ts_subtree_size(Subtree self) {
   if (self.data.is_inline) {
-    Length result = {self.data.size_bytes, {0, self.data.size_bytes}};
+    uint32_t bytes = self.data.has_padding_rows
+      ? self.data.multi_line.size_bytes
+      : self.data.single_line.size_bytes;
+    Length result = {bytes, {0, bytes}};
     return result;
   } else {
     return self.ptr->size;
@@ -237,14 +386,21 @@ static inline uint32_t ts_subtree_child_count(Subtree self) {
   return self.data.is_inline ? 0 : self.ptr->child_count;
 }
 
+// Frozen subtrees are never rebalanced, so their repeat depth is zero.
 static inline uint32_t ts_subtree_repeat_depth(Subtree self) {
-  return self.data.is_inline ? 0 : self.ptr->repeat_depth;
+  return (self.data.is_inline || self.ptr->is_frozen) ? 0 : self.ptr->repeat_depth;
 }
 
 static inline uint32_t ts_subtree_node_count(Subtree self) {
   return (self.data.is_inline || self.ptr->child_count == 0) ? 1 : self.ptr->node_count;
 }
 
+static inline uint32_t ts_subtree_visible_descendant_count(Subtree self) {
+  return (self.data.is_inline || self.ptr->child_count == 0)
+    ? 0
+    : self.ptr->visible_descendant_count;
+}
+
 static inline uint32_t ts_subtree_visible_child_count(Subtree self) {
   if (ts_subtree_child_count(self) > 0) {
     return self.ptr->visible_child_count;
@@ -256,13 +412,28 @@ static inline uint32_t ts_subtree_visible_child_count(Subtree self) {
 static inline uint32_t ts_subtree_error_cost(Subtree self) {
   if (ts_subtree_missing(self)) {
     return ERROR_COST_PER_MISSING_TREE + ERROR_COST_PER_RECOVERY;
+  } else if (self.data.is_inline) {
+    return 0;
+  } else if (self.ptr->is_frozen) {
+    return self.ptr->has_error ? ts_subtree_frozen_error_cost(self) : 0;
   } else {
-    return self.data.is_inline ? 0 : self.ptr->error_cost;
+    return self.ptr->error_cost;
   }
 }
 
+// Check whether a subtree contains any errors or missing nodes. Frozen
+// subtrees don't store their error cost, so they store this instead.
+static inline bool ts_subtree_has_error(Subtree self) {
+  if (ts_subtree_is_frozen(self)) return self.ptr->has_error;
+  return ts_subtree_error_cost(self) > 0;
+}
+
+// Frozen parents whose dynamic precedence isn't zero are fragile, so the
+// parser never reuses them, and their precedence is treated as zero.
 static inline int32_t ts_subtree_dynamic_precedence(Subtree self) {
-  return (self.data.is_inline || self.ptr->child_count == 0) ? 0 : self.ptr->dynamic_precedence;
+  return (self.data.is_inline || self.ptr->child_count == 0 || self.ptr->is_frozen)
+    ? 0
+    : self.ptr->dynamic_precedence;
 }
 
 static inline uint16_t ts_subtree_production_id(Subtree self) {
@@ -0,0 +1,138 @@
+#ifndef TREE_SITTER_THREAD_H_
+#define TREE_SITTER_THREAD_H_
+
+#include <stdbool.h>
+
+typedef void *(*TSThreadFunction)(void *);
+
+#ifdef _WIN32
+
+// Windows:
+// * Run the thread function through a trampoline, because Windows thread
+//   procedures have a different signature than POSIX ones.
+
+#include <windows.h>
+
+typedef struct {
+  HANDLE handle;
+  TSThreadFunction function;
+  void *payload;
+} TSThread;
+
+static DWORD WINAPI ts_thread__run(LPVOID payload) {
+  TSThread *self = payload;
+  self->function(self->payload);
+  return 0;
+}
+
+static inline bool ts_thread_spawn(TSThread *self, TSThreadFunction function, void *payload) {
+  self->function = function;
+  self->payload = payload;
+  self->handle = CreateThread(NULL, 0, ts_thread__run, self, 0, NULL);
+  return self->handle != NULL;
+}
+
+static inline void ts_thread_join(TSThread *self) {
+  WaitForSingleObject(self->handle, INFINITE);
+  CloseHandle(self->handle);
+}
+
+typedef CRITICAL_SECTION TSMutex;
+
+static inline void ts_mutex_init(TSMutex *self) {
+  InitializeCriticalSection(self);
+}
+
+static inline void ts_mutex_lock(TSMutex *self) {
+  EnterCriticalSection(self);
+}
+
+static inline void ts_mutex_unlock(TSMutex *self) {
+  LeaveCriticalSection(self);
+}
+
+static inline void ts_mutex_destroy(TSMutex *self) {
+  DeleteCriticalSection(self);
+}
+
+#elif defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+
+// Wasm without thread support:
+// * Spawning always fails, so callers must do their work on the current thread.
+// * Mutexes do nothing, because there is only ever one thread.
+
+typedef struct {
+  char unused;
+} TSThread;
+
+static inline bool ts_thread_spawn(TSThread *self, TSThreadFunction function, void *payload) {
+  (void)self;
+  (void)function;
+  (void)payload;
+  return false;
+}
+
+static inline void ts_thread_join(TSThread *self) {
+  (void)self;
+}
+
+typedef struct {
+  char unused;
+} TSMutex;
+
+static inline void ts_mutex_init(TSMutex *self) {
+  (void)self;
+}
+
+static inline void ts_mutex_lock(TSMutex *self) {
+  (void)self;
+}
+
+static inline void ts_mutex_unlock(TSMutex *self) {
+  (void)self;
+}
+
+static inline void ts_mutex_destroy(TSMutex *self) {
+  (void)self;
+}
+
+#else
+
+// POSIX:
+// * Use pthreads directly.
+
+#include <pthread.h>
+
+typedef struct {
+  pthread_t handle;
+} TSThread;
+
+static inline bool ts_thread_spawn(TSThread *self, TSThreadFunction function, void *payload) {
+  return pthread_create(&self->handle, NULL, function, payload) == 0;
+}
+
+static inline void ts_thread_join(TSThread *self) {
+  pthread_join(self->handle, NULL);
+}
+
+typedef pthread_mutex_t TSMutex;
+
+static inline void ts_mutex_init(TSMutex *self) {
+  pthread_mutex_init(self, NULL);
+}
+
+static inline void ts_mutex_lock(TSMutex *self) {
+  pthread_mutex_lock(self);
+}
+
+static inline void ts_mutex_unlock(TSMutex *self) {
+  pthread_mutex_unlock(self);
+}
+
+static inline void ts_mutex_destroy(TSMutex *self) {
+  pthread_mutex_destroy(self);
+}
+
+#endif
+
+#endif  // TREE_SITTER_THREAD_H_
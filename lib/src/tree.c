@@ -1,6 +1,8 @@
 #include "tree_sitter/api.h"
 #include "./array.h"
+#include "./atomic.h"
 #include "./get_changed_ranges.h"
+#include "./language.h"
 #include "./subtree.h"
 #include "./tree_cursor.h"
 #include "./tree.h"
@@ -15,30 +17,192 @@ TSTree *ts_tree_new(
   result->root = root;
   result->language = language;
   result->parent_cache = NULL;
-  result->parent_cache_start = 0;
-  result->parent_cache_size = 0;
+  result->parent_cache_next = 0;
   result->included_ranges = ts_calloc(included_range_count, sizeof(TSRange));
   memcpy(result->included_ranges, included_ranges, included_range_count * sizeof(TSRange));
   result->included_range_count = included_range_count;
+  result->arena = NULL;
+  result->frozen_arena = NULL;
+  result->next_deferred = NULL;
+  result->index = NULL;
   return result;
 }
 
 TSTree *ts_tree_copy(const TSTree *self) {
   ts_subtree_retain(self->root);
-  return ts_tree_new(self->root, self->language, self->included_ranges, self->included_range_count);
+  TSTree *result = ts_tree_new(
+    self->root,
+    self->language,
+    self->included_ranges,
+    self->included_range_count
+  );
+  if (self->arena) {
+    self->arena->is_shared = true;
+    ts_subtree_arena_retain(self->arena);
+    result->arena = self->arena;
+  }
+  if (self->frozen_arena) {
+    ts_subtree_arena_retain(self->frozen_arena);
+    result->frozen_arena = self->frozen_arena;
+  }
+  return result;
+}
+
+static void ts_tree__delete_index(TSTree *self) {
+  if (self->index) {
+    ts_free(self->index->entries);
+    ts_free(self->index->slots);
+    ts_free(self->index);
+    self->index = NULL;
+  }
+}
+
+static void ts_tree__clear_parent_cache(TSTree *self) {
+  if (self->parent_cache) {
+    memset(self->parent_cache, 0, PARENT_CACHE_CAPACITY * sizeof(ParentCacheEntry));
+  }
+  self->parent_cache_next = 0;
+}
+
+// Release the tree's root and its arena. If the root's last reference is
+// released, it is pushed onto the pool's stack of subtrees to free.
+//
+// The subtrees on that stack may still have frozen children, so the block
+// that holds the tree's frozen subtrees is returned instead of released. The
+// caller releases it once the stack is empty.
+static SubtreeArena *ts_tree__release_root(TSTree *self, SubtreePool *pool) {
+  // If none of the nodes in the tree's arena are shared, then they can all
+  // be freed at once.
+  if (self->arena && !self->arena->is_shared) {
+    ts_subtree_arena_delete(self->arena);
+  } else {
+    ts_subtree_release_deferred(pool, self->root);
+    if (self->arena) ts_subtree_arena_release(self->arena);
+  }
+  return self->frozen_arena;
+}
+
+// Free the tree itself, and release its root. Returns the tree's block of
+// frozen subtrees, as `ts_tree__release_root` does.
+static SubtreeArena *ts_tree__release(TSTree *self, SubtreePool *pool) {
+  SubtreeArena *frozen_arena = ts_tree__release_root(self, pool);
+  ts_tree__delete_index(self);
+  ts_free(self->included_ranges);
+  if (self->parent_cache) ts_free(self->parent_cache);
+  ts_free(self);
+  return frozen_arena;
 }
 
 void ts_tree_delete(TSTree *self) {
   if (!self) return;
-
   SubtreePool pool = ts_subtree_pool_new(0);
-  ts_subtree_release(&pool, self->root);
+  SubtreeArena *frozen_arena = ts_tree__release(self, &pool);
+  ts_subtree_pool_free_pending(&pool, UINT32_MAX);
   ts_subtree_pool_delete(&pool);
-  ts_free(self->included_ranges);
-  if (self->parent_cache) ts_free(self->parent_cache);
+  if (frozen_arena) ts_subtree_arena_release(frozen_arena);
+}
+
+// TSTreeReclaimer
+
+struct TSTreeReclaimer {
+  // Trees that have been deleted, most recent first. Any thread can push
+  // onto this list.
+  TSTree *volatile deferred_trees;
+
+  // Trees that the draining thread has taken from the list, oldest first,
+  // the subtrees that it has yet to free, and the block of frozen subtrees
+  // that those subtrees use.
+  TSTree *taken_trees;
+  SubtreePool pool;
+  SubtreeArena *frozen_arena;
+
+  volatile uint32_t drain_count;
+};
+
+TSTreeReclaimer *ts_tree_reclaimer_new(void) {
+  TSTreeReclaimer *self = ts_malloc(sizeof(TSTreeReclaimer));
+  self->deferred_trees = NULL;
+  self->taken_trees = NULL;
+  self->pool = ts_subtree_pool_new(0);
+  self->frozen_arena = NULL;
+  self->drain_count = 0;
+  return self;
+}
+
+void ts_tree_reclaimer_delete(TSTreeReclaimer *self) {
+  if (!self) return;
+  while (ts_tree_reclaimer_drain(self, UINT32_MAX)) {}
+  ts_subtree_pool_delete(&self->pool);
   ts_free(self);
 }
 
+void ts_tree_delete_deferred(TSTree *self, TSTreeReclaimer *reclaimer) {
+  if (!self) return;
+  TSTree *head;
+  do {
+    head = reclaimer->deferred_trees;
+    self->next_deferred = head;
+  } while (!atomic_compare_exchange_pointer(
+    (void *volatile *)&reclaimer->deferred_trees,
+    head,
+    self
+  ));
+}
+
+// Take all of the trees that have been deleted since the last time, and
+// reverse them so that they are freed in the order that they were deleted.
+static void ts_tree_reclaimer__take_trees(TSTreeReclaimer *self) {
+  TSTree *head;
+  do {
+    head = self->deferred_trees;
+  } while (head && !atomic_compare_exchange_pointer(
+    (void *volatile *)&self->deferred_trees,
+    head,
+    NULL
+  ));
+
+  TSTree *taken = NULL;
+  while (head) {
+    TSTree *next = head->next_deferred;
+    head->next_deferred = taken;
+    taken = head;
+    head = next;
+  }
+  self->taken_trees = taken;
+}
+
+bool ts_tree_reclaimer_drain(TSTreeReclaimer *self, uint32_t max_node_count) {
+  if (atomic_inc(&self->drain_count) != 1) {
+    atomic_dec(&self->drain_count);
+    return true;
+  }
+
+  bool has_more = true;
+  uint32_t count = 0;
+  for (;;) {
+    count += ts_subtree_pool_free_pending(&self->pool, max_node_count - count);
+    if (self->pool.tree_stack.size == 0 && self->frozen_arena) {
+      ts_subtree_arena_release(self->frozen_arena);
+      self->frozen_arena = NULL;
+    }
+    if (self->pool.tree_stack.size > 0 || count >= max_node_count) break;
+    if (!self->taken_trees) {
+      ts_tree_reclaimer__take_trees(self);
+      if (!self->taken_trees) {
+        has_more = false;
+        break;
+      }
+    }
+    TSTree *tree = self->taken_trees;
+    self->taken_trees = tree->next_deferred;
+    self->frozen_arena = ts_tree__release(tree, &self->pool);
+    count++;
+  }
+
+  atomic_dec(&self->drain_count);
+  return has_more;
+}
+
 TSNode ts_tree_root_node(const TSTree *self) {
   return ts_node_new(self, &self->root, ts_subtree_padding(self->root), 0);
 }
@@ -47,7 +211,7 @@ const TSLanguage *ts_tree_language(const TSTree *self) {
   return self->language;
 }
 
-void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
+static void ts_tree__edit_included_ranges(TSTree *self, const TSInputEdit *edit) {
   for (unsigned i = 0; i < self->included_range_count; i++) {
     TSRange *range = &self->included_ranges[i];
     if (range->end_byte >= edit->old_end_byte) {
@@ -75,12 +239,295 @@ void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
       }
     }
   }
+}
+
+void ts_tree_edit(TSTree *self, const TSInputEdit *edit) {
+  ts_tree_edit_batch(self, edit, 1);
+}
+
+void ts_tree_edit_batch(TSTree *self, const TSInputEdit *edits, uint32_t count) {
+  if (count == 0) return;
+  for (uint32_t i = 0; i < count; i++) {
+    ts_tree__edit_included_ranges(self, &edits[i]);
+  }
+
+  ts_tree__delete_index(self);
+  SubtreePool pool = ts_subtree_pool_new(0);
+
+  // Editing can replace the tree's nodes with nodes that aren't allocated
+  // from its arena.
+  if (self->arena) self->arena->is_shared = true;
+
+  // The subtrees can only be edited in one pass for a sorted run of edits
+  // that don't overlap. Other edits start a new pass.
+  uint32_t run_start = 0;
+  for (uint32_t i = 1; i <= count; i++) {
+    if (i == count || edits[i].start_byte < edits[i - 1].new_end_byte) {
+      self->root = ts_subtree_edit_batch(self->root, &edits[run_start], i - run_start, &pool);
+      run_start = i;
+    }
+  }
+
+  ts_tree__clear_parent_cache(self);
+  ts_subtree_pool_delete(&pool);
+}
+
+void ts_tree_freeze(TSTree *self) {
+  SubtreeArena *old_arena = self->arena ? self->arena : self->frozen_arena;
+  SubtreeArena *arena = ts_subtree_arena_new(old_arena ? &old_arena->allocator : NULL);
+  Subtree root = ts_subtree_freeze(self->root, arena);
 
   SubtreePool pool = ts_subtree_pool_new(0);
-  self->root = ts_subtree_edit(self->root, edit, &pool);
-  self->parent_cache_start = 0;
-  self->parent_cache_size = 0;
+  SubtreeArena *frozen_arena = ts_tree__release_root(self, &pool);
+  ts_subtree_pool_free_pending(&pool, UINT32_MAX);
   ts_subtree_pool_delete(&pool);
+  if (frozen_arena) ts_subtree_arena_release(frozen_arena);
+  self->root = root;
+  self->arena = NULL;
+  self->frozen_arena = arena;
+
+  // The nodes' ids have changed, so any cached parents are no longer valid,
+  // and the index must be rebuilt.
+  ts_tree__clear_parent_cache(self);
+  if (self->index) {
+    ts_tree__delete_index(self);
+    ts_tree_build_index(self);
+  }
+}
+
+// Serialization
+
+#define TS_SERIALIZED_TREE_MAGIC 0x54535452
+#define TS_SERIALIZED_TREE_VERSION 5
+
+// The header of a serialized tree, which is followed by the tree's included
+// ranges and then by its block of nodes. The nodes are stored in their
+// in-memory layout, so trees can only be read on the same kind of platform,
+// and by the same version of the library, that wrote them.
+typedef struct {
+  uint32_t magic;
+  uint32_t format_version;
+  uint32_t pointer_size;
+  uint32_t node_size;
+  uint32_t language_version;
+  uint32_t language_size_hash;
+  uint32_t language_hash;
+  uint32_t included_range_count;
+  uint64_t node_block_size;
+  Subtree root;
+} SerializedTreeHeader;
+
+// Hash a block of memory eight bytes at a time, because a language's parse
+// table is hashed every time a tree is written or read.
+static inline uint32_t ts_tree__hash_bytes(uint32_t hash, const void *data, size_t length) {
+  const uint8_t *bytes = data;
+  uint64_t state = hash;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, &bytes[i], sizeof(word));
+    state = (state ^ word) * 1099511628211u;
+    state ^= state >> 29;
+  }
+  for (; i < length; i++) {
+    state = (state ^ bytes[i]) * 1099511628211u;
+  }
+  return (uint32_t)(state ^ (state >> 32));
+}
+
+static inline uint32_t ts_tree__hash_value(uint32_t hash, uint32_t value) {
+  return ts_tree__hash_bytes(hash, &value, sizeof(value));
+}
+
+// Hash a language's sizes. This is cheap, so it is checked first when a tree
+// is read, and a tree that was written using a grammar of a different size
+// is rejected without hashing the whole parse table.
+static uint32_t ts_tree__language_size_hash(const TSLanguage *language) {
+  uint32_t hash = 2166136261u;
+  hash = ts_tree__hash_value(hash, language->symbol_count);
+  hash = ts_tree__hash_value(hash, language->alias_count);
+  hash = ts_tree__hash_value(hash, language->token_count);
+  hash = ts_tree__hash_value(hash, language->external_token_count);
+  hash = ts_tree__hash_value(hash, language->state_count);
+  hash = ts_tree__hash_value(hash, language->large_state_count);
+  hash = ts_tree__hash_value(hash, language->production_id_count);
+  hash = ts_tree__hash_value(hash, language->field_count);
+  hash = ts_tree__hash_value(hash, language->max_alias_sequence_length);
+  return hash;
+}
+
+// Hash a language's symbol names, sizes, and parse table, so that a tree isn't
+// read using a different version of its grammar. The parse states and
+// production ids that are stored in the tree's nodes are only meaningful for
+// the exact parse table that produced them.
+static uint32_t ts_tree__language_hash(const TSLanguage *language) {
+  uint32_t hash = ts_tree__language_size_hash(language);
+
+  for (TSSymbol symbol = 0; symbol < language->symbol_count; symbol++) {
+    const char *name = ts_language_symbol_name(language, symbol);
+    hash = ts_tree__hash_bytes(hash, name, strlen(name) + 1);
+  }
+
+  // For terminal symbols, the values in the parse table are indices into the
+  // list of parse actions. Find the end of that list while hashing the table.
+  uint32_t action_count = 0;
+  if (language->parse_table) {
+    for (uint32_t state = 0; state < language->large_state_count; state++) {
+      const uint16_t *row = &language->parse_table[state * language->symbol_count];
+      for (uint32_t symbol = 0; symbol < language->token_count; symbol++) {
+        if (row[symbol]) {
+          uint32_t end = row[symbol] + 1 + language->parse_actions[row[symbol]].entry.count;
+          if (end > action_count) action_count = end;
+        }
+      }
+    }
+    hash = ts_tree__hash_bytes(
+      hash,
+      language->parse_table,
+      language->large_state_count * language->symbol_count * sizeof(uint16_t)
+    );
+  }
+
+  // The small parse table doesn't record its own length, so walk each state's
+  // symbols to find it.
+  if (language->small_parse_table) {
+    uint32_t small_table_length = 0;
+    for (uint32_t state = language->large_state_count; state < language->state_count; state++) {
+      uint32_t index = language->small_parse_table_map[state - language->large_state_count];
+      const uint16_t *data = &language->small_parse_table[index];
+      if (language->version >= LANGUAGE_VERSION_WITH_SORTED_SMALL_STATES) {
+        uint16_t symbol_count = *(data++);
+        for (uint16_t i = 0; i < symbol_count; i++) {
+          uint16_t value = data[symbol_count + i];
+          if (value && data[i] < language->token_count) {
+            uint32_t end = value + 1 + language->parse_actions[value].entry.count;
+            if (end > action_count) action_count = end;
+          }
+        }
+        data += 2 * symbol_count;
+      } else {
+        uint16_t group_count = *(data++);
+        for (uint16_t i = 0; i < group_count; i++) {
+          uint16_t value = *(data++);
+          uint16_t symbol_count = *(data++);
+          for (uint16_t j = 0; j < symbol_count; j++) {
+            TSSymbol symbol = *(data++);
+            if (value && symbol < language->token_count) {
+              uint32_t end = value + 1 + language->parse_actions[value].entry.count;
+              if (end > action_count) action_count = end;
+            }
+          }
+        }
+      }
+      uint32_t end = data - language->small_parse_table;
+      if (end > small_table_length) small_table_length = end;
+    }
+    hash = ts_tree__hash_bytes(
+      hash,
+      language->small_parse_table_map,
+      (language->state_count - language->large_state_count) * sizeof(uint32_t)
+    );
+    hash = ts_tree__hash_bytes(hash, language->small_parse_table, small_table_length * sizeof(uint16_t));
+  }
+
+  // Hash the parse actions field by field, because the shift actions have
+  // padding whose contents are unspecified.
+  for (uint32_t i = 0; i < action_count;) {
+    TSParseActionEntry entry = language->parse_actions[i++];
+    hash = ts_tree__hash_value(hash, entry.entry.count);
+    hash = ts_tree__hash_value(hash, entry.entry.reusable);
+    for (uint8_t j = 0; j < entry.entry.count && i < action_count; j++) {
+      TSParseAction action = language->parse_actions[i++].action;
+      hash = ts_tree__hash_value(hash, action.type);
+      if (action.type == TSParseActionTypeShift) {
+        hash = ts_tree__hash_value(hash, action.shift.state);
+        hash = ts_tree__hash_value(hash, action.shift.extra);
+        hash = ts_tree__hash_value(hash, action.shift.repetition);
+      } else if (action.type == TSParseActionTypeReduce) {
+        hash = ts_tree__hash_value(hash, action.reduce.child_count);
+        hash = ts_tree__hash_value(hash, action.reduce.symbol);
+        hash = ts_tree__hash_value(hash, (uint16_t)action.reduce.dynamic_precedence);
+        hash = ts_tree__hash_value(hash, action.reduce.production_id);
+      }
+    }
+  }
+
+  if (language->lex_modes) {
+    hash = ts_tree__hash_bytes(hash, language->lex_modes, language->state_count * sizeof(TSLexMode));
+  }
+  if (language->alias_sequences) {
+    hash = ts_tree__hash_bytes(
+      hash,
+      language->alias_sequences,
+      language->production_id_count * language->max_alias_sequence_length * sizeof(TSSymbol)
+    );
+  }
+  return hash;
+}
+
+char *ts_tree_serialize(const TSTree *self, size_t *length) {
+  size_t ranges_size = self->included_range_count * sizeof(TSRange);
+  size_t header_size = sizeof(SerializedTreeHeader) + ranges_size;
+  SerializedTreeHeader header = {
+    .magic = TS_SERIALIZED_TREE_MAGIC,
+    .format_version = TS_SERIALIZED_TREE_VERSION,
+    .pointer_size = sizeof(void *),
+    .node_size = sizeof(SubtreeHeapData),
+    .language_version = ts_language_version(self->language),
+    .language_size_hash = ts_tree__language_size_hash(self->language),
+    .language_hash = ts_tree__language_hash(self->language),
+    .included_range_count = self->included_range_count,
+  };
+  char *result = ts_subtree_serialize(self->root, header_size, length, &header.root);
+  header.node_block_size = *length - header_size;
+  memcpy(result, &header, sizeof(header));
+  memcpy(result + sizeof(header), self->included_ranges, ranges_size);
+  return result;
+}
+
+TSTree *ts_tree_open_mapped(const TSLanguage *language, const void *data, size_t length) {
+  SerializedTreeHeader header;
+  if (length < sizeof(header)) return NULL;
+  memcpy(&header, data, sizeof(header));
+  if (
+    header.magic != TS_SERIALIZED_TREE_MAGIC ||
+    header.format_version != TS_SERIALIZED_TREE_VERSION ||
+    header.pointer_size != sizeof(void *) ||
+    header.node_size != sizeof(SubtreeHeapData) ||
+    header.language_version != ts_language_version(language) ||
+    header.language_size_hash != ts_tree__language_size_hash(language) ||
+    header.included_range_count > (length - sizeof(header)) / sizeof(TSRange)
+  ) return NULL;
+
+  // A language can't be recognized by its address, because a grammar that is
+  // regenerated and loaded at the address of an earlier one may have the same
+  // sizes. So its whole parse table is hashed again for each tree.
+  if (header.language_hash != ts_tree__language_hash(language)) return NULL;
+
+  size_t ranges_size = header.included_range_count * sizeof(TSRange);
+  const char *ranges = (const char *)data + sizeof(header);
+  if (header.node_block_size != length - sizeof(header) - ranges_size) return NULL;
+
+  SubtreeArena *arena = ts_subtree_arena_new(NULL);
+  Subtree root;
+  if (!ts_subtree_deserialize(
+    ranges + ranges_size,
+    header.node_block_size,
+    header.root,
+    language,
+    arena,
+    &root
+  )) {
+    ts_subtree_arena_delete(arena);
+    return NULL;
+  }
+
+  TSRange *included_ranges = ts_malloc(ranges_size);
+  memcpy(included_ranges, ranges, ranges_size);
+  TSTree *result = ts_tree_new(root, language, included_ranges, header.included_range_count);
+  result->frozen_arena = arena;
+  ts_free(included_ranges);
+  return result;
 }
 
 TSRange *ts_tree_get_changed_ranges(const TSTree *self, const TSTree *other, uint32_t *count) {
@@ -112,37 +559,145 @@ void ts_tree_print_dot_graph(const TSTree *self, FILE *file) {
   ts_subtree_print_dot_graph(self->root, self->language, file);
 }
 
+// TreeIndex
+
+static inline uint32_t ts_tree_index__hash(const Subtree *subtree) {
+  return (uint32_t)(((uintptr_t)subtree >> 3) * 2654435761u);
+}
+
+typedef Array(TreeIndexEntry) TreeIndexEntryArray;
+
+static uint32_t ts_tree_index__push(
+  TreeIndexEntryArray *entries,
+  const TSTreeCursor *cursor,
+  uint32_t parent,
+  uint32_t prev_sibling
+) {
+  TSNode node = ts_tree_cursor_current_node(cursor);
+  array_push(entries, ((TreeIndexEntry) {
+    .subtree = node.id,
+    .position = {node.context[0], {node.context[1], node.context[2]}},
+    .alias_symbol = node.context[3],
+    .parent = parent,
+    .prev_sibling = prev_sibling,
+    .descendant_count = 0,
+  }));
+  return entries->size - 1;
+}
+
+void ts_tree_build_index(TSTree *self) {
+  if (self->index) return;
+
+  // Visit the tree's visible nodes in preorder. The stack holds the index of
+  // the current node and of each of its ancestors.
+  TreeIndexEntryArray entries = array_new();
+  Array(uint32_t) stack = array_new();
+  TSTreeCursor cursor = ts_tree_cursor_new(ts_tree_root_node(self));
+  uint32_t root = ts_tree_index__push(&entries, &cursor, TREE_INDEX_NONE, TREE_INDEX_NONE);
+  array_push(&stack, root);
+  while (stack.size > 0) {
+    if (ts_tree_cursor_goto_first_child(&cursor)) {
+      uint32_t child = ts_tree_index__push(&entries, &cursor, *array_back(&stack), TREE_INDEX_NONE);
+      array_push(&stack, child);
+      continue;
+    }
+
+    while (stack.size > 0) {
+      uint32_t finished = array_pop(&stack);
+      entries.contents[finished].descendant_count = entries.size - finished;
+      if (stack.size == 0) break;
+      if (ts_tree_cursor_goto_next_sibling(&cursor)) {
+        uint32_t sibling = ts_tree_index__push(&entries, &cursor, *array_back(&stack), finished);
+        array_push(&stack, sibling);
+        break;
+      }
+      ts_tree_cursor_goto_parent(&cursor);
+    }
+  }
+  ts_tree_cursor_delete(&cursor);
+  array_delete(&stack);
+
+  // Keep the hash table at most half full.
+  uint32_t slot_count = 16;
+  while (slot_count < 2 * entries.size) slot_count *= 2;
+  TreeIndex *index = ts_malloc(sizeof(TreeIndex));
+  index->entries = entries.contents;
+  index->entry_count = entries.size;
+  index->slots = ts_calloc(slot_count, sizeof(uint32_t));
+  index->slot_mask = slot_count - 1;
+  for (uint32_t i = 0; i < entries.size; i++) {
+    uint32_t slot = ts_tree_index__hash(entries.contents[i].subtree) & index->slot_mask;
+    while (index->slots[slot]) slot = (slot + 1) & index->slot_mask;
+    index->slots[slot] = i + 1;
+  }
+  self->index = index;
+}
+
+// Find a node's position in the tree's index, or return TREE_INDEX_NONE if
+// the node isn't in the index.
+uint32_t ts_tree_index_find(const TSTree *self, const TSNode *node) {
+  const TreeIndex *index = self->index;
+  uint32_t slot = ts_tree_index__hash(node->id) & index->slot_mask;
+  for (;;) {
+    uint32_t entry = index->slots[slot];
+    if (!entry) return TREE_INDEX_NONE;
+    if (index->entries[entry - 1].subtree == node->id) return entry - 1;
+    slot = (slot + 1) & index->slot_mask;
+  }
+}
+
+TSNode ts_tree_index_node(const TSTree *self, uint32_t entry_index) {
+  if (entry_index == TREE_INDEX_NONE) {
+    return ts_node_new(NULL, NULL, length_zero(), 0);
+  }
+  const TreeIndexEntry *entry = &self->index->entries[entry_index];
+  return ts_node_new(self, entry->subtree, entry->position, entry->alias_symbol);
+}
+
 TSNode ts_tree_get_cached_parent(const TSTree *self, const TSNode *node) {
-  for (uint32_t i = 0; i < self->parent_cache_size; i++) {
-    uint32_t index = (self->parent_cache_start + i) % PARENT_CACHE_CAPACITY;
-    ParentCacheEntry *entry = &self->parent_cache[index];
-    if (entry->child == node->id) {
-      return ts_node_new(self, entry->parent, entry->position, entry->alias_symbol);
+  ParentCacheEntry *cache = self->parent_cache;
+  if (cache) {
+    for (uint32_t i = 0; i < PARENT_CACHE_CAPACITY; i++) {
+      ParentCacheEntry *entry = &cache[i];
+      if (entry->child != node->id) continue;
+
+      uint32_t version = entry->version;
+      atomic_fence();
+      ParentCacheEntry copy = *entry;
+      atomic_fence();
+      if (version % 2 == 0 && entry->version == version && copy.child == node->id) {
+        return ts_node_new(self, copy.parent, copy.position, copy.alias_symbol);
+      }
     }
   }
   return ts_node_new(NULL, NULL, length_zero(), 0);
 }
 
+// Cache a node's parent, replacing the oldest entry in the cache. If another
+// thread is writing the same entry, the parent is just not cached.
 void ts_tree_set_cached_parent(const TSTree *_self, const TSNode *node, const TSNode *parent) {
   TSTree *self = (TSTree *)_self;
-  if (!self->parent_cache) {
-    self->parent_cache = ts_calloc(PARENT_CACHE_CAPACITY, sizeof(ParentCacheEntry));
-  }
-
-  uint32_t index = (self->parent_cache_start + self->parent_cache_size) % PARENT_CACHE_CAPACITY;
-  self->parent_cache[index] = (ParentCacheEntry) {
-    .child = node->id,
-    .parent = (const Subtree *)parent->id,
-    .position = {
-      parent->context[0],
-      {parent->context[1], parent->context[2]}
-    },
-    .alias_symbol = parent->context[3],
-  };
-
-  if (self->parent_cache_size == PARENT_CACHE_CAPACITY) {
-    self->parent_cache_start++;
-  } else {
-    self->parent_cache_size++;
+  ParentCacheEntry *cache = self->parent_cache;
+  if (!cache) {
+    cache = ts_calloc(PARENT_CACHE_CAPACITY, sizeof(ParentCacheEntry));
+    if (!atomic_compare_exchange_pointer((void *volatile *)&self->parent_cache, NULL, cache)) {
+      ts_free(cache);
+      cache = self->parent_cache;
+    }
   }
+
+  uint32_t index = (atomic_inc(&self->parent_cache_next) - 1) % PARENT_CACHE_CAPACITY;
+  ParentCacheEntry *entry = &cache[index];
+  uint32_t version = entry->version;
+  if (version % 2 != 0 || !atomic_compare_exchange(&entry->version, version, version + 1)) return;
+
+  entry->child = node->id;
+  entry->parent = (const Subtree *)parent->id;
+  entry->position = (Length) {
+    parent->context[0],
+    {parent->context[1], parent->context[2]}
+  };
+  entry->alias_symbol = parent->context[3];
+  atomic_fence();
+  entry->version = version + 2;
 }
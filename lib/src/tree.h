@@ -5,27 +5,63 @@
 extern "C" {
 #endif
 
+// An entry in a tree's cache of recently-computed node parents.
+//
+// Several threads can read and write the cache at once, so each entry is
+// guarded by a version number. A thread that writes an entry first makes the
+// version odd, and then makes it even again once the entry is complete.
+// Readers ignore entries whose version was odd, or whose version changed
+// while they were being read.
 typedef struct {
+  volatile uint32_t version;
   const Subtree *child;
   const Subtree *parent;
   Length position;
   TSSymbol alias_symbol;
 } ParentCacheEntry;
 
+#define TREE_INDEX_NONE UINT32_MAX
+
+// A node in a tree's index. The nodes are stored in preorder, so a node's
+// descendants immediately follow it, and its next sibling follows its last
+// descendant.
+typedef struct {
+  const Subtree *subtree;
+  Length position;
+  TSSymbol alias_symbol;
+  uint32_t parent;
+  uint32_t prev_sibling;
+  uint32_t descendant_count;
+} TreeIndexEntry;
+
+// An index of a tree's visible nodes, with a hash table that maps each node's
+// id to its position in the index.
+typedef struct {
+  TreeIndexEntry *entries;
+  uint32_t entry_count;
+  uint32_t *slots;
+  uint32_t slot_mask;
+} TreeIndex;
+
 struct TSTree {
   Subtree root;
   const TSLanguage *language;
-  ParentCacheEntry *parent_cache;
-  uint32_t parent_cache_start;
-  uint32_t parent_cache_size;
+  ParentCacheEntry *volatile parent_cache;
+  volatile uint32_t parent_cache_next;
   TSRange *included_ranges;
   unsigned included_range_count;
+  SubtreeArena *arena;
+  SubtreeArena *frozen_arena;
+  TSTree *next_deferred;
+  TreeIndex *index;
 };
 
 TSTree *ts_tree_new(Subtree root, const TSLanguage *language, const TSRange *, unsigned);
 TSNode ts_node_new(const TSTree *, const Subtree *, Length, TSSymbol);
 TSNode ts_tree_get_cached_parent(const TSTree *, const TSNode *);
 void ts_tree_set_cached_parent(const TSTree *, const TSNode *, const TSNode *);
+uint32_t ts_tree_index_find(const TSTree *, const TSNode *);
+TSNode ts_tree_index_node(const TSTree *, uint32_t);
 
 #ifdef __cplusplus
 }
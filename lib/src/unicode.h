@@ -7,6 +7,19 @@ extern "C" {
 
 #include <limits.h>
 #include <stdint.h>
+#include <string.h>
+#include "./bits.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TS_ASCII_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TS_ASCII_SCAN_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TS_ASCII_SCAN_NEON
+#endif
 
 #define U_EXPORT
 #define U_EXPORT2
@@ -43,6 +56,56 @@ static inline uint32_t ts_decode_utf16(
   return i * 2;
 }
 
+// Get the length of the run of ASCII characters, not including newlines,
+// at the start of the given UTF8 string. Within such a run, every byte is
+// a single character and advances the column by one, so the lexer can step
+// through it without decoding. The string is classified in blocks, using
+// vector instructions where they are available.
+static inline uint32_t ts_ascii_run_length(const uint8_t *string, uint32_t length) {
+  uint32_t i = 0;
+
+#if defined(TS_ASCII_SCAN_AVX2)
+  const __m256i newline = _mm256_set1_epi8('\n');
+  for (; i + 32 <= length; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(string + i));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+      _mm256_or_si256(block, _mm256_cmpeq_epi8(block, newline))
+    );
+    if (mask) return i + count_trailing_zeros(mask);
+  }
+#elif defined(TS_ASCII_SCAN_SSE2)
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= length; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(string + i));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(
+      _mm_or_si128(block, _mm_cmpeq_epi8(block, newline))
+    );
+    if (mask) return i + count_trailing_zeros(mask);
+  }
+#elif defined(TS_ASCII_SCAN_NEON)
+  const uint8x16_t newline = vdupq_n_u8('\n');
+  const uint8x16_t high_bit = vdupq_n_u8(0x80);
+  for (; i + 16 <= length; i += 16) {
+    uint8x16_t block = vld1q_u8(string + i);
+    uint8x16_t stop = vorrq_u8(vcgeq_u8(block, high_bit), vceqq_u8(block, newline));
+    if (vmaxvq_u8(stop)) break;
+  }
+#else
+  // Without vector instructions, classify eight bytes at a time using
+  // ordinary integer operations.
+  for (; i + 8 <= length; i += 8) {
+    uint64_t block;
+    memcpy(&block, string + i, sizeof(block));
+    uint64_t newlines = block ^ 0x0a0a0a0a0a0a0a0aull;
+    uint64_t has_newline = (newlines - 0x0101010101010101ull) & ~newlines;
+    if ((block | has_newline) & 0x8080808080808080ull) break;
+  }
+#endif
+
+  while (i < length && string[i] < 0x80 && string[i] != '\n') i++;
+  return i;
+}
+
 #ifdef __cplusplus
 }
 #endif